@@ -22,6 +22,9 @@
 #define TANALDEVICE_H
 
 #include <QString>
+#include <QByteArray>
+#include <algorithm>
+#include <utility>
 #include "tconfigparam.h"
 #include "tcommon.h"
 
@@ -42,6 +45,17 @@ public:
     /// Receives the specified amount of data into the buffer
     virtual size_t readData(uint8_t * buffer, size_t len) = 0;
     virtual std::optional<size_t> availableBytes() = 0;
+
+    /// Receives up to the specified amount of data at once, the data are copied from the device only once
+    virtual QByteArray readBlock(size_t len) {
+        std::optional<size_t> available = availableBytes();
+        if(available) {
+            len = std::min(len, *available);
+        }
+        QByteArray data(static_cast<qsizetype>(len), Qt::Uninitialized);
+        data.resize(static_cast<qsizetype>(readData(reinterpret_cast<uint8_t *>(data.data()), len)));
+        return data;
+    }
 };
 
 class TAnalOutputStream : public TAnalStream {
@@ -68,6 +82,8 @@ public:
     virtual void run() = 0;
     /// Abort the current run of analytic action
     virtual void abort() = 0;
+    /// Get the progress of the current run as the number of processed and of all the work items (e.g., traces), both are zero when not reported
+    virtual std::pair<size_t, size_t> getProgress() const { return {0, 0}; }
 };
 
 class TAnalDevice : public TCommon {
@@ -104,6 +120,7 @@ public:
     /// Get list of available output data streams
     virtual QList<TAnalOutputStream *> getOutputDataStreams() const = 0;
 
+    /// Get info on whether an action is running (the device must not be deinitialized meanwhile)
     virtual bool isBusy() const = 0;
 };
 
@@ -985,7 +985,23 @@ bool THdfSession::beginAppendTraces(const QString &datasetPath, hsize_t samplesP
         return false;
     }
 
-    hid_t dset = H5Dopen2(m_fileId, pNorm.toUtf8().constData(), H5P_DEFAULT);
+    // Size the chunk cache to hold a whole band of chunks (all the chunks covering the same rows), so that
+    // the chunks left partially filled by one append are completed by the next one in memory, instead of
+    // being evicted and read back (the HDF5 default of 1 MiB holds a single chunk proposed by the export wizard).
+    const DatasetInfo info = datasetInfo(pNorm);
+    hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    if (info.chunked && info.chunkDims.size() == 2 && info.chunkDims[0] > 0 && info.chunkDims[1] > 0) {
+        const hsize_t chunksPerBand = (samplesPerTrace + info.chunkDims[1] - 1) / info.chunkDims[1];
+        const hsize_t bandBytes = chunksPerBand * info.chunkDims[0] * info.chunkDims[1] * sampleTypeBytes(expectedType);
+        const hsize_t cacheBytes = qBound<hsize_t>(1024 * 1024, bandBytes, HDF_APPEND_CHUNK_CACHE_MAX);
+        // w0 = 1: the fully written chunks are evicted first
+        if (dapl >= 0)
+            H5Pset_chunk_cache(dapl, H5D_CHUNK_CACHE_NSLOTS_DEFAULT, static_cast<size_t>(cacheBytes), 1.0);
+    }
+
+    hid_t dset = H5Dopen2(m_fileId, pNorm.toUtf8().constData(), dapl >= 0 ? dapl : H5P_DEFAULT);
+    if (dapl >= 0)
+        H5Pclose(dapl);
     if (dset < 0) {
         qCritical() << "[THdfSession] beginAppendTraces: H5Dopen2 failed for:" << pNorm;
         return false;
@@ -1086,6 +1102,45 @@ bool THdfSession::beginAppendTraces(const QString &datasetPath, hsize_t samplesP
     return true;
 }
 
+bool THdfSession::extendAppendTraces(TraceAppendHandle &h, hsize_t rowsToAppend) const
+{
+    if (!isOpen()) {
+        qCritical() << "[THdfSession] extendAppendTraces: file not open";
+        return false;
+    }
+    if (!h.active || h.dset < 0 || h.fileSpace < 0) {
+        qCritical() << "[THdfSession] extendAppendTraces: handle not active for:" << h.datasetPath;
+        return false;
+    }
+    if (rowsToAppend == 0) {
+        qCritical() << "[THdfSession] extendAppendTraces: rowsToAppend == 0 for:" << h.datasetPath;
+        return false;
+    }
+
+    const hsize_t newRows = h.endRowExclusive + rowsToAppend;
+
+    hsize_t newDims[2]{ newRows, h.cols };
+    if (H5Dset_extent(h.dset, newDims) < 0) {
+        qCritical() << "[THdfSession] extendAppendTraces: H5Dset_extent failed for:" << h.datasetPath
+                    << "oldRows" << (qulonglong)h.endRowExclusive
+                    << "append" << (qulonglong)rowsToAppend;
+        return false;
+    }
+
+    // Refresh dataspace after extend
+    hid_t fileSpace = H5Dget_space(h.dset);
+    if (fileSpace < 0) {
+        qCritical() << "[THdfSession] extendAppendTraces: H5Dget_space after extend failed for:" << h.datasetPath;
+        return false;
+    }
+
+    H5Sclose(h.fileSpace);
+    h.fileSpace = fileSpace;
+    h.endRowExclusive = newRows;
+
+    return true;
+}
+
 bool THdfSession::appendTraceRow(TraceAppendHandle &h, const void *data, TScope::TSampleType providedType, std::size_t bytes) const
 {
     if (!isOpen()) {
@@ -1158,6 +1213,92 @@ bool THdfSession::appendTraceRow(TraceAppendHandle &h, const void *data, TScope:
     return true;
 }
 
+bool THdfSession::appendTraceRows(TraceAppendHandle &h, const void *data, hsize_t rowCount, TScope::TSampleType providedType, std::size_t bytes) const
+{
+    if (!isOpen()) {
+        qCritical() << "[THdfSession] appendTraceRows: file not open";
+        return false;
+    }
+    if (!h.active || h.dset < 0 || h.fileSpace < 0) {
+        qCritical() << "[THdfSession] appendTraceRows: handle not active for:" << h.datasetPath;
+        return false;
+    }
+    if (!data) {
+        qCritical() << "[THdfSession] appendTraceRows: null data for:" << h.datasetPath;
+        return false;
+    }
+    if (rowCount == 0)
+        return true;
+    if (rowCount > h.endRowExclusive - h.nextRow) {
+        qCritical() << "[THdfSession] appendTraceRows: write past reserved rows for:" << h.datasetPath
+                    << "nextRow" << (qulonglong)h.nextRow
+                    << "rows" << (qulonglong)rowCount
+                    << "end" << (qulonglong)h.endRowExclusive;
+        return false;
+    }
+
+    if (providedType != h.sampleType) {
+        qCritical() << "[THdfSession] appendTraceRows: type mismatch for:" << h.datasetPath
+                    << "provided" << int(providedType)
+                    << "expected" << int(h.sampleType);
+        return false;
+    }
+
+    const std::size_t elemBytes = sampleTypeBytes(providedType);
+    if (elemBytes == 0) {
+        qCritical() << "[THdfSession] appendTraceRows: unknown elemBytes for type" << int(providedType)
+        << "dataset" << h.datasetPath;
+        return false;
+    }
+
+    const std::size_t expectedBytes = (std::size_t)rowCount * (std::size_t)h.cols * elemBytes;
+    if (bytes != expectedBytes) {
+        qCritical() << "[THdfSession] appendTraceRows: byte count mismatch for:" << h.datasetPath
+                    << "got" << (qulonglong)bytes
+                    << "expected" << (qulonglong)expectedBytes
+                    << "rows" << (qulonglong)rowCount
+                    << "cols" << (qulonglong)h.cols
+                    << "elemBytes" << (qulonglong)elemBytes;
+        return false;
+    }
+
+    // Select hyperslab in file space: [row, 0] size [rowCount, cols]
+    hsize_t start[2]{ h.nextRow, 0 };
+    hsize_t count[2]{ rowCount, h.cols };
+
+    if (H5Sselect_hyperslab(h.fileSpace, H5S_SELECT_SET, start, nullptr, count, nullptr) < 0) {
+        qCritical() << "[THdfSession] appendTraceRows: H5Sselect_hyperslab failed for:" << h.datasetPath
+                    << "row" << (qulonglong)h.nextRow;
+        return false;
+    }
+
+    const hid_t memType = sampleTypeToNativeH5Type(h.sampleType);
+    if (memType < 0) {
+        qCritical() << "[THdfSession] appendTraceRows: invalid memType for type" << int(h.sampleType)
+        << "dataset" << h.datasetPath;
+        return false;
+    }
+
+    hid_t memSpace = H5Screate_simple(2, count, nullptr);
+    if (memSpace < 0) {
+        qCritical() << "[THdfSession] appendTraceRows: H5Screate_simple(mem) failed for:" << h.datasetPath;
+        return false;
+    }
+
+    const herr_t status = H5Dwrite(h.dset, memType, memSpace, h.fileSpace, H5P_DEFAULT, data);
+    H5Sclose(memSpace);
+
+    if (status < 0) {
+        qCritical() << "[THdfSession] appendTraceRows: H5Dwrite failed for:" << h.datasetPath
+                    << "row" << (qulonglong)h.nextRow
+                    << "rows" << (qulonglong)rowCount;
+        return false;
+    }
+
+    h.nextRow += rowCount;
+    return true;
+}
+
 void THdfSession::endAppendTraces(TraceAppendHandle &h) const
 {
     if (h.memSpace >= 0) {
@@ -31,6 +31,9 @@
 
 #include <hdf5.h>
 
+// Upper bound of the chunk cache used while appending traces, in bytes
+#define HDF_APPEND_CHUNK_CACHE_MAX (64 * 1024 * 1024)
+
 class THdfSession : public QObject
 {
     Q_OBJECT
@@ -117,7 +120,11 @@ public:
     };
 
     bool beginAppendTraces(const QString &datasetPath, hsize_t samplesPerTrace, TScope::TSampleType expectedType, hsize_t rowsToAppend, TraceAppendHandle &out) const;
+    // Reserves rowsToAppend more rows past the reserved ones of an open handle, so a long append keeps its dataset open.
+    bool extendAppendTraces(TraceAppendHandle &h, hsize_t rowsToAppend) const;
     bool appendTraceRow(TraceAppendHandle &h, const void *data, TScope::TSampleType providedType, std::size_t bytes) const;
+    // Writes rowCount consecutive rows (row-major, cols samples each) with a single hyperslab selection and H5Dwrite.
+    bool appendTraceRows(TraceAppendHandle &h, const void *data, hsize_t rowCount, TScope::TSampleType providedType, std::size_t bytes) const;
     void endAppendTraces(TraceAppendHandle &h) const;
 
     bool appendTracesMetadataRecord(const QString &groupPath, quint64 first_trace, quint64 trace_count, const QString &timestamp, const QString &settings) const;
@@ -20,6 +20,7 @@
 #include "taesengine.h"
 
 #include <QtGlobal>
+#include <cstring>
 
 #include "tcipheraction.h"
 #include "tcipherinputstream.h"
@@ -315,11 +316,7 @@ bool TAESEngine::isBusy() const
 
 size_t TAESEngine::addData(const uint8_t * buffer, size_t length){
 
-    m_data.reserve(m_data.size() + length); // preallocate space
-
-    for(int i = 0; i < length; i++){
-        m_data.append(buffer[i]);
-    }
+    m_data.append(buffer, length);
 
     return length;
 
@@ -327,11 +324,7 @@ size_t TAESEngine::addData(const uint8_t * buffer, size_t length){
 
 size_t TAESEngine::addKeyData(const uint8_t * buffer, size_t length){
 
-    m_keyData.reserve(m_keyData.size() + length); // preallocate space
-
-    for(int i = 0; i < length; i++){
-        m_keyData.append(buffer[i]);
-    }
+    m_keyData.append(buffer, length);
 
     return length;
 
@@ -350,10 +343,11 @@ void TAESEngine::reset() {
 
 size_t TAESEngine::getIntermediates(uint8_t * buffer, size_t length){
 
-    size_t sent = 0;
+    const size_t sent = std::min(length, availableBytes());
 
-    for (sent = 0; m_position < m_intermediates.size() && sent < length; sent++, m_position++) {
-        buffer[sent] = m_intermediates[m_position];
+    if(sent > 0) {
+        std::memcpy(buffer, m_intermediates.data() + m_position, sent);
+        m_position += sent;
     }
 
     return sent;
@@ -366,7 +360,7 @@ size_t TAESEngine::availableBytes(){
 
 void TAESEngine::loadKey(){
 
-    if(m_keyData.length() != m_keysizeB){
+    if(m_keyData.size() != m_keysizeB){
         qCritical("Key buffer does not contain a valid amount of bytes (16 B for AES-128, 24 B for AES-192, 32 B for AES-256). Consider running the Reset action.");
         return;
     }
@@ -383,7 +377,7 @@ void TAESEngine::loadKey(){
 
 void TAESEngine::computeIntermediates(){
 
-    if(m_data.length() % 16 != 0){
+    if(m_data.size() % 16 != 0){
         qCritical("Plaintext/Ciphertext buffer does not contain a valid amount of bytes (not divisible by 16)");
         return;
     }        
@@ -392,17 +386,17 @@ void TAESEngine::computeIntermediates(){
     m_intermediates.clear();
     m_position = m_intermediates.length();
 
-    size_t blocksN = m_data.length() / 16;
+    size_t blocksN = m_data.size() / 16;
 
-    qInfo(QString("Unread previously generated data were erased. Now processing %1 bytes of data (%2 cipher blocks).").arg(m_data.length()).arg(blocksN).toLatin1());
+    qInfo(QString("Unread previously generated data were erased. Now processing %1 bytes of data (%2 cipher blocks).").arg(m_data.size()).arg(blocksN).toLatin1());
 
     uint8_t AESOut[16];
 
-    m_intermediates.reserve(m_intermediates.size() + m_data.length());
+    m_intermediates.reserve(m_intermediates.size() + m_data.size());
 
     for(int block = 0; block < blocksN; block++){
 
-        uint8_t * AESIn = &(m_data[block * 16]);
+        uint8_t * AESIn = m_data.data() + block * 16;
 
         if(m_operation == 0){
 
@@ -20,6 +20,7 @@
 #include "tpresentengine.h"
 
 #include <QtGlobal>
+#include <cstring>
 
 #include "tcipheraction.h"
 #include "tcipherinputstream.h"
@@ -302,11 +303,7 @@ bool TPRESENTEngine::isBusy() const
 
 size_t TPRESENTEngine::addData(const uint8_t * buffer, size_t length){
 
-    m_data.reserve(m_data.size() + length); // preallocate space
-
-    for(int i = 0; i < length; i++){
-        m_data.append(buffer[i]);
-    }
+    m_data.append(buffer, length);
 
     return length;
 
@@ -314,11 +311,7 @@ size_t TPRESENTEngine::addData(const uint8_t * buffer, size_t length){
 
 size_t TPRESENTEngine::addKeyData(const uint8_t * buffer, size_t length){
 
-    m_keyData.reserve(m_keyData.size() + length); // preallocate space
-
-    for(int i = 0; i < length; i++){
-        m_keyData.append(buffer[i]);
-    }
+    m_keyData.append(buffer, length);
 
     return length;
 
@@ -339,10 +332,11 @@ void TPRESENTEngine::reset() {
 
 size_t TPRESENTEngine::getIntermediates(uint8_t * buffer, size_t length){
 
-    size_t sent = 0;
+    const size_t sent = std::min(length, availableBytes());
 
-    for (sent = 0; m_position < m_intermediates.size() && sent < length; sent++, m_position++) {
-        buffer[sent] = m_intermediates[m_position];
+    if(sent > 0) {
+        std::memcpy(buffer, m_intermediates.data() + m_position, sent);
+        m_position += sent;
     }
 
     return sent;
@@ -355,7 +349,7 @@ size_t TPRESENTEngine::availableBytes(){
 
 void TPRESENTEngine::loadKey(){
 
-    if(m_keyData.length() != m_keysizeB){
+    if(m_keyData.size() != m_keysizeB){
         qCritical("Key buffer does not contain a valid amount of bytes (10 B for PRESENT-80, 16 B for PRESENT-128). Consider running the Reset action.");
         return;
     }
@@ -372,7 +366,7 @@ void TPRESENTEngine::loadKey(){
 
 void TPRESENTEngine::computeIntermediates(){
 
-    if(m_data.length() % 8 != 0){
+    if(m_data.size() % 8 != 0){
         qCritical("Plaintext/Ciphertext buffer does not contain a valid amount of bytes (not divisible by 8)");
         return;
     }
@@ -381,17 +375,17 @@ void TPRESENTEngine::computeIntermediates(){
     m_intermediates.clear();
     m_position = m_intermediates.length();
 
-    size_t blocksN = m_data.length() / 8;
+    size_t blocksN = m_data.size() / 8;
 
-    qInfo(QString("Unread previously generated data were erased. Now processing %1 bytes of data (%2 cipher blocks).").arg(m_data.length()).arg(blocksN).toLatin1());
+    qInfo(QString("Unread previously generated data were erased. Now processing %1 bytes of data (%2 cipher blocks).").arg(m_data.size()).arg(blocksN).toLatin1());
 
     uint8_t PRESENTOut[8];
 
-    m_intermediates.reserve(m_intermediates.size() + m_data.length());
+    m_intermediates.reserve(m_intermediates.size() + m_data.size());
 
     for(int block = 0; block < blocksN; block++){
 
-        uint8_t * PRESENTIn = &(m_data[block * 8]);
+        uint8_t * PRESENTIn = m_data.data() + block * 8;
 
         if(m_operation == 0){
 
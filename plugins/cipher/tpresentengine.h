@@ -25,6 +25,7 @@
 #include <QQueue>
 #include "tconfigparam.h"
 #include "tanaldevice.h"
+#include "tdatabuffer.hpp"
 
 class TPRESENTEngine : public TAnalDevice {
 
@@ -84,8 +85,8 @@ private:
     QList<TAnalInputStream *> m_analInputStreams;
     QList<TAnalOutputStream *> m_analOutputStreams;
 
-    QList<uint8_t> m_data;
-    QList<uint8_t> m_keyData;
+    TDataBuffer m_data;
+    TDataBuffer m_keyData;
 
     QList<uint8_t> m_intermediates;
     size_t m_position;
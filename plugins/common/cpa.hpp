@@ -21,14 +21,23 @@
 #define CPA_HPP
 
 #include "typesmoment.hpp"
+#include "simd.hpp"
 #include <QtGlobal>
-#include <omp.h>
+#include <cmath>
+#include <type_traits>
 
 namespace SICAK {
 
+    /// Splits the samples x candidates plane into tiles, so that there is enough of them to keep all the worker threads busy
+    inline void CpaTileGrid(size_t samplesPerTrace, size_t noOfCandidates, int noOfThreads, size_t & sampleBlocks, size_t & candidateBlocks) {
+        size_t threads = (noOfThreads > 0) ? static_cast<size_t>(noOfThreads) : 1;
+        sampleBlocks = std::max<size_t>(std::min(samplesPerTrace, threads), 1);
+        candidateBlocks = std::max<size_t>(std::min(noOfCandidates, (threads + sampleBlocks - 1) / sampleBlocks), 1);
+    }
+
     template <class T, class U, class V>
     //void UniFoCpaAddTraces(Moments2DContext<T>& c, const PowerTraces<U>& pt, const PowerPredictions<V>& pp) {
-    void UniFoCpaAddTraces(Moments2DContext<T>& c, const U* tracesBuffer, const V* predictsBuffer, size_t noOfTraces, size_t noOfCandidates, size_t samplesPerTrace) {
+    void UniFoCpaAddTraces(Moments2DContext<T>& c, const U* tracesBuffer, const V* predictsBuffer, size_t noOfTraces, size_t noOfCandidates, size_t samplesPerTrace, size_t threads = 0) {
 
         if(c.p1MOrder() != 1 || c.p1CSOrder() != 2 || c.p12ACSOrder() != 1 || c.p1MOrder() != c.p2MOrder() || c.p1CSOrder() != c.p2CSOrder())
             qCritical("Not a valid first-order univariate CPA context!");
@@ -42,52 +51,307 @@ namespace SICAK {
         //if (pt.noOfTraces() != pp.noOfTraces())
             //throw RuntimeException("Number of power traces doesn't match the number of power predictions.");
 
-        //const long long noOfTraces = pt.noOfTraces();
-        //const long long samplesPerTrace = pt.samplesPerTrace();
-        //const long long noOfCandidates = pp.noOfCandidates();
+        // Every tile of the samples x candidates plane keeps its own running means of the samples and the predictions,
+        // so that the tiles are fully independent and every accumulator sees exactly the same sequence of operations,
+        // no matter how many threads are used -> the results are bit-reproducible
+        const int noOfThreads = WorkerThreads(threads);
+        size_t sampleBlocks, candidateBlocks;
+        CpaTileGrid(samplesPerTrace, noOfCandidates, noOfThreads, sampleBlocks, candidateBlocks);
+        const long long noOfTiles = static_cast<long long>(sampleBlocks * candidateBlocks);
+        const size_t card = c.p1Card();
+
+        // The tiles read the initial statistics from the context, the updated ones are collected aside until all the tiles are done
+        Vector<T> newTracesAvg(samplesPerTrace);
+        Vector<T> newTracesCS2(samplesPerTrace);
+        Vector<T> newPredsAvg(noOfCandidates);
+        Vector<T> newPredsCS2(noOfCandidates);
+
+        #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+        for (long long tile = 0; tile < noOfTiles; tile++) {
+
+            size_t firstSample, lastSample, firstCandidate, lastCandidate;
+            SplitRange(samplesPerTrace, sampleBlocks, static_cast<size_t>(tile) % sampleBlocks, firstSample, lastSample);
+            SplitRange(noOfCandidates, candidateBlocks, static_cast<size_t>(tile) / sampleBlocks, firstCandidate, lastCandidate);
+            const size_t tileSamples = lastSample - firstSample;
+            const size_t tileCandidates = lastCandidate - firstCandidate;
+
+            Vector<T> tracesAvg(tileSamples);
+            Vector<T> tracesCS2(tileSamples);
+            Vector<T> predsAvg(tileCandidates);
+            Vector<T> predsCS2(tileCandidates);
+
+            std::copy_n(c.p1M(1).data() + firstSample, tileSamples, tracesAvg.data());
+            std::copy_n(c.p1CS(2).data() + firstSample, tileSamples, tracesCS2.data());
+            std::copy_n(c.p2M(1).data() + firstCandidate, tileCandidates, predsAvg.data());
+            std::copy_n(c.p2CS(2).data() + firstCandidate, tileCandidates, predsCS2.data());
 
-        for (size_t trace = 0; trace < noOfTraces; trace++) {
+            for (size_t trace = 0; trace < noOfTraces; trace++) {
 
-            #pragma omp parallel for
-            for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+                const T p_card = static_cast<T>(card + trace);
+                const T p_trace = p_card / (p_card + 1.0f);
+                const U * p_ptFirst = tracesBuffer + trace*samplesPerTrace + firstSample;
+                const V * p_ppFirst = predictsBuffer + trace*noOfCandidates + firstCandidate;
 
-                T p_trace = static_cast<T>(c.p1Card()) / (static_cast<T>(c.p1Card()) + 1.0f);
-                //T p_pp = pp(candidate, trace);
-                T p_pp = *(predictsBuffer + trace*noOfCandidates + candidate);
-                T p_predsAvg = c.p2M(1)(candidate);
-                T p_optAlpha = p_trace * (p_pp - p_predsAvg);
-                T * p_predsTracesCSum = &( c.p12ACS(1)(0, candidate) );
-                //const U * p_pt = &(pt(0, trace));
-                const U * p_pt = tracesBuffer + trace*samplesPerTrace;
-                T * p_tracesAvg = &( c.p1M(1)(0) );
+                for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
 
-                for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+                    T p_optAlpha = p_trace * (static_cast<T>(p_ppFirst[candidate]) - predsAvg(candidate));
+                    T * p_predsTracesCSum = &( c.p12ACS(1)(firstSample, firstCandidate + candidate) );
 
-                    *(p_predsTracesCSum++) += p_optAlpha * (static_cast<T>(*(p_pt++)) - *(p_tracesAvg++));
+                    VecAxpyConvertSub(p_predsTracesCSum, p_optAlpha, p_ptFirst, tracesAvg.data(), tileSamples);
 
                 }
 
+                for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
+                    T temp = (static_cast<T>(p_ppFirst[candidate]) - predsAvg(candidate));
+                    predsAvg(candidate) += (temp / static_cast<T>(card + trace + 1));
+                    predsCS2(candidate) += temp * (static_cast<T>(p_ppFirst[candidate]) - predsAvg(candidate));
+                }
+
+                for (size_t sample = 0; sample < tileSamples; sample++) {
+                    T temp = (static_cast<T>(p_ptFirst[sample]) - tracesAvg(sample));
+                    tracesAvg(sample) += (temp / static_cast<T>(card + trace + 1));
+                    tracesCS2(sample) += temp * (static_cast<T>(p_ptFirst[sample]) - tracesAvg(sample));
+                }
+
             }
 
-            for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
-                T temp = 0;
-                //temp = (static_cast<T>(pp(candidate, trace)) - c.p2M(1)(candidate));
-                temp = (static_cast<T>(*(predictsBuffer + trace*noOfCandidates + candidate)) - c.p2M(1)(candidate));
-                c.p2M(1)(candidate) += (temp / static_cast<T>((c.p1Card() + 1)));
-                //c.p2CS(2)(candidate) += temp * (static_cast<T>(pp(candidate, trace)) - c.p2M(1)(candidate));
-                c.p2CS(2)(candidate) += temp * (static_cast<T>(*(predictsBuffer + trace*noOfCandidates + candidate)) - c.p2M(1)(candidate));
+            // Every tile computed the same statistics of its samples/candidates, keep just one copy of them
+            if (firstCandidate == 0) {
+                std::copy_n(tracesAvg.data(), tileSamples, newTracesAvg.data() + firstSample);
+                std::copy_n(tracesCS2.data(), tileSamples, newTracesCS2.data() + firstSample);
             }
 
-            for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-                T temp = 0;
-                //temp = (static_cast<T>(pt(sample, trace)) - c.p1M(1)(sample));
-                temp = (static_cast<T>(*(tracesBuffer + trace*samplesPerTrace + sample)) - c.p1M(1)(sample));
-                c.p1M(1)(sample) += (temp / static_cast<T>((c.p1Card() + 1)));
-                //c.p1CS(2)(sample) += temp * (static_cast<T>(pt(sample, trace)) - c.p1M(1)(sample));
-                c.p1CS(2)(sample) += temp * (static_cast<T>(*(tracesBuffer + trace*samplesPerTrace + sample)) - c.p1M(1)(sample));
+            if (firstSample == 0) {
+                std::copy_n(predsAvg.data(), tileCandidates, newPredsAvg.data() + firstCandidate);
+                std::copy_n(predsCS2.data(), tileCandidates, newPredsCS2.data() + firstCandidate);
+            }
+
+        }
+
+        std::copy_n(newTracesAvg.data(), samplesPerTrace, c.p1M(1).data());
+        std::copy_n(newTracesCS2.data(), samplesPerTrace, c.p1CS(2).data());
+        std::copy_n(newPredsAvg.data(), noOfCandidates, c.p2M(1).data());
+        std::copy_n(newPredsCS2.data(), noOfCandidates, c.p2CS(2).data());
+
+        c.p1Card() = card + noOfTraces;
+        c.p2Card() = c.p1Card();
+
+    }
+
+    /// Default number of traces processed at once by UniFoCpaAddTracesBatched
+    const size_t CPA_BATCH_TRACES = 256;
+    /// Upper bound of the centered traces kept for a batch by UniFoCpaAddTracesBatched, in bytes; long traces get smaller batches
+    const size_t CPA_BATCH_BYTES = 32 * 1024 * 1024;
+    /// Tile of the cross-sum matrix (samples x candidates) accumulated at once by UniFoCpaAddTracesBatched, sized to stay in the cache
+    const size_t CPA_TILE_SAMPLES = 128;
+    const size_t CPA_TILE_CANDIDATES = 32;
+    /// Maximal number of cross-sums accumulated in a tile-local buffer for single precision contexts
+    const size_t CPA_LOCAL_ACS_ELEMENTS = 65536;
+
+    /// Block of the cross-sums kept in registers within a tile
+    constexpr size_t CPA_BLOCK_SAMPLES = 8;
+    constexpr size_t CPA_BLOCK_CANDIDATES = 4;
+
+    /// Centers the columns first..last of a block of 'batch' rows of 'width' values, computes the column averages and sums of squared deviations
+    template <class T, class U>
+    void UniFoCpaCenterBatch(const U* buffer, size_t width, size_t batch, size_t first, size_t last, Matrix<T> & centered, Vector<T> & avgs, Vector<T> & cs2) {
+
+        const size_t columns = last - first;
+        T * p_avgs = avgs.data() + first;
+        T * p_cs2 = cs2.data() + first;
+
+        std::fill_n(p_avgs, columns, T(0));
+        std::fill_n(p_cs2, columns, T(0));
+
+        for (size_t row = 0; row < batch; row++) {
+            const U * p_row = buffer + row * width + first;
+            for (size_t col = 0; col < columns; col++) {
+                p_avgs[col] += static_cast<T>(p_row[col]);
             }
+        }
 
-            c.p1Card() = c.p1Card() + 1;
+        for (size_t col = 0; col < columns; col++) {
+            p_avgs[col] /= static_cast<T>(batch);
+        }
+
+        for (size_t row = 0; row < batch; row++) {
+            const U * p_row = buffer + row * width + first;
+            T * p_centered = &(centered(first, row));
+            VecConvertSub(p_centered, p_row, p_avgs, columns);
+            for (size_t col = 0; col < columns; col++) {
+                p_cs2[col] += p_centered[col] * p_centered[col];
+            }
+        }
+
+    }
+
+    /// Adds traces to the first-order CPA context in batches: every batch is centered on its own means, its cross-sum matrix
+    /// is computed as a tiled matrix product (centered traces^T x centered predictions) and merged into the context using the pairwise update formulas.
+    /// The cross-sum matrix in the context is swept once per batch instead of once per trace.
+    template <class T, class U, class V>
+    void UniFoCpaAddTracesBatched(Moments2DContext<T>& c, const U* tracesBuffer, const V* predictsBuffer, size_t noOfTraces, size_t noOfCandidates, size_t samplesPerTrace, size_t threads = 0, size_t batchSize = CPA_BATCH_TRACES) {
+
+        if(c.p1MOrder() != 1 || c.p1CSOrder() != 2 || c.p12ACSOrder() != 1 || c.p1MOrder() != c.p2MOrder() || c.p1CSOrder() != c.p2CSOrder())
+            qCritical("Not a valid first-order univariate CPA context!");
+
+        if (c.p1Width() != samplesPerTrace)
+            qCritical("Incompatible context: Numbers of samples per trace don't match.");
+
+        if (c.p2Width() != noOfCandidates)
+            qCritical("Incompatible context: Numbers of key candidates don't match.");
+
+        if (noOfTraces < 1)
+            return;
+
+        if (batchSize < 1)
+            batchSize = CPA_BATCH_TRACES;
+
+        // single precision contexts are updated once per batch, the batch itself is processed in double precision
+        typedef typename WorkType<T>::type W;
+
+        // bound the scratch memory of the centered batch
+        batchSize = std::min(batchSize, std::max<size_t>(1, CPA_BATCH_BYTES / (samplesPerTrace * sizeof(W))));
+
+        const int noOfThreads = WorkerThreads(threads);
+        const size_t maxBatch = std::min(batchSize, noOfTraces);
+
+        Matrix<W> centeredTraces(samplesPerTrace, maxBatch);
+        Matrix<W> centeredPreds(noOfCandidates, maxBatch);
+        Vector<W> tracesAvg(samplesPerTrace);
+        Vector<W> tracesCS2(samplesPerTrace);
+        Vector<W> predsAvg(noOfCandidates);
+        Vector<W> predsCS2(noOfCandidates);
+
+        const size_t sampleTiles = (samplesPerTrace + CPA_TILE_SAMPLES - 1) / CPA_TILE_SAMPLES;
+        const size_t candidateTiles = (noOfCandidates + CPA_TILE_CANDIDATES - 1) / CPA_TILE_CANDIDATES;
+        const long long sampleTilesLL = static_cast<long long>(sampleTiles);
+        const long long candidateTilesLL = static_cast<long long>(candidateTiles);
+        const long long noOfTiles = static_cast<long long>(sampleTiles * candidateTiles);
+
+        for (size_t firstTrace = 0; firstTrace < noOfTraces; firstTrace += batchSize) {
+
+            const size_t batch = std::min(batchSize, noOfTraces - firstTrace);
+            const U * p_traces = tracesBuffer + firstTrace * samplesPerTrace;
+            const V * p_preds = predictsBuffer + firstTrace * noOfCandidates;
+
+            const W n1 = static_cast<W>(c.p1Card()); // cardinality of the context
+            const W n2 = static_cast<W>(batch); // cardinality of the batch
+            const W n = n1 + n2; // cardinality of the merged set
+            const W mergeCoef = (n1 * n2) / n;
+
+            // center the batch, then merge the means and CSs into the context, keep the deltas of the means for the ACS merge
+            #pragma omp parallel num_threads(noOfThreads)
+            {
+
+                #pragma omp for schedule(static)
+                for (long long tile = 0; tile < sampleTilesLL; tile++) {
+
+                    const size_t first = static_cast<size_t>(tile) * CPA_TILE_SAMPLES;
+                    const size_t last = std::min(first + CPA_TILE_SAMPLES, samplesPerTrace);
+
+                    UniFoCpaCenterBatch(p_traces, samplesPerTrace, batch, first, last, centeredTraces, tracesAvg, tracesCS2);
+
+                    for (size_t sample = first; sample < last; sample++) {
+                        W delta = tracesAvg(sample) - static_cast<W>(c.p1M(1)(sample));
+                        tracesAvg(sample) = delta;
+                        c.p1CS(2)(sample) += tracesCS2(sample) + mergeCoef * delta * delta;
+                        c.p1M(1)(sample) += delta * (n2 / n);
+                    }
+
+                }
+
+                #pragma omp for schedule(static)
+                for (long long tile = 0; tile < candidateTilesLL; tile++) {
+
+                    const size_t first = static_cast<size_t>(tile) * CPA_TILE_CANDIDATES;
+                    const size_t last = std::min(first + CPA_TILE_CANDIDATES, noOfCandidates);
+
+                    UniFoCpaCenterBatch(p_preds, noOfCandidates, batch, first, last, centeredPreds, predsAvg, predsCS2);
+
+                    for (size_t candidate = first; candidate < last; candidate++) {
+                        W delta = predsAvg(candidate) - static_cast<W>(c.p2M(1)(candidate));
+                        predsAvg(candidate) = delta;
+                        c.p2CS(2)(candidate) += predsCS2(candidate) + mergeCoef * delta * delta;
+                        c.p2M(1)(candidate) += delta * (n2 / n);
+                    }
+
+                }
+
+                // tracesAvg and predsAvg now hold the deltas of the means
+                #pragma omp for schedule(static)
+                for (long long tile = 0; tile < noOfTiles; tile++) {
+
+                    const size_t firstSample = static_cast<size_t>(tile % sampleTilesLL) * CPA_TILE_SAMPLES;
+                    const size_t firstCandidate = static_cast<size_t>(tile / sampleTilesLL) * CPA_TILE_CANDIDATES;
+                    const size_t lastSample = std::min(firstSample + CPA_TILE_SAMPLES, samplesPerTrace);
+                    const size_t lastCandidate = std::min(firstCandidate + CPA_TILE_CANDIDATES, noOfCandidates);
+
+                    // the tile is processed in blocks of CPA_BLOCK_CANDIDATES x CPA_BLOCK_SAMPLES cross-sums, that are kept in registers over the whole batch
+                    for (size_t candidate = firstCandidate; candidate < lastCandidate; candidate += CPA_BLOCK_CANDIDATES) {
+
+                        const size_t blockCandidates = std::min(CPA_BLOCK_CANDIDATES, lastCandidate - candidate);
+
+                        for (size_t sample = firstSample; sample < lastSample; sample += CPA_BLOCK_SAMPLES) {
+
+                            const size_t blockSamples = std::min(CPA_BLOCK_SAMPLES, lastSample - sample);
+
+                            W acc[CPA_BLOCK_CANDIDATES][CPA_BLOCK_SAMPLES] = {};
+
+                            // cross-sums of the batch: acc = centered traces^T x centered predictions
+                            if (blockCandidates == CPA_BLOCK_CANDIDATES && blockSamples == CPA_BLOCK_SAMPLES) {
+
+                                for (size_t trace = 0; trace < batch; trace++) {
+
+                                    const W * p_centeredTrace = &(centeredTraces(sample, trace));
+                                    const W * p_centeredPreds = &(centeredPreds(candidate, trace));
+
+                                    for (size_t i = 0; i < CPA_BLOCK_CANDIDATES; i++) {
+                                        for (size_t j = 0; j < CPA_BLOCK_SAMPLES; j++) {
+                                            acc[i][j] += p_centeredTrace[j] * p_centeredPreds[i];
+                                        }
+                                    }
+
+                                }
+
+                            } else { // edge of the matrix
+
+                                for (size_t trace = 0; trace < batch; trace++) {
+
+                                    const W * p_centeredTrace = &(centeredTraces(sample, trace));
+                                    const W * p_centeredPreds = &(centeredPreds(candidate, trace));
+
+                                    for (size_t i = 0; i < blockCandidates; i++) {
+                                        for (size_t j = 0; j < blockSamples; j++) {
+                                            acc[i][j] += p_centeredTrace[j] * p_centeredPreds[i];
+                                        }
+                                    }
+
+                                }
+
+                            }
+
+                            // merge with the context
+                            for (size_t i = 0; i < blockCandidates; i++) {
+
+                                const W p_alpha = mergeCoef * predsAvg(candidate + i);
+                                const W * p_tracesDelta = tracesAvg.data() + sample;
+                                T * p_acs = &(c.p12ACS(1)(sample, candidate + i));
+
+                                for (size_t j = 0; j < blockSamples; j++) {
+                                    p_acs[j] += acc[i][j] + p_alpha * p_tracesDelta[j];
+                                }
+
+                            }
+
+                        }
+
+                    }
+
+                }
+
+            }
+
+            c.p1Card() = c.p1Card() + batch;
 
         }
 
@@ -95,8 +359,9 @@ namespace SICAK {
 
     }
 
-    template <class T>
-    void UniFoCpaComputeCorrelationMatrix(const Moments2DContext<T> & c, Matrix<T> & correlations){
+    /// Computes the correlation matrix, the output type R may differ from the type of the context T
+    template <class T, class R = T>
+    void UniFoCpaComputeCorrelationMatrix(const Moments2DContext<T> & c, Matrix<R> & correlations, size_t threads = 0){
 
         if(c.p1MOrder() != 1 || c.p1CSOrder() != 2 || c.p12ACSOrder() != 1 || c.p1MOrder() != c.p2MOrder() || c.p1CSOrder() != c.p2CSOrder() || c.p1Card() != c.p2Card())
             qCritical("Not a valid first-order univariate CPA context!");
@@ -105,27 +370,32 @@ namespace SICAK {
         size_t noOfCandidates = c.p2Width();
 
         correlations.init(samplesPerTrace, noOfCandidates);
-        Vector<T> sqrtTracesCS2(samplesPerTrace);
-        Vector<T> sqrtPredsCS2(noOfCandidates);
+        Vector<R> sqrtTracesCS2(samplesPerTrace);
+        Vector<R> sqrtPredsCS2(noOfCandidates);
 
 
         for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-            sqrtTracesCS2(sample) = sqrt(c.p1CS(2)(sample));
+            sqrtTracesCS2(sample) = std::sqrt(static_cast<R>(c.p1CS(2)(sample)));
         }
 
         for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
-            sqrtPredsCS2(candidate) = sqrt(c.p2CS(2)(candidate));
+            sqrtPredsCS2(candidate) = std::sqrt(static_cast<R>(c.p2CS(2)(candidate)));
         }
 
         bool zerodiv = false;
+        const long long noOfCandidatesLL = static_cast<long long>(noOfCandidates);
 
-        for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+        #pragma omp parallel for schedule(static) reduction(||:zerodiv) num_threads(WorkerThreads(threads))
+        for (long long candidate = 0; candidate < noOfCandidatesLL; candidate++) {
+
+            const T * p_acs = &(c.p12ACS(1)(0, candidate));
+            R * p_corr = &(correlations(0, candidate));
 
             for (size_t sample = 0; sample < samplesPerTrace; sample++) {
 
                 if (sqrtTracesCS2(sample) == 0 || sqrtPredsCS2(candidate) == 0) zerodiv = true;
 
-                correlations(sample, candidate) = c.p12ACS(1)(sample, candidate) / (sqrtTracesCS2(sample) * sqrtPredsCS2(candidate));
+                p_corr[sample] = static_cast<R>(p_acs[sample]) / (sqrtTracesCS2(sample) * sqrtPredsCS2(candidate));
 
             }
 
@@ -137,7 +407,7 @@ namespace SICAK {
 
     template <class T, class U, class V>
     //void UniHoCpaAddTraces(Moments2DContext<T>& c, const PowerTraces<U>& pt, const PowerPredictions<V>& pp, size_t attackOrder) {
-    void UniHoCpaAddTraces(Moments2DContext<T>& c, const U* tracesBuffer, const V* predictsBuffer, size_t noOfTraces, size_t noOfCandidates, size_t samplesPerTrace, size_t attackOrder) {
+    void UniHoCpaAddTraces(Moments2DContext<T>& c, const U* tracesBuffer, const V* predictsBuffer, size_t noOfTraces, size_t noOfCandidates, size_t samplesPerTrace, size_t attackOrder, size_t threads = 0) {
 
         if(c.p1MOrder() != 1 || c.p1CSOrder() != (2 * attackOrder) || c.p2CSOrder() != 2 || c.p12ACSOrder() != attackOrder || c.p1MOrder() != c.p2MOrder())
             qCritical("Not a valid higher-order univariate CPA context!", attackOrder);
@@ -156,18 +426,11 @@ namespace SICAK {
         if(attackOrder < 1)
             qCritical("Invalid order of the attack.");
 
-        //const long long noOfTraces = pt.noOfTraces();
-        //const long long samplesPerTrace = pt.samplesPerTrace();
-        //const long long noOfCandidates = pp.noOfCandidates();
-
-        // precomputed values
-        Matrix<T> deltaT(samplesPerTrace, 2 * attackOrder);
-        Matrix<T> deltaL(noOfCandidates, 1);
-        Matrix<T> minusDivN(2 * attackOrder, 1);
-        Matrix<T> nCr(2*attackOrder + 1, 2 * attackOrder + 1, 0);
-
+        typedef typename WorkType<T>::type W;
 
         // precompute combination numbers
+        Matrix<W> nCr(2*attackOrder + 1, 2 * attackOrder + 1, 0);
+
         for(size_t n = 0; n <= 2*attackOrder; n++){
             nCr(n, 0) = 1;
             for(size_t r = 1; r <= n; r++){
@@ -175,178 +438,219 @@ namespace SICAK {
             }
         }
 
+        // The samples x candidates plane is split into independent tiles, see UniFoCpaAddTraces
+        const int noOfThreads = WorkerThreads(threads);
+        size_t sampleBlocks, candidateBlocks;
+        CpaTileGrid(samplesPerTrace, noOfCandidates, noOfThreads, sampleBlocks, candidateBlocks);
+
+        // Single precision contexts: every tile accumulates its ACSs in a local double precision buffer of a bounded size
+        // and rounds them into the context once per call, instead of once per trace
+        const bool localAcs = !std::is_same<T, W>::value;
+        if (localAcs) {
+            const size_t maxTileCandidates = (noOfCandidates + candidateBlocks - 1) / candidateBlocks;
+            const size_t maxTileSamples = std::max<size_t>(CPA_LOCAL_ACS_ELEMENTS / (maxTileCandidates * attackOrder), 1);
+            sampleBlocks = std::max(sampleBlocks, (samplesPerTrace + maxTileSamples - 1) / maxTileSamples);
+        }
+        const long long noOfTiles = static_cast<long long>(sampleBlocks * candidateBlocks);
+        const size_t card = c.p1Card();
+        const size_t csOrder = 2 * attackOrder;
+
+        // The tiles read the initial statistics from the context, the updated ones are collected aside until all the tiles are done
+        Vector<W> newTracesAvg(samplesPerTrace);
+        Matrix<W> newTracesCS(samplesPerTrace, csOrder - 1);
+        Vector<W> newPredsAvg(noOfCandidates);
+        Vector<W> newPredsCS2(noOfCandidates);
+
+        #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+        for (long long tile = 0; tile < noOfTiles; tile++) {
+
+            size_t firstSample, lastSample, firstCandidate, lastCandidate;
+            SplitRange(samplesPerTrace, sampleBlocks, static_cast<size_t>(tile) % sampleBlocks, firstSample, lastSample);
+            SplitRange(noOfCandidates, candidateBlocks, static_cast<size_t>(tile) / sampleBlocks, firstCandidate, lastCandidate);
+            const size_t tileSamples = lastSample - firstSample;
+            const size_t tileCandidates = lastCandidate - firstCandidate;
+
+            // tile-local statistics of the samples (tracesCS column 'deg - 2' holds the CS of order 'deg') and of the predictions
+            Vector<W> tracesAvg(tileSamples);
+            Matrix<W> tracesCS(tileSamples, csOrder - 1);
+            Vector<W> predsAvg(tileCandidates);
+            Vector<W> predsCS2(tileCandidates);
+
+            std::copy_n(c.p1M(1).data() + firstSample, tileSamples, tracesAvg.data());
+            for (size_t deg = 2; deg <= csOrder; deg++) {
+                std::copy_n(c.p1CS(deg).data() + firstSample, tileSamples, &(tracesCS(0, deg - 2)));
+            }
+            std::copy_n(c.p2M(1).data() + firstCandidate, tileCandidates, predsAvg.data());
+            std::copy_n(c.p2CS(2).data() + firstCandidate, tileCandidates, predsCS2.data());
+
+            std::unique_ptr<Matrix<W>[]> tileAcs(localAcs ? new Matrix<W>[attackOrder] : nullptr);
+            for (size_t deg = 1; localAcs && deg <= attackOrder; deg++) {
+                tileAcs[deg - 1].init(tileSamples, tileCandidates);
+                for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
+                    std::copy_n(&(c.p12ACS(deg)(firstSample, firstCandidate + candidate)), tileSamples, &(tileAcs[deg - 1](0, candidate)));
+                }
+            }
 
-        // Add every power trace
-        for (size_t trace = 0; trace < noOfTraces; trace++) {
+            // ACSs of the given degree and candidate within the tile
+            auto acsRow = [&](size_t deg, size_t candidate) -> W * {
+                if constexpr (std::is_same<T, W>::value) {
+                    return &(c.p12ACS(deg)(firstSample, firstCandidate + candidate));
+                } else {
+                    return &(tileAcs[deg - 1](0, candidate));
+                }
+            };
 
-            T n = c.p1Card() + 1.0; // n = cardinality of the merged set
-            T divN = 1.0 / n;
+            // precomputed values
+            Matrix<W> deltaT(tileSamples, csOrder);
+            Matrix<W> deltaL(tileCandidates, 1);
+            Matrix<W> minusDivN(csOrder, 1);
 
-            {
-                //  precompute deltaT
-                T * p_deltaT = &(deltaT(0, 0));
-                //const U * p_pt = &(pt(0, trace));
-                const U * p_pt = tracesBuffer + trace*samplesPerTrace;
-                const T * p_tracesAvg = &( c.p1M(1)(0) );
-                for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+            // Add every power trace
+            for (size_t trace = 0; trace < noOfTraces; trace++) {
 
-                    (*p_deltaT++) = static_cast<T>((*p_pt++)) - (*p_tracesAvg++);
+                W n = (card + trace) + 1.0; // n = cardinality of the merged set
+                W divN = 1.0 / n;
 
-                }
+                {
+                    //  precompute deltaT
+                    VecConvertSub(&(deltaT(0, 0)), tracesBuffer + trace*samplesPerTrace + firstSample, tracesAvg.data(), tileSamples);
 
-                // and all its necessary powers
-                for (size_t order = 1; order < 2 * attackOrder; order++){
+                    // and all its necessary powers
+                    for (size_t order = 1; order < csOrder; order++){
 
-                    const T * p_firstDeltaT = &(deltaT(0, 0));
-                    const T * p_lastDeltaT = &(deltaT(0, order-1));
-                    p_deltaT = &(deltaT(0, order));
+                        VecMul(&(deltaT(0, order)), &(deltaT(0, order-1)), &(deltaT(0, 0)), tileSamples);
 
-                    for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-                        (*p_deltaT++) = (*p_lastDeltaT++) * (*p_firstDeltaT++);
                     }
 
-                }
+                    // also precompute deltaL
+                    W * p_deltaL = &(deltaL(0, 0));
+                    const V * p_pp = predictsBuffer + trace*noOfCandidates + firstCandidate;
+                    const W * p_predsAvg = predsAvg.data();
+                    for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
 
-                // also precompute deltaL
-                T * p_deltaL = &(deltaL(0, 0));
-                //const V * p_pp = &(pp(0, trace));
-                const V * p_pp = predictsBuffer + trace*noOfCandidates;
-                const T * p_predsAvg = &( c.p2M(1)(0) );
-                for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+                        (*p_deltaL++) = static_cast<W>(*p_pp++) - (*p_predsAvg++);
 
-                    (*p_deltaL++) = static_cast<T>(*p_pp++) - (*p_predsAvg++);
+                    }
 
-                }
+                    // precompute (-1*divN)^d
+                    minusDivN(0,0) = (-1.0) * divN;
+                    for (size_t order = 1; order < csOrder; order++){
 
-                // precompute (-1*divN)^d
-                minusDivN(0,0) = (-1.0) * divN;
-                for (size_t order = 1; order < 2 * attackOrder; order++){
+                        minusDivN(order, 0) = minusDivN(order-1, 0) * minusDivN(0,0);
 
-                    minusDivN(order, 0) = minusDivN(order-1, 0) * minusDivN(0,0);
+                    }
 
                 }
 
-            }
+                // update ACSs
+                for(size_t deg = attackOrder; deg >= 1; deg--){
 
-            // update ACSs
-            for(size_t deg = attackOrder; deg >= 1; deg--){
+                    const W p_beta = ( ( std::pow(-1.0, deg+1) * static_cast<W>(n-1) + std::pow(n-1, deg+1) ) / std::pow(n, deg+1) );
 
-                const T p_beta = ( ( std::pow(-1.0, deg+1) * static_cast<T>(n-1) + std::pow(n-1, deg+1) ) / std::pow(n, deg+1) );
+                    for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
 
-                #pragma omp parallel for
-                for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+                        W * p_acs = acsRow(deg, candidate);
+                        const W * p_deltaT = &( deltaT(0, deg - 1) );
+                        const W p_alpha = p_beta * deltaL(candidate, 0);
+                        const W p_gamma = ( (-1.0) * ( deltaL(candidate, 0) * divN ) );
 
-                    T * p_acs = &(c.p12ACS(deg)(0, candidate));
-                    const T * p_deltaT = &( deltaT(0, deg - 1) );
-                    const T * p_cs = (deg >= 2) ? &(c.p1CS(deg)(0)) : nullptr; // be sure not to dereference, unless deg is >= 2 !!!
-                    const T p_alpha = p_beta * deltaL(candidate, 0);
-                    const T p_gamma = ( (-1.0) * ( deltaL(candidate, 0) * divN ) );
+                        // the CS of order 1 is a constant zero, the branch is resolved outside of the sample loops
+                        if (deg >= 2) {
+                            VecAxpy2(p_acs, p_alpha, p_deltaT, p_gamma, &(tracesCS(0, deg - 2)), tileSamples);
+                        } else {
+                            VecAxpy(p_acs, p_alpha, p_deltaT, tileSamples);
+                        }
 
-                    for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+                        for(size_t p = 1; p <= deg - 1; p++){
 
-                        (*p_acs) += (p_alpha * (*p_deltaT++));
-                        (*p_acs) += (deg >= 2) ? (p_gamma * (*p_cs++)) : 0;
+                            const W * p_lessAcs = acsRow(deg - p, candidate);
+                            const W * p_lessCs = (deg-p >= 2) ? &(tracesCS(0, deg - p - 2)) : nullptr;
+                            const W p_delta = minusDivN(p - 1, 0) * nCr(deg, p);
 
-                        p_acs++;
+                            VecAddScaledSum(p_acs, p_lessAcs, p_gamma, p_lessCs, p_delta, &( deltaT(0, p - 1) ), tileSamples);
+
+                        }
 
                     }
 
-                    for(size_t p = 1; p <= deg - 1; p++){
+                }
 
-                        p_acs = &(c.p12ACS(deg)(0, candidate));
-                        const T * p_deltaTPow = &( deltaT(0, p - 1) );
-                        const T * p_lessAcs = &(c.p12ACS(deg - p)(0, candidate));
-                        const T * p_lessCs = (deg-p >= 2) ? &(c.p1CS(deg-p)(0)) : nullptr;
-                        const T p_delta = minusDivN(p - 1, 0) * nCr(deg, p);
+                // update traces CSs
+                for(size_t deg = csOrder; deg >= 2; deg--){
 
-                        for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+                    const W p_alpha = ( (n > 1) ? (1.0 - std::pow( (-1.0)/(n-1.0), deg-1 ) ) : 0 );
+                    const W p_beta = p_alpha * std::pow( ((n-1.0) * divN), deg);
+                    W * p_p1CSdeg = &(tracesCS(0, deg - 2));
 
-                            T sumTerm = (*p_lessAcs++);
-                            sumTerm += (deg-p >= 2) ? ( p_gamma * (*p_lessCs++) ) : 0;
+                    VecAxpy(p_p1CSdeg, p_beta, &( deltaT(0, deg - 1) ), tileSamples);
 
-                            sumTerm *= p_delta * (*p_deltaTPow++);
+                    for(size_t p = 1; p <= deg - 2; p++){
 
-                            (*p_acs++) += sumTerm;
+                        const W p_delta = minusDivN(p - 1, 0) * nCr(deg, p);
 
-                        }
+                        VecAxpyMul(p_p1CSdeg, &(tracesCS(0, deg - p - 2)), p_delta, &( deltaT(0, p - 1) ), tileSamples);
 
                     }
 
                 }
 
-            }
-
-            // update traces CSs
-            for(size_t deg = 2 * attackOrder; deg >= 2; deg--){
+                // update predictions CSs
+                for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
 
-                const T p_alpha = ( (n > 1) ? (1.0 - std::pow( (-1.0)/(n-1.0), deg-1 ) ) : 0 );
-                const T p_beta = p_alpha * std::pow( ((n-1.0) * divN), deg);
-                const T * p_deltaT = &( deltaT(0, deg - 1) );
-                T * p_p1CSdeg = &(c.p1CS(deg)(0));
+                    W deltaL2 = deltaL(candidate, 0);
 
-                for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-
-                    (*p_p1CSdeg++) += p_beta * (*p_deltaT++);
+                    predsCS2(candidate) += ((deltaL2 * deltaL2) * (n-1.0)) * divN;
 
                 }
 
-                for(size_t p = 1; p <= deg - 2; p++){
-
-                    const T * p_p1CSless = &( c.p1CS(deg-p)(0) );
-                    const T p_delta = minusDivN(p - 1, 0) * nCr(deg, p);
-                    const T * p_deltaTPow = &( deltaT(0, p - 1) );
-                    p_p1CSdeg = &(c.p1CS(deg)(0));
-
-                    for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+                // update Ms
+                VecAxpy(tracesAvg.data(), divN, &(deltaT(0, 0)), tileSamples);
 
-                        (*p_p1CSdeg++) += *(p_p1CSless++) * p_delta * (*p_deltaTPow++);
+                for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
 
-                    }
+                    predsAvg(candidate) += deltaL(candidate, 0) * divN;
 
                 }
 
             }
 
-            // update predictions CSs
-            for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
-
-                //T deltaL2 = static_cast<T>(pp(candidate, trace)) - c.p2M(1)(candidate);
-                T deltaL2 = static_cast<T>(*(predictsBuffer + trace*noOfCandidates + candidate)) - c.p2M(1)(candidate);
-
-                c.p2CS(2)(candidate) += ((deltaL2 * deltaL2) * (n-1.0)) * divN;
-
+            for (size_t deg = 1; localAcs && deg <= attackOrder; deg++) {
+                for (size_t candidate = 0; candidate < tileCandidates; candidate++) {
+                    std::copy_n(&(tileAcs[deg - 1](0, candidate)), tileSamples, &(c.p12ACS(deg)(firstSample, firstCandidate + candidate)));
+                }
             }
 
-            // update Ms
-            for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-
-                //T deltaT2 = static_cast<T>(pt(sample, trace)) - c.p1M(1)(sample);
-                T deltaT2 = static_cast<T>(*(tracesBuffer + trace*samplesPerTrace + sample)) - c.p1M(1)(sample);
-
-                c.p1M(1)(sample) += deltaT2 * divN;
-
+            // Every tile computed the same statistics of its samples/candidates, keep just one copy of them
+            if (firstCandidate == 0) {
+                std::copy_n(tracesAvg.data(), tileSamples, newTracesAvg.data() + firstSample);
+                for (size_t deg = 2; deg <= csOrder; deg++) {
+                    std::copy_n(&(tracesCS(0, deg - 2)), tileSamples, &(newTracesCS(firstSample, deg - 2)));
+                }
             }
 
-            for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
-
-                //T deltaL2 = static_cast<T>(pp(candidate, trace)) - c.p2M(1)(candidate);
-                T deltaL2 = static_cast<T>(*(predictsBuffer + trace*noOfCandidates + candidate)) - c.p2M(1)(candidate);
-
-                c.p2M(1)(candidate) += deltaL2 * divN;
-
+            if (firstSample == 0) {
+                std::copy_n(predsAvg.data(), tileCandidates, newPredsAvg.data() + firstCandidate);
+                std::copy_n(predsCS2.data(), tileCandidates, newPredsCS2.data() + firstCandidate);
             }
 
-            // update Card
-            c.p1Card() = c.p1Card() + 1;
+        }
 
+        std::copy_n(newTracesAvg.data(), samplesPerTrace, c.p1M(1).data());
+        for (size_t deg = 2; deg <= csOrder; deg++) {
+            std::copy_n(&(newTracesCS(0, deg - 2)), samplesPerTrace, c.p1CS(deg).data());
         }
+        std::copy_n(newPredsAvg.data(), noOfCandidates, c.p2M(1).data());
+        std::copy_n(newPredsCS2.data(), noOfCandidates, c.p2CS(2).data());
 
+        // update Card
+        c.p1Card() = card + noOfTraces;
         c.p2Card() = c.p1Card();
 
     }
 
-    template <class T>
-    void UniHoCpaComputeCorrelationMatrix(const Moments2DContext<T> & c, Matrix<T> & correlations, size_t attackOrder){
+    /// Computes the correlation matrix of the given order, the output type R may differ from the type of the context T
+    template <class T, class R = T>
+    void UniHoCpaComputeCorrelationMatrix(const Moments2DContext<T> & c, Matrix<R> & correlations, size_t attackOrder, size_t threads = 0){
 
         if(c.p1MOrder() != 1 || c.p1CSOrder() < attackOrder * 2 || c.p2CSOrder() != 2 || c.p12ACSOrder() < attackOrder || c.p1MOrder() != c.p2MOrder() || c.p1Card() != c.p2Card())
             qCritical("Not a valid higher-order univariate CPA context!", attackOrder);
@@ -357,56 +661,181 @@ namespace SICAK {
         size_t samplesPerTrace = c.p1Width();
         size_t noOfCandidates = c.p2Width();
 
-        T n = c.p1Card();
+        R n = c.p1Card();
 
         //if(n == 0) throw RuntimeException("Empty context.");
         if(n == 0) return;
 
         correlations.init(samplesPerTrace, noOfCandidates);
 
-        T divN = 1.0 / n;
+        R divN = 1.0 / n;
 
-        Vector<T> sqrtTracesCS(samplesPerTrace);
-        Vector<T> sqrtPredsCS(noOfCandidates);
+        Vector<R> sqrtTracesCS(samplesPerTrace);
+        Vector<R> sqrtPredsCS(noOfCandidates);
 
         // predictions variance
         for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
-            sqrtPredsCS(candidate) = std::sqrt(divN * c.p2CS(2)(candidate));
+            sqrtPredsCS(candidate) = std::sqrt(divN * static_cast<R>(c.p2CS(2)(candidate)));
         }
 
         // traces variance
         if(attackOrder == 1){
 
             for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-                sqrtTracesCS(sample) = std::sqrt(divN * c.p1CS(2)(sample));
+                sqrtTracesCS(sample) = std::sqrt(divN * static_cast<R>(c.p1CS(2)(sample)));
             }
 
         } else { // higher
 
             for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-                sqrtTracesCS(sample) = std::sqrt( c.p1CS(attackOrder*2)(sample) - ( std::pow(c.p1CS(attackOrder)(sample), 2) * divN) );
+                sqrtTracesCS(sample) = std::sqrt( static_cast<R>(c.p1CS(attackOrder*2)(sample)) - ( std::pow(static_cast<R>(c.p1CS(attackOrder)(sample)), 2) * divN) );
             }
 
         }
 
         bool zerodiv = false;
+        const long long noOfCandidatesLL = static_cast<long long>(noOfCandidates);
 
-        for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+        #pragma omp parallel for schedule(static) reduction(||:zerodiv) num_threads(WorkerThreads(threads))
+        for (long long candidate = 0; candidate < noOfCandidatesLL; candidate++) {
+
+            const T * p_acs = &(c.p12ACS(attackOrder)(0, candidate));
+            R * p_corr = &(correlations(0, candidate));
 
             for (size_t sample = 0; sample < samplesPerTrace; sample++) {
 
                 if (sqrtTracesCS(sample) == 0 || sqrtPredsCS(candidate) == 0) zerodiv = true;
 
-                correlations(sample, candidate) = (divN * c.p12ACS(attackOrder)(sample, candidate)) / (sqrtTracesCS(sample) * sqrtPredsCS(candidate));
+                p_corr[sample] = (divN * static_cast<R>(p_acs[sample])) / (sqrtTracesCS(sample) * sqrtPredsCS(candidate));
+
+            }
+
+        }
+
+        if(zerodiv) qCritical("Division by zero");
+
+    }
+
+    /// Finds the peak of the absolute correlation of every key candidate without storing the correlation matrix,
+    /// peaks(0, candidate) = max |r|, peaks(1, candidate) = index of the sample. Works with both the first-order and the higher-order contexts.
+    /// The type R has to hold the sample indices exactly, i.e. float is limited to traces of 2^24 samples.
+    template <class T, class R = T>
+    void UniCpaComputePeaks(const Moments2DContext<T> & c, Matrix<R> & peaks, size_t attackOrder, size_t threads = 0){
+
+        if(c.p1MOrder() != 1 || c.p1CSOrder() < attackOrder * 2 || c.p2CSOrder() != 2 || c.p12ACSOrder() < attackOrder || c.p1MOrder() != c.p2MOrder() || c.p1Card() != c.p2Card())
+            qCritical("Not a valid univariate CPA context!", attackOrder);
+
+        if(attackOrder < 1)
+            qCritical("Invalid order of the attack.", attackOrder);
+
+        size_t samplesPerTrace = c.p1Width();
+        size_t noOfCandidates = c.p2Width();
+
+        peaks.init(2, noOfCandidates, 0);
+
+        R n = c.p1Card();
+        if(n == 0) return;
+
+        R divN = 1.0 / n;
+
+        Vector<R> sqrtTracesCS(samplesPerTrace);
+        Vector<R> sqrtPredsCS(noOfCandidates);
+
+        for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+            sqrtPredsCS(candidate) = std::sqrt(divN * static_cast<R>(c.p2CS(2)(candidate)));
+        }
+
+        for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+            if(attackOrder == 1){
+                sqrtTracesCS(sample) = std::sqrt(divN * static_cast<R>(c.p1CS(2)(sample)));
+            } else {
+                sqrtTracesCS(sample) = std::sqrt( static_cast<R>(c.p1CS(attackOrder*2)(sample)) - ( std::pow(static_cast<R>(c.p1CS(attackOrder)(sample)), 2) * divN) );
+            }
+        }
+
+        bool zerodiv = false;
+        const long long noOfCandidatesLL = static_cast<long long>(noOfCandidates);
+
+        #pragma omp parallel for schedule(static) reduction(||:zerodiv) num_threads(WorkerThreads(threads))
+        for (long long candidate = 0; candidate < noOfCandidatesLL; candidate++) {
+
+            const T * p_acs = &(c.p12ACS(attackOrder)(0, candidate));
+            R maxCorr = 0;
+            size_t maxSample = 0;
+
+            for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+
+                if (sqrtTracesCS(sample) == 0 || sqrtPredsCS(candidate) == 0) {
+                    zerodiv = true;
+                    continue;
+                }
+
+                R corr = std::fabs((divN * static_cast<R>(p_acs[sample])) / (sqrtTracesCS(sample) * sqrtPredsCS(candidate)));
+
+                if (corr > maxCorr) {
+                    maxCorr = corr;
+                    maxSample = sample;
+                }
 
             }
 
+            peaks(0, candidate) = maxCorr;
+            peaks(1, candidate) = static_cast<R>(maxSample);
+
         }
 
         if(zerodiv) qCritical("Division by zero");
 
     }
 
+    /// Merges the peaks of a window of samples starting at 'sampleOffset' into the peaks of the whole traces (see UniCpaComputePeaks),
+    /// the window at the offset 0 starts over
+    template <class R>
+    void UniCpaMergePeaks(Matrix<R> & peaks, const Matrix<R> & windowPeaks, size_t sampleOffset){
+
+        size_t noOfCandidates = windowPeaks.rows();
+
+        if(sampleOffset == 0 || peaks.rows() != noOfCandidates) {
+            peaks.init(2, noOfCandidates, 0);
+        }
+
+        for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+            if (sampleOffset == 0 || windowPeaks(0, candidate) > peaks(0, candidate)) {
+                peaks(0, candidate) = windowPeaks(0, candidate);
+                peaks(1, candidate) = windowPeaks(1, candidate) + static_cast<R>(sampleOffset);
+            }
+        }
+
+    }
+
+    /// Ranks the key candidates by their peaks (see UniCpaComputePeaks), the 'k' best go first:
+    /// topK(0, rank) = key candidate, topK(1, rank) = max |r|, topK(2, rank) = index of the sample
+    template <class R>
+    void UniCpaRankPeaks(const Matrix<R> & peaks, Matrix<R> & topK, size_t k){
+
+        size_t noOfCandidates = peaks.rows();
+        k = std::min(k, noOfCandidates);
+
+        std::vector<size_t> order(noOfCandidates);
+        for (size_t candidate = 0; candidate < noOfCandidates; candidate++) {
+            order[candidate] = candidate;
+        }
+
+        // ties keep the lower key candidate first
+        std::partial_sort(order.begin(), order.begin() + k, order.end(), [&](size_t a, size_t b){
+            return (peaks(0, a) > peaks(0, b)) || (peaks(0, a) == peaks(0, b) && a < b);
+        });
+
+        topK.init(3, k);
+
+        for (size_t rank = 0; rank < k; rank++) {
+            topK(0, rank) = static_cast<R>(order[rank]);
+            topK(1, rank) = peaks(0, order[rank]);
+            topK(2, rank) = peaks(1, order[rank]);
+        }
+
+    }
+
 }
 
 #endif // CPA_HPP
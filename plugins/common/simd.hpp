@@ -0,0 +1,451 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SICAK_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__clang__)
+#define SICAK_TARGET(isa) __attribute__((target(isa)))
+#elif defined(__GNUC__)
+// AVX-512 implies FMA in GCC, the contraction would break the bit-exactness with the scalar kernels
+#define SICAK_TARGET(isa) __attribute__((target(isa), optimize("fp-contract=off")))
+#else
+#define SICAK_TARGET(isa)
+#endif
+
+namespace SICAK {
+
+    /* Vector kernels of the moment updates
+     *
+     * Every kernel has a scalar reference implementation and SSE2, AVX2 and AVX-512 variants, the variant is chosen at runtime
+     * according to the CPU. The vectorized variants perform exactly the same floating point operations in the same order
+     * as the scalar ones (no FMA contraction), i.e. their results are bit-identical. Only double precision is vectorized,
+     * other accumulator types always use the scalar kernels.
+     */
+
+    enum class SimdLevel { Scalar = 0, SSE2 = 1, AVX2 = 2, AVX512 = 3 };
+
+    /// Detects the best instruction set supported by the CPU and the OS
+    inline SimdLevel DetectSimdLevel() {
+#if defined(SICAK_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if(__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+        if(__builtin_cpu_supports("sse2")) return SimdLevel::SSE2;
+        return SimdLevel::Scalar;
+#elif defined(SICAK_SIMD_X86) && defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        __cpuid(info, 1);
+        const bool sse2 = (info[3] & (1 << 26)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+        const bool avxState = (xcr0 & 0x6) == 0x6;
+        const bool avx512State = (xcr0 & 0xe6) == 0xe6;
+        bool avx2 = false, avx512 = false;
+        if(maxLeaf >= 7) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+            avx512 = (info[1] & (1 << 16)) != 0;
+        }
+        if(avx512 && avx512State) return SimdLevel::AVX512;
+        if(avx2 && avxState) return SimdLevel::AVX2;
+        if(sse2) return SimdLevel::SSE2;
+        return SimdLevel::Scalar;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    /// The instruction set used by the kernels, may be lowered (e.g. to SimdLevel::Scalar to get the reference results)
+    inline SimdLevel & ActiveSimdLevel() {
+        static SimdLevel level = DetectSimdLevel();
+        return level;
+    }
+
+    /* Scalar reference kernels */
+
+    /// dst = src - avg
+    template <class T, class U>
+    inline void ScalarConvertSub(T * dst, const U * src, const T * avg, size_t n) {
+        for(size_t i = 0; i < n; i++) dst[i] = static_cast<T>(src[i]) - avg[i];
+    }
+
+    /// dst = a * b
+    template <class T>
+    inline void ScalarMul(T * dst, const T * a, const T * b, size_t n) {
+        for(size_t i = 0; i < n; i++) dst[i] = a[i] * b[i];
+    }
+
+    /// y += alpha * x
+    template <class T>
+    inline void ScalarAxpy(T * y, T alpha, const T * x, size_t n) {
+        for(size_t i = 0; i < n; i++) y[i] += alpha * x[i];
+    }
+
+    /// y += x * alpha * z
+    template <class T>
+    inline void ScalarAxpyMul(T * y, const T * x, T alpha, const T * z, size_t n) {
+        for(size_t i = 0; i < n; i++) y[i] += x[i] * alpha * z[i];
+    }
+
+    /// y += alpha * x; y += gamma * z
+    template <class T>
+    inline void ScalarAxpy2(T * y, T alpha, const T * x, T gamma, const T * z, size_t n) {
+        for(size_t i = 0; i < n; i++) {
+            y[i] += alpha * x[i];
+            y[i] += gamma * z[i];
+        }
+    }
+
+    /// y += (a + gamma * z) * (delta * w), the 'gamma * z' term is omitted when z is nullptr
+    template <class T>
+    inline void ScalarAddScaledSum(T * y, const T * a, T gamma, const T * z, T delta, const T * w, size_t n) {
+        if(z != nullptr) {
+            for(size_t i = 0; i < n; i++) y[i] += (a[i] + gamma * z[i]) * (delta * w[i]);
+        } else {
+            for(size_t i = 0; i < n; i++) y[i] += a[i] * (delta * w[i]);
+        }
+    }
+
+    /// y += alpha * (src - avg)
+    template <class T, class U>
+    inline void ScalarAxpyConvertSub(T * y, T alpha, const U * src, const T * avg, size_t n) {
+        for(size_t i = 0; i < n; i++) y[i] += alpha * (static_cast<T>(src[i]) - avg[i]);
+    }
+
+#ifdef SICAK_SIMD_X86
+
+    /* SSE2 kernels, 2 doubles per vector */
+
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const double * p) { return _mm_loadu_pd(p); }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const float * p) { return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const int32_t * p) { return _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))); }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const uint32_t * p) {
+        // shift into the signed range and back, all the 32-bit integers are exact in double
+        __m128i v = _mm_xor_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)), _mm_set1_epi32(INT32_MIN));
+        return _mm_add_pd(_mm_cvtepi32_pd(v), _mm_set1_pd(2147483648.0));
+    }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const int16_t * p) {
+        int32_t raw; std::memcpy(&raw, p, sizeof(raw));
+        __m128i v = _mm_cvtsi32_si128(raw);
+        return _mm_cvtepi32_pd(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+    }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const uint16_t * p) {
+        int32_t raw; std::memcpy(&raw, p, sizeof(raw));
+        return _mm_cvtepi32_pd(_mm_unpacklo_epi16(_mm_cvtsi32_si128(raw), _mm_setzero_si128()));
+    }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const int8_t * p) {
+        int16_t raw; std::memcpy(&raw, p, sizeof(raw));
+        __m128i v = _mm_cvtsi32_si128(raw);
+        v = _mm_unpacklo_epi8(v, v);
+        return _mm_cvtepi32_pd(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 24));
+    }
+    SICAK_TARGET("sse2") inline __m128d Sse2Load(const uint8_t * p) {
+        uint16_t raw; std::memcpy(&raw, p, sizeof(raw));
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(raw), _mm_setzero_si128());
+        return _mm_cvtepi32_pd(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+    }
+
+    template <class U>
+    SICAK_TARGET("sse2") void Sse2ConvertSub(double * dst, const U * src, const double * avg, size_t n) {
+        size_t i = 0;
+        for(; i + 2 <= n; i += 2) _mm_storeu_pd(dst + i, _mm_sub_pd(Sse2Load(src + i), _mm_loadu_pd(avg + i)));
+        ScalarConvertSub(dst + i, src + i, avg + i, n - i);
+    }
+
+    SICAK_TARGET("sse2") inline void Sse2Mul(double * dst, const double * a, const double * b, size_t n) {
+        size_t i = 0;
+        for(; i + 2 <= n; i += 2) _mm_storeu_pd(dst + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+        ScalarMul(dst + i, a + i, b + i, n - i);
+    }
+
+    SICAK_TARGET("sse2") inline void Sse2Axpy(double * y, double alpha, const double * x, size_t n) {
+        const __m128d va = _mm_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+        ScalarAxpy(y + i, alpha, x + i, n - i);
+    }
+
+    SICAK_TARGET("sse2") inline void Sse2AxpyMul(double * y, const double * x, double alpha, const double * z, size_t n) {
+        const __m128d va = _mm_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_mul_pd(_mm_loadu_pd(x + i), va), _mm_loadu_pd(z + i))));
+        ScalarAxpyMul(y + i, x + i, alpha, z + i, n - i);
+    }
+
+    SICAK_TARGET("sse2") inline void Sse2Axpy2(double * y, double alpha, const double * x, double gamma, const double * z, size_t n) {
+        const __m128d va = _mm_set1_pd(alpha);
+        const __m128d vg = _mm_set1_pd(gamma);
+        size_t i = 0;
+        for(; i + 2 <= n; i += 2) {
+            __m128d vy = _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i)));
+            _mm_storeu_pd(y + i, _mm_add_pd(vy, _mm_mul_pd(vg, _mm_loadu_pd(z + i))));
+        }
+        ScalarAxpy2(y + i, alpha, x + i, gamma, z + i, n - i);
+    }
+
+    SICAK_TARGET("sse2") inline void Sse2AddScaledSum(double * y, const double * a, double gamma, const double * z, double delta, const double * w, size_t n) {
+        const __m128d vg = _mm_set1_pd(gamma);
+        const __m128d vd = _mm_set1_pd(delta);
+        size_t i = 0;
+        if(z != nullptr) {
+            for(; i + 2 <= n; i += 2) {
+                __m128d sum = _mm_add_pd(_mm_loadu_pd(a + i), _mm_mul_pd(vg, _mm_loadu_pd(z + i)));
+                _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(sum, _mm_mul_pd(vd, _mm_loadu_pd(w + i)))));
+            }
+        } else {
+            for(; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_loadu_pd(a + i), _mm_mul_pd(vd, _mm_loadu_pd(w + i)))));
+            }
+        }
+        ScalarAddScaledSum(y + i, a + i, gamma, (z != nullptr) ? z + i : nullptr, delta, w + i, n - i);
+    }
+
+    template <class U>
+    SICAK_TARGET("sse2") void Sse2AxpyConvertSub(double * y, double alpha, const U * src, const double * avg, size_t n) {
+        const __m128d va = _mm_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_sub_pd(Sse2Load(src + i), _mm_loadu_pd(avg + i)))));
+        ScalarAxpyConvertSub(y + i, alpha, src + i, avg + i, n - i);
+    }
+
+    /* AVX2 kernels, 4 doubles per vector */
+
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const double * p) { return _mm256_loadu_pd(p); }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const float * p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const int32_t * p) { return _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))); }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const uint32_t * p) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), _mm_set1_epi32(INT32_MIN));
+        return _mm256_add_pd(_mm256_cvtepi32_pd(v), _mm256_set1_pd(2147483648.0));
+    }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const int16_t * p) { return _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const uint16_t * p) { return _mm256_cvtepi32_pd(_mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const int8_t * p) {
+        int32_t raw; std::memcpy(&raw, p, sizeof(raw));
+        return _mm256_cvtepi32_pd(_mm_cvtepi8_epi32(_mm_cvtsi32_si128(raw)));
+    }
+    SICAK_TARGET("avx2") inline __m256d Avx2Load(const uint8_t * p) {
+        int32_t raw; std::memcpy(&raw, p, sizeof(raw));
+        return _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(raw)));
+    }
+
+    template <class U>
+    SICAK_TARGET("avx2") void Avx2ConvertSub(double * dst, const U * src, const double * avg, size_t n) {
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4) _mm256_storeu_pd(dst + i, _mm256_sub_pd(Avx2Load(src + i), _mm256_loadu_pd(avg + i)));
+        ScalarConvertSub(dst + i, src + i, avg + i, n - i);
+    }
+
+    SICAK_TARGET("avx2") inline void Avx2Mul(double * dst, const double * a, const double * b, size_t n) {
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4) _mm256_storeu_pd(dst + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        ScalarMul(dst + i, a + i, b + i, n - i);
+    }
+
+    SICAK_TARGET("avx2") inline void Avx2Axpy(double * y, double alpha, const double * x, size_t n) {
+        const __m256d va = _mm256_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(va, _mm256_loadu_pd(x + i))));
+        ScalarAxpy(y + i, alpha, x + i, n - i);
+    }
+
+    SICAK_TARGET("avx2") inline void Avx2AxpyMul(double * y, const double * x, double alpha, const double * z, size_t n) {
+        const __m256d va = _mm256_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(x + i), va), _mm256_loadu_pd(z + i))));
+        ScalarAxpyMul(y + i, x + i, alpha, z + i, n - i);
+    }
+
+    SICAK_TARGET("avx2") inline void Avx2Axpy2(double * y, double alpha, const double * x, double gamma, const double * z, size_t n) {
+        const __m256d va = _mm256_set1_pd(alpha);
+        const __m256d vg = _mm256_set1_pd(gamma);
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4) {
+            __m256d vy = _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(va, _mm256_loadu_pd(x + i)));
+            _mm256_storeu_pd(y + i, _mm256_add_pd(vy, _mm256_mul_pd(vg, _mm256_loadu_pd(z + i))));
+        }
+        ScalarAxpy2(y + i, alpha, x + i, gamma, z + i, n - i);
+    }
+
+    SICAK_TARGET("avx2") inline void Avx2AddScaledSum(double * y, const double * a, double gamma, const double * z, double delta, const double * w, size_t n) {
+        const __m256d vg = _mm256_set1_pd(gamma);
+        const __m256d vd = _mm256_set1_pd(delta);
+        size_t i = 0;
+        if(z != nullptr) {
+            for(; i + 4 <= n; i += 4) {
+                __m256d sum = _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_mul_pd(vg, _mm256_loadu_pd(z + i)));
+                _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(sum, _mm256_mul_pd(vd, _mm256_loadu_pd(w + i)))));
+            }
+        } else {
+            for(; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_mul_pd(vd, _mm256_loadu_pd(w + i)))));
+            }
+        }
+        ScalarAddScaledSum(y + i, a + i, gamma, (z != nullptr) ? z + i : nullptr, delta, w + i, n - i);
+    }
+
+    template <class U>
+    SICAK_TARGET("avx2") void Avx2AxpyConvertSub(double * y, double alpha, const U * src, const double * avg, size_t n) {
+        const __m256d va = _mm256_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(va, _mm256_sub_pd(Avx2Load(src + i), _mm256_loadu_pd(avg + i)))));
+        ScalarAxpyConvertSub(y + i, alpha, src + i, avg + i, n - i);
+    }
+
+    /* AVX-512 kernels, 8 doubles per vector */
+
+    // The conversions use the zero-masked forms, the unmasked ones pass an undefined vector through (-Wmaybe-uninitialized)
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const double * p) { return _mm512_loadu_pd(p); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const float * p) { return _mm512_maskz_cvtps_pd(0xFF, _mm256_loadu_ps(p)); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const int32_t * p) { return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const uint32_t * p) { return _mm512_maskz_cvtepu32_pd(0xFF, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const int16_t * p) { return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)))); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const uint16_t * p) { return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)))); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const int8_t * p) { return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_cvtepi8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+    SICAK_TARGET("avx512f") inline __m512d Avx512Load(const uint8_t * p) { return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p)))); }
+
+    template <class U>
+    SICAK_TARGET("avx512f") void Avx512ConvertSub(double * dst, const U * src, const double * avg, size_t n) {
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8) _mm512_storeu_pd(dst + i, _mm512_sub_pd(Avx512Load(src + i), _mm512_loadu_pd(avg + i)));
+        ScalarConvertSub(dst + i, src + i, avg + i, n - i);
+    }
+
+    SICAK_TARGET("avx512f") inline void Avx512Mul(double * dst, const double * a, const double * b, size_t n) {
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8) _mm512_storeu_pd(dst + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+        ScalarMul(dst + i, a + i, b + i, n - i);
+    }
+
+    SICAK_TARGET("avx512f") inline void Avx512Axpy(double * y, double alpha, const double * x, size_t n) {
+        const __m512d va = _mm512_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8) _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(va, _mm512_loadu_pd(x + i))));
+        ScalarAxpy(y + i, alpha, x + i, n - i);
+    }
+
+    SICAK_TARGET("avx512f") inline void Avx512AxpyMul(double * y, const double * x, double alpha, const double * z, size_t n) {
+        const __m512d va = _mm512_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8) _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(_mm512_mul_pd(_mm512_loadu_pd(x + i), va), _mm512_loadu_pd(z + i))));
+        ScalarAxpyMul(y + i, x + i, alpha, z + i, n - i);
+    }
+
+    SICAK_TARGET("avx512f") inline void Avx512Axpy2(double * y, double alpha, const double * x, double gamma, const double * z, size_t n) {
+        const __m512d va = _mm512_set1_pd(alpha);
+        const __m512d vg = _mm512_set1_pd(gamma);
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8) {
+            __m512d vy = _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(va, _mm512_loadu_pd(x + i)));
+            _mm512_storeu_pd(y + i, _mm512_add_pd(vy, _mm512_mul_pd(vg, _mm512_loadu_pd(z + i))));
+        }
+        ScalarAxpy2(y + i, alpha, x + i, gamma, z + i, n - i);
+    }
+
+    SICAK_TARGET("avx512f") inline void Avx512AddScaledSum(double * y, const double * a, double gamma, const double * z, double delta, const double * w, size_t n) {
+        const __m512d vg = _mm512_set1_pd(gamma);
+        const __m512d vd = _mm512_set1_pd(delta);
+        size_t i = 0;
+        if(z != nullptr) {
+            for(; i + 8 <= n; i += 8) {
+                __m512d sum = _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_mul_pd(vg, _mm512_loadu_pd(z + i)));
+                _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(sum, _mm512_mul_pd(vd, _mm512_loadu_pd(w + i)))));
+            }
+        } else {
+            for(; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_mul_pd(vd, _mm512_loadu_pd(w + i)))));
+            }
+        }
+        ScalarAddScaledSum(y + i, a + i, gamma, (z != nullptr) ? z + i : nullptr, delta, w + i, n - i);
+    }
+
+    template <class U>
+    SICAK_TARGET("avx512f") void Avx512AxpyConvertSub(double * y, double alpha, const U * src, const double * avg, size_t n) {
+        const __m512d va = _mm512_set1_pd(alpha);
+        size_t i = 0;
+        for(; i + 8 <= n; i += 8) _mm512_storeu_pd(y + i, _mm512_add_pd(_mm512_loadu_pd(y + i), _mm512_mul_pd(va, _mm512_sub_pd(Avx512Load(src + i), _mm512_loadu_pd(avg + i)))));
+        ScalarAxpyConvertSub(y + i, alpha, src + i, avg + i, n - i);
+    }
+
+#endif // SICAK_SIMD_X86
+
+    /* Dispatching kernels, generic accumulator types use the scalar kernels, double precision is vectorized */
+
+#ifdef SICAK_SIMD_X86
+#define SICAK_SIMD_DISPATCH(kernel, ...) \
+    switch(ActiveSimdLevel()) { \
+        case SimdLevel::AVX512: Avx512##kernel(__VA_ARGS__); return; \
+        case SimdLevel::AVX2: Avx2##kernel(__VA_ARGS__); return; \
+        case SimdLevel::SSE2: Sse2##kernel(__VA_ARGS__); return; \
+        default: break; \
+    } \
+    Scalar##kernel(__VA_ARGS__);
+#else
+#define SICAK_SIMD_DISPATCH(kernel, ...) Scalar##kernel(__VA_ARGS__);
+#endif
+
+    template <class T, class U>
+    inline void VecConvertSub(T * dst, const U * src, const T * avg, size_t n) { ScalarConvertSub(dst, src, avg, n); }
+    template <class U>
+    inline void VecConvertSub(double * dst, const U * src, const double * avg, size_t n) { SICAK_SIMD_DISPATCH(ConvertSub, dst, src, avg, n) }
+
+    template <class T>
+    inline void VecMul(T * dst, const T * a, const T * b, size_t n) { ScalarMul(dst, a, b, n); }
+    inline void VecMul(double * dst, const double * a, const double * b, size_t n) { SICAK_SIMD_DISPATCH(Mul, dst, a, b, n) }
+
+    template <class T>
+    inline void VecAxpy(T * y, T alpha, const T * x, size_t n) { ScalarAxpy(y, alpha, x, n); }
+    inline void VecAxpy(double * y, double alpha, const double * x, size_t n) { SICAK_SIMD_DISPATCH(Axpy, y, alpha, x, n) }
+
+    template <class T>
+    inline void VecAxpyMul(T * y, const T * x, T alpha, const T * z, size_t n) { ScalarAxpyMul(y, x, alpha, z, n); }
+    inline void VecAxpyMul(double * y, const double * x, double alpha, const double * z, size_t n) { SICAK_SIMD_DISPATCH(AxpyMul, y, x, alpha, z, n) }
+
+    template <class T>
+    inline void VecAxpy2(T * y, T alpha, const T * x, T gamma, const T * z, size_t n) { ScalarAxpy2(y, alpha, x, gamma, z, n); }
+    inline void VecAxpy2(double * y, double alpha, const double * x, double gamma, const double * z, size_t n) { SICAK_SIMD_DISPATCH(Axpy2, y, alpha, x, gamma, z, n) }
+
+    template <class T>
+    inline void VecAddScaledSum(T * y, const T * a, T gamma, const T * z, T delta, const T * w, size_t n) { ScalarAddScaledSum(y, a, gamma, z, delta, w, n); }
+    inline void VecAddScaledSum(double * y, const double * a, double gamma, const double * z, double delta, const double * w, size_t n) { SICAK_SIMD_DISPATCH(AddScaledSum, y, a, gamma, z, delta, w, n) }
+
+    template <class T, class U>
+    inline void VecAxpyConvertSub(T * y, T alpha, const U * src, const T * avg, size_t n) { ScalarAxpyConvertSub(y, alpha, src, avg, n); }
+    template <class U>
+    inline void VecAxpyConvertSub(double * y, double alpha, const U * src, const double * avg, size_t n) { SICAK_SIMD_DISPATCH(AxpyConvertSub, y, alpha, src, avg, n) }
+
+#undef SICAK_SIMD_DISPATCH
+
+}
+
+#endif // SIMD_HPP
@@ -0,0 +1,443 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TCONTEXTCHECKPOINT_HPP
+#define TCONTEXTCHECKPOINT_HPP
+
+#include <QtGlobal>
+#include <QString>
+#include <QStringList>
+#include <QFileInfo>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include <hdf5.h>
+
+#include "typesmoment.hpp"
+
+/// Checkpoint of the accumulated moment contexts in a group of a HDF5 file.
+/// The group holds the format version and the device name as attributes, every context is a subgroup
+/// with its configuration and cardinalities as attributes and one dataset per array of the context.
+/// A new checkpoint is written into a sibling group, which replaces the previous checkpoint on commit; a failed save keeps
+/// the previous checkpoint. HDF5 does not reclaim the space of the replaced group, so the file grows with every save.
+class TContextCheckpoint {
+
+public:
+
+    /// Version of the checkpoint layout, checkpoints of other versions are refused
+    static const quint64 FORMAT_VERSION = 1;
+
+    TContextCheckpoint(): m_file(H5I_INVALID_HID), m_group(H5I_INVALID_HID) {}
+
+    virtual ~TContextCheckpoint() { close(); }
+
+    TContextCheckpoint(const TContextCheckpoint &) = delete;
+    TContextCheckpoint & operator=(const TContextCheckpoint &) = delete;
+
+    /// Opens the file for writing (a new file is created when missing) and starts a new checkpoint in a sibling of the group,
+    /// the checkpoint replaces the group on commit
+    virtual bool create(const QString & filePath, const QString & groupPath, const QString & device) {
+
+        close();
+
+        if(QFileInfo::exists(filePath)) {
+            if(H5Fis_hdf5(filePath.toUtf8().constData()) <= 0) {
+                qCritical("The checkpoint file exists and it is not a HDF5 file");
+                return false;
+            }
+            m_file = H5Fopen(filePath.toUtf8().constData(), H5F_ACC_RDWR, H5P_DEFAULT);
+        } else {
+            m_file = H5Fcreate(filePath.toUtf8().constData(), H5F_ACC_EXCL, H5P_DEFAULT, H5P_DEFAULT);
+        }
+
+        if(m_file < 0) {
+            qCritical("Failed to open the checkpoint file for writing");
+            return false;
+        }
+
+        m_groupPath = groupPath;
+        m_savingPath = groupPath + SAVING_SUFFIX;
+
+        // the leftover of a failed save
+        if(linkExists(m_file, m_savingPath) && H5Ldelete(m_file, m_savingPath.toUtf8().constData(), H5P_DEFAULT) < 0) {
+            qCritical("Failed to remove an incomplete checkpoint group");
+            close();
+            return false;
+        }
+
+        hid_t linkProps = H5Pcreate(H5P_LINK_CREATE);
+        H5Pset_create_intermediate_group(linkProps, 1);
+        m_group = H5Gcreate2(m_file, m_savingPath.toUtf8().constData(), linkProps, H5P_DEFAULT, H5P_DEFAULT);
+        H5Pclose(linkProps);
+
+        if(m_group < 0) {
+            qCritical("Failed to create the checkpoint group");
+            close();
+            return false;
+        }
+
+        if(!writeAttribute(m_group, "format_version", FORMAT_VERSION) || !writeAttribute(m_group, "device", device)) {
+            close();
+            return false;
+        }
+
+        return true;
+
+    }
+
+    /// Opens the group of an existing file for reading, checks the format version and the device
+    virtual bool open(const QString & filePath, const QString & groupPath, const QString & device) {
+
+        close();
+
+        if(!QFileInfo::exists(filePath) || H5Fis_hdf5(filePath.toUtf8().constData()) <= 0) {
+            qCritical("The checkpoint file does not exist or it is not a HDF5 file");
+            return false;
+        }
+
+        m_file = H5Fopen(filePath.toUtf8().constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
+        if(m_file < 0) {
+            qCritical("Failed to open the checkpoint file");
+            return false;
+        }
+
+        if(!linkExists(m_file, groupPath) || (m_group = H5Gopen2(m_file, groupPath.toUtf8().constData(), H5P_DEFAULT)) < 0) {
+            qCritical("The checkpoint group was not found in the file");
+            close();
+            return false;
+        }
+
+        quint64 version = 0;
+        QString storedDevice;
+
+        if(!readAttribute(m_group, "format_version", version) || version != FORMAT_VERSION) {
+            qCritical("Unsupported format version of the checkpoint");
+            close();
+            return false;
+        }
+
+        if(!readAttribute(m_group, "device", storedDevice) || storedDevice != device) {
+            qCritical("The checkpoint was saved by a different analytic device");
+            close();
+            return false;
+        }
+
+        return true;
+
+    }
+
+    /// Replaces the group with the new checkpoint and closes the file
+    virtual bool commit() {
+
+        if(m_group < 0 || m_savingPath.isEmpty()) {
+            qCritical("No checkpoint is being saved");
+            return false;
+        }
+
+        H5Gclose(m_group);
+        m_group = H5I_INVALID_HID;
+
+        const QByteArray group = m_groupPath.toUtf8();
+
+        const bool deleted = !linkExists(m_file, m_groupPath) || H5Ldelete(m_file, group.constData(), H5P_DEFAULT) >= 0;
+
+        if(!deleted || H5Lmove(m_file, m_savingPath.toUtf8().constData(), m_file, group.constData(), H5P_DEFAULT, H5P_DEFAULT) < 0) {
+            qCritical("Failed to replace the checkpoint group");
+            // without the previous checkpoint the new one is kept in the sibling group
+            if(deleted) m_savingPath.clear();
+            close();
+            return false;
+        }
+
+        m_savingPath.clear();
+
+        const bool ok = H5Fflush(m_file, H5F_SCOPE_GLOBAL) >= 0;
+        close();
+
+        if(!ok) {
+            qCritical("Failed to flush the checkpoint file");
+        }
+
+        return ok;
+
+    }
+
+    /// Closes the file, a checkpoint that was not committed is removed
+    virtual void close() {
+        if(m_group >= 0) H5Gclose(m_group);
+        if(m_file >= 0 && !m_savingPath.isEmpty() && linkExists(m_file, m_savingPath)) H5Ldelete(m_file, m_savingPath.toUtf8().constData(), H5P_DEFAULT);
+        if(m_file >= 0) H5Fclose(m_file);
+        m_group = H5I_INVALID_HID;
+        m_file = H5I_INVALID_HID;
+        m_groupPath.clear();
+        m_savingPath.clear();
+    }
+
+    /// Attributes of the checkpoint group, e.g., the configuration of the device
+    virtual bool writeAttribute(const QString & name, quint64 value) { return writeAttribute(m_group, name, value); }
+    virtual bool readAttribute(const QString & name, quint64 & value) const { return readAttribute(m_group, name, value); }
+
+    /// Writes the configuration, the cardinalities and the arrays of the context into a subgroup
+    template <class T>
+    bool writeContext(const QString & name, const SICAK::Moments2DContext<T> & context) {
+
+        hid_t group = H5Gcreate2(m_group, name.toUtf8().constData(), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        if(group < 0) {
+            qCritical("Failed to create the context group in the checkpoint");
+            return false;
+        }
+
+        bool ok = writeAttribute(group, "p1_width", context.p1Width())
+               && writeAttribute(group, "p2_width", context.p2Width())
+               && writeAttribute(group, "p1_m_order", context.p1MOrder())
+               && writeAttribute(group, "p2_m_order", context.p2MOrder())
+               && writeAttribute(group, "p1_cs_order", context.p1CSOrder())
+               && writeAttribute(group, "p2_cs_order", context.p2CSOrder())
+               && writeAttribute(group, "p12_acs_order", context.p12ACSOrder())
+               && writeAttribute(group, "p1_card", context.p1Card())
+               && writeAttribute(group, "p2_card", context.p2Card());
+
+        size_t index = 0;
+
+        context.forEachBuffer([&](const T * data, size_t length){
+
+            if(!ok) return;
+
+            hsize_t dims[1] = { static_cast<hsize_t>(length) };
+            hid_t space = H5Screate_simple(1, dims, nullptr);
+            hid_t dataset = H5Dcreate2(group, bufferName(index++).constData(), nativeType<T>(), space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+
+            ok = dataset >= 0 && H5Dwrite(dataset, nativeType<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data) >= 0;
+
+            if(dataset >= 0) H5Dclose(dataset);
+            H5Sclose(space);
+
+        });
+
+        H5Gclose(group);
+
+        if(!ok) {
+            qCritical("Failed to write the context into the checkpoint");
+        }
+
+        return ok;
+
+    }
+
+    /// Reads the context from a subgroup, the context must already be initialized to the stored configuration.
+    /// The arrays are converted when the checkpoint was saved in the other precision.
+    template <class T>
+    bool readContext(const QString & name, SICAK::Moments2DContext<T> & context) {
+
+        if(!linkExists(m_group, name)) {
+            qCritical("The context was not found in the checkpoint");
+            return false;
+        }
+
+        hid_t group = H5Gopen2(m_group, name.toUtf8().constData(), H5P_DEFAULT);
+        if(group < 0) {
+            qCritical("Failed to open the context group in the checkpoint");
+            return false;
+        }
+
+        quint64 p1Width, p2Width, p1MOrder, p2MOrder, p1CSOrder, p2CSOrder, p12ACSOrder, p1Card, p2Card;
+
+        bool ok = readAttribute(group, "p1_width", p1Width)
+               && readAttribute(group, "p2_width", p2Width)
+               && readAttribute(group, "p1_m_order", p1MOrder)
+               && readAttribute(group, "p2_m_order", p2MOrder)
+               && readAttribute(group, "p1_cs_order", p1CSOrder)
+               && readAttribute(group, "p2_cs_order", p2CSOrder)
+               && readAttribute(group, "p12_acs_order", p12ACSOrder)
+               && readAttribute(group, "p1_card", p1Card)
+               && readAttribute(group, "p2_card", p2Card);
+
+        if(ok && (p1Width != context.p1Width() || p2Width != context.p2Width()
+                  || p1MOrder != context.p1MOrder() || p2MOrder != context.p2MOrder()
+                  || p1CSOrder != context.p1CSOrder() || p2CSOrder != context.p2CSOrder()
+                  || p12ACSOrder != context.p12ACSOrder())) {
+            qCritical("The context in the checkpoint does not match the configuration of the device");
+            H5Gclose(group);
+            return false;
+        }
+
+        size_t index = 0;
+
+        context.forEachBuffer([&](T * data, size_t length){
+
+            if(!ok) return;
+
+            hid_t dataset = H5Dopen2(group, bufferName(index++).constData(), H5P_DEFAULT);
+            if(dataset < 0) {
+                ok = false;
+                return;
+            }
+
+            hid_t space = H5Dget_space(dataset);
+            ok = H5Sget_simple_extent_npoints(space) == static_cast<hssize_t>(length)
+              && H5Dread(dataset, nativeType<T>(), H5S_ALL, H5S_ALL, H5P_DEFAULT, data) >= 0;
+
+            H5Sclose(space);
+            H5Dclose(dataset);
+
+        });
+
+        H5Gclose(group);
+
+        if(!ok) {
+            qCritical("Failed to read the context from the checkpoint");
+            return false;
+        }
+
+        context.p1Card() = p1Card;
+        context.p2Card() = p2Card;
+
+        return true;
+
+    }
+
+protected:
+
+    /// Appended to the group path to name the group of a checkpoint being saved
+    static constexpr const char * SAVING_SUFFIX = "_saving";
+
+    template <class T>
+    static hid_t nativeType() {
+        static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value, "Only float and double contexts can be checkpointed");
+        return std::is_same<T, float>::value ? H5T_NATIVE_FLOAT : H5T_NATIVE_DOUBLE;
+    }
+
+    static QByteArray bufferName(size_t index) {
+        return QString("buffer_%1").arg(index, 3, 10, QChar('0')).toUtf8();
+    }
+
+    /// Checks the path component by component, missing intermediate groups are not an error
+    static bool linkExists(hid_t location, const QString & path) {
+
+        const QStringList parts = path.split('/', Qt::SkipEmptyParts);
+        QString current = path.startsWith('/') ? QString("") : QString(".");
+
+        for(const QString & part : parts) {
+            current += "/" + part;
+            if(H5Lexists(location, current.toUtf8().constData(), H5P_DEFAULT) <= 0)
+                return false;
+        }
+
+        return !parts.isEmpty();
+
+    }
+
+    static bool writeAttribute(hid_t location, const QString & name, quint64 value) {
+
+        hid_t space = H5Screate(H5S_SCALAR);
+        hid_t attribute = H5Acreate2(location, name.toUtf8().constData(), H5T_NATIVE_UINT64, space, H5P_DEFAULT, H5P_DEFAULT);
+        bool ok = attribute >= 0 && H5Awrite(attribute, H5T_NATIVE_UINT64, &value) >= 0;
+
+        if(attribute >= 0) H5Aclose(attribute);
+        H5Sclose(space);
+
+        if(!ok) {
+            qCritical("Failed to write an attribute of the checkpoint");
+        }
+
+        return ok;
+
+    }
+
+    static bool writeAttribute(hid_t location, const QString & name, const QString & value) {
+
+        const QByteArray text = value.toUtf8();
+
+        hid_t type = H5Tcopy(H5T_C_S1);
+        H5Tset_size(type, std::max<size_t>(text.size(), 1));
+        H5Tset_strpad(type, H5T_STR_NULLPAD);
+        H5Tset_cset(type, H5T_CSET_UTF8);
+
+        hid_t space = H5Screate(H5S_SCALAR);
+        hid_t attribute = H5Acreate2(location, name.toUtf8().constData(), type, space, H5P_DEFAULT, H5P_DEFAULT);
+        bool ok = attribute >= 0 && H5Awrite(attribute, type, text.constData()) >= 0;
+
+        if(attribute >= 0) H5Aclose(attribute);
+        H5Sclose(space);
+        H5Tclose(type);
+
+        if(!ok) {
+            qCritical("Failed to write an attribute of the checkpoint");
+        }
+
+        return ok;
+
+    }
+
+    static bool readAttribute(hid_t location, const QString & name, quint64 & value) {
+
+        const QByteArray attributeName = name.toUtf8();
+
+        if(H5Aexists(location, attributeName.constData()) <= 0) {
+            qCritical("An attribute is missing in the checkpoint");
+            return false;
+        }
+
+        hid_t attribute = H5Aopen(location, attributeName.constData(), H5P_DEFAULT);
+        bool ok = attribute >= 0 && H5Aread(attribute, H5T_NATIVE_UINT64, &value) >= 0;
+
+        if(attribute >= 0) H5Aclose(attribute);
+
+        return ok;
+
+    }
+
+    static bool readAttribute(hid_t location, const QString & name, QString & value) {
+
+        const QByteArray attributeName = name.toUtf8();
+
+        if(H5Aexists(location, attributeName.constData()) <= 0) {
+            qCritical("An attribute is missing in the checkpoint");
+            return false;
+        }
+
+        hid_t attribute = H5Aopen(location, attributeName.constData(), H5P_DEFAULT);
+        if(attribute < 0)
+            return false;
+
+        hid_t type = H5Aget_type(attribute);
+        bool ok = H5Tget_class(type) == H5T_STRING && H5Tis_variable_str(type) == 0;
+
+        if(ok) {
+            std::vector<char> text(H5Tget_size(type) + 1, 0);
+            ok = H5Aread(attribute, type, text.data()) >= 0;
+            value = QString::fromUtf8(text.data());
+        }
+
+        H5Tclose(type);
+        H5Aclose(attribute);
+
+        return ok;
+
+    }
+
+    hid_t m_file;
+    hid_t m_group;
+    QString m_groupPath;
+    QString m_savingPath; // the group of the checkpoint being saved, until it is committed
+
+};
+
+#endif // TCONTEXTCHECKPOINT_HPP
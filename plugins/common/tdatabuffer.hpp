@@ -0,0 +1,172 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TDATABUFFER_HPP
+#define TDATABUFFER_HPP
+
+#include <QtGlobal>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+/// Growable byte buffer for the data submitted to the analytic devices. The data are appended in bulk and kept contiguous
+/// and aligned, so they can be viewed as an array of the sample type without a copy. The data processed so far are consumed
+/// from the front; the space is reused once the buffer would have to grow.
+class TDataBuffer {
+
+public:
+
+    /// Alignment of the data, in bytes
+    static constexpr size_t ALIGNMENT = 64;
+
+    TDataBuffer(): m_data(nullptr), m_begin(0), m_end(0), m_capacity(0) {}
+
+    TDataBuffer(const TDataBuffer &) = delete;
+    TDataBuffer & operator=(const TDataBuffer &) = delete;
+
+    /// Number of bytes in the buffer
+    size_t size() const { return m_end - m_begin; }
+
+    bool isEmpty() const { return m_end == m_begin; }
+
+    const uint8_t * data() const { return m_data + m_begin; }
+
+    uint8_t * data() { return m_data + m_begin; }
+
+    /// The data viewed as an array of the given type
+    template <class T>
+    const T * view() const { return reinterpret_cast<const T *>(data()); }
+
+    uint8_t operator[](size_t i) const { return m_data[m_begin + i]; }
+
+    /// Makes room for the given number of bytes in total, the data are kept
+    void reserve(size_t size) {
+
+        if(size <= m_capacity - m_begin)
+            return;
+
+        // the consumed space at the front is reused first
+        if(size <= m_capacity) {
+            std::memmove(m_data, m_data + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+            return;
+        }
+
+        size_t capacity = std::max(size, 2 * m_capacity);
+        std::unique_ptr<uint8_t[]> storage;
+
+        try {
+            storage.reset(new uint8_t[capacity + ALIGNMENT - 1]);
+        } catch (std::bad_alloc & e) {
+            (void)e; // supress MSVC warnings about an unused local variable
+            qFatal("Memory allocation failed");
+        }
+
+        uint8_t * data = storage.get() + (ALIGNMENT - reinterpret_cast<uintptr_t>(storage.get()) % ALIGNMENT) % ALIGNMENT;
+
+        if(m_end > m_begin) {
+            std::memcpy(data, m_data + m_begin, m_end - m_begin);
+        }
+
+        m_end -= m_begin;
+        m_begin = 0;
+        m_data = data;
+        m_capacity = capacity;
+        m_storage = std::move(storage);
+
+    }
+
+    /// Appends the data at the end of the buffer
+    void append(const uint8_t * data, size_t length) {
+
+        if(length == 0)
+            return;
+
+        (*this).reserve(size() + length);
+        std::memcpy(m_data + m_end, data, length);
+        m_end += length;
+
+    }
+
+    /// Drops the given number of bytes from the front of the buffer
+    void consume(size_t length) {
+
+        m_begin += std::min(length, size());
+
+        if(m_begin == m_end) {
+            m_begin = 0;
+            m_end = 0;
+        }
+
+    }
+
+    /// Exchanges the data and the memory with the other buffer
+    void swap(TDataBuffer & other) {
+        std::swap(m_storage, other.m_storage);
+        std::swap(m_data, other.m_data);
+        std::swap(m_begin, other.m_begin);
+        std::swap(m_end, other.m_end);
+        std::swap(m_capacity, other.m_capacity);
+    }
+
+    /// Replaces the data with the first length bytes taken from the source. The buffers are swapped when the rest of the source
+    /// is not longer than the taken bytes, so only the smaller of the two parts is copied.
+    void takeFront(TDataBuffer & source, size_t length) {
+
+        length = std::min(length, source.size());
+        const size_t rest = source.size() - length;
+
+        m_begin = 0;
+        m_end = 0;
+
+        if(rest <= length) {
+            (*this).append(source.data() + length, rest);
+            (*this).swap(source);
+            m_end = m_begin + length;
+        } else {
+            (*this).append(source.data(), length);
+            source.consume(length);
+        }
+
+    }
+
+    /// Removes all the data and releases the memory
+    void clear() {
+        m_storage.reset();
+        m_data = nullptr;
+        m_begin = 0;
+        m_end = 0;
+        m_capacity = 0;
+    }
+
+protected:
+
+    std::unique_ptr<uint8_t[]> m_storage;
+    uint8_t * m_data;
+    size_t m_begin;
+    size_t m_end;
+    size_t m_capacity;
+
+};
+
+#endif // TDATABUFFER_HPP
@@ -0,0 +1,175 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+// Compares the vectorized moment update kernels with the scalar reference kernels, for every instruction set
+// supported by the CPU and all the sample types. The results have to be bit-identical.
+
+#include "simd.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace SICAK;
+
+static const size_t MAX_LENGTH = 67; // covers all the vector widths and their tails
+static const size_t OFFSETS = 3; // unaligned starts
+
+static std::mt19937_64 generator(42);
+static int failures = 0;
+
+static const char * levelName(SimdLevel level) {
+    switch(level) {
+    case SimdLevel::Scalar: return "Scalar";
+    case SimdLevel::SSE2: return "SSE2";
+    case SimdLevel::AVX2: return "AVX2";
+    case SimdLevel::AVX512: return "AVX-512";
+    }
+    return "?";
+}
+
+template <class U>
+static std::vector<U> randomSamples(size_t n) {
+    std::vector<U> v(n);
+    for(size_t i = 0; i < n; i++) {
+        if(std::numeric_limits<U>::is_integer) {
+            // the extremes of the range are the most likely to break a conversion
+            switch(generator() % 4) {
+            case 0: v[i] = std::numeric_limits<U>::min(); break;
+            case 1: v[i] = std::numeric_limits<U>::max(); break;
+            default: v[i] = static_cast<U>(generator()); break;
+            }
+        } else {
+            v[i] = static_cast<U>(std::uniform_real_distribution<double>(-1e6, 1e6)(generator));
+        }
+    }
+    return v;
+}
+
+static std::vector<double> randomDoubles(size_t n) {
+    return randomSamples<double>(n);
+}
+
+static void check(const std::vector<double> & expected, const std::vector<double> & actual, const char * kernel, const char * type, SimdLevel level, size_t n) {
+    if(std::memcmp(expected.data(), actual.data(), expected.size() * sizeof(double)) != 0) {
+        std::printf("FAIL %s<%s> %s n=%zu\n", kernel, type, levelName(level), n);
+        failures++;
+    }
+}
+
+template <class U>
+static void testConversions(SimdLevel level, const char * type) {
+
+    for(size_t n = 0; n <= MAX_LENGTH; n++) {
+        for(size_t offset = 0; offset < OFFSETS; offset++) {
+
+            std::vector<U> src = randomSamples<U>(n + offset);
+            std::vector<double> avg = randomDoubles(n + offset);
+            std::vector<double> y = randomDoubles(n + offset);
+            const double alpha = randomDoubles(1)[0];
+
+            std::vector<double> expected(n + offset), actual(n + offset);
+            ScalarConvertSub(expected.data() + offset, src.data() + offset, avg.data() + offset, n);
+            VecConvertSub(actual.data() + offset, src.data() + offset, avg.data() + offset, n);
+            check(expected, actual, "ConvertSub", type, level, n);
+
+            expected = y;
+            actual = y;
+            ScalarAxpyConvertSub(expected.data() + offset, alpha, src.data() + offset, avg.data() + offset, n);
+            VecAxpyConvertSub(actual.data() + offset, alpha, src.data() + offset, avg.data() + offset, n);
+            check(expected, actual, "AxpyConvertSub", type, level, n);
+
+        }
+    }
+
+}
+
+static void testArithmetic(SimdLevel level) {
+
+    for(size_t n = 0; n <= MAX_LENGTH; n++) {
+        for(size_t offset = 0; offset < OFFSETS; offset++) {
+
+            const size_t length = n + offset;
+            std::vector<double> a = randomDoubles(length), b = randomDoubles(length), z = randomDoubles(length), w = randomDoubles(length), y = randomDoubles(length);
+            std::vector<double> scalars = randomDoubles(2);
+            const double alpha = scalars[0], gamma = scalars[1];
+
+            std::vector<double> expected(length), actual(length);
+            ScalarMul(expected.data() + offset, a.data() + offset, b.data() + offset, n);
+            VecMul(actual.data() + offset, a.data() + offset, b.data() + offset, n);
+            check(expected, actual, "Mul", "double", level, n);
+
+            expected = y; actual = y;
+            ScalarAxpy(expected.data() + offset, alpha, a.data() + offset, n);
+            VecAxpy(actual.data() + offset, alpha, a.data() + offset, n);
+            check(expected, actual, "Axpy", "double", level, n);
+
+            expected = y; actual = y;
+            ScalarAxpyMul(expected.data() + offset, a.data() + offset, alpha, z.data() + offset, n);
+            VecAxpyMul(actual.data() + offset, a.data() + offset, alpha, z.data() + offset, n);
+            check(expected, actual, "AxpyMul", "double", level, n);
+
+            expected = y; actual = y;
+            ScalarAxpy2(expected.data() + offset, alpha, a.data() + offset, gamma, z.data() + offset, n);
+            VecAxpy2(actual.data() + offset, alpha, a.data() + offset, gamma, z.data() + offset, n);
+            check(expected, actual, "Axpy2", "double", level, n);
+
+            expected = y; actual = y;
+            ScalarAddScaledSum(expected.data() + offset, a.data() + offset, gamma, z.data() + offset, alpha, w.data() + offset, n);
+            VecAddScaledSum(actual.data() + offset, a.data() + offset, gamma, z.data() + offset, alpha, w.data() + offset, n);
+            check(expected, actual, "AddScaledSum", "double", level, n);
+
+            expected = y; actual = y;
+            ScalarAddScaledSum(expected.data() + offset, a.data() + offset, gamma, static_cast<const double *>(nullptr), alpha, w.data() + offset, n);
+            VecAddScaledSum(actual.data() + offset, a.data() + offset, gamma, static_cast<const double *>(nullptr), alpha, w.data() + offset, n);
+            check(expected, actual, "AddScaledSum(z = null)", "double", level, n);
+
+        }
+    }
+
+}
+
+int main() {
+
+    const SimdLevel detected = DetectSimdLevel();
+
+    for(int l = static_cast<int>(SimdLevel::Scalar); l <= static_cast<int>(detected); l++) {
+
+        const SimdLevel level = static_cast<SimdLevel>(l);
+        ActiveSimdLevel() = level;
+
+        testConversions<uint8_t>(level, "uint8_t");
+        testConversions<int8_t>(level, "int8_t");
+        testConversions<uint16_t>(level, "uint16_t");
+        testConversions<int16_t>(level, "int16_t");
+        testConversions<uint32_t>(level, "uint32_t");
+        testConversions<int32_t>(level, "int32_t");
+        testConversions<float>(level, "float");
+        testConversions<double>(level, "double");
+        testArithmetic(level);
+
+        std::printf("%s: %s\n", levelName(level), failures ? "failed" : "ok");
+
+    }
+
+    return failures ? 1 : 0;
+
+}
@@ -0,0 +1,125 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TFILEBUFFER_HPP
+#define TFILEBUFFER_HPP
+
+#include <QtGlobal>
+#include <QTemporaryFile>
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/// Byte buffer backed by a temporary file, keeps large amounts of data out of the memory.
+/// The file is created on the first write and removed on clear or destruction.
+class TFileBuffer {
+
+public:
+
+    TFileBuffer(): m_file(nullptr), m_size(0) {}
+
+    virtual ~TFileBuffer() {}
+
+    /// Number of bytes in the buffer
+    virtual size_t size() const { return m_size; }
+
+    /// Appends the data at the end of the buffer
+    virtual bool append(const uint8_t * data, size_t length) {
+        return (*this).write(m_size, data, length);
+    }
+
+    /// Writes the data at the given offset, the buffer grows when writing past its end
+    virtual bool write(size_t offset, const uint8_t * data, size_t length) {
+
+        if(!m_file) {
+            m_file.reset(new QTemporaryFile());
+            if(!m_file->open()) {
+                qCritical("Failed to create a temporary file for the buffered data");
+                m_file.reset();
+                return false;
+            }
+        }
+
+        if(!m_file->seek(static_cast<qint64>(offset)) || m_file->write(reinterpret_cast<const char *>(data), static_cast<qint64>(length)) != static_cast<qint64>(length)) {
+            qCritical("Failed to write the buffered data into a temporary file");
+            return false;
+        }
+
+        m_size = std::max(m_size, offset + length);
+        return true;
+
+    }
+
+    /// Reads the data from the given offset, fails when reading past the end of the buffer
+    virtual bool read(size_t offset, uint8_t * data, size_t length) const {
+
+        if(offset + length > m_size || (length > 0 && !m_file)) {
+            qCritical("Reading past the end of the buffered data");
+            return false;
+        }
+
+        if(length == 0)
+            return true;
+
+        if(!m_file->seek(static_cast<qint64>(offset)) || m_file->read(reinterpret_cast<char *>(data), static_cast<qint64>(length)) != static_cast<qint64>(length)) {
+            qCritical("Failed to read the buffered data from a temporary file");
+            return false;
+        }
+
+        return true;
+
+    }
+
+    /// Appends all the data of another buffer, copied in chunks
+    virtual bool append(const TFileBuffer & other) {
+
+        std::vector<uint8_t> chunk(std::min<size_t>(other.size(), COPY_CHUNK_SIZE));
+
+        for(size_t offset = 0; offset < other.size(); offset += chunk.size()){
+            const size_t length = std::min(chunk.size(), other.size() - offset);
+            if(!other.read(offset, chunk.data(), length) || !(*this).append(chunk.data(), length))
+                return false;
+        }
+
+        return true;
+
+    }
+
+    /// Exchanges the data with another buffer
+    virtual void swap(TFileBuffer & other) {
+        std::swap(m_file, other.m_file);
+        std::swap(m_size, other.m_size);
+    }
+
+    /// Removes all the data along with the file
+    virtual void clear() {
+        m_file.reset();
+        m_size = 0;
+    }
+
+protected:
+
+    static constexpr size_t COPY_CHUNK_SIZE = 1024 * 1024;
+
+    std::unique_ptr<QTemporaryFile> m_file;
+    size_t m_size;
+
+};
+
+#endif // TFILEBUFFER_HPP
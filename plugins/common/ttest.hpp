@@ -21,12 +21,30 @@
 #define TTEST_HPP
 
 #include "typesmoment.hpp"
+#include "simd.hpp"
 #include <QtGlobal>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 namespace SICAK {
 
+    /// Maximal number of samples per chunk accumulated in a local buffer for single precision contexts
+    const size_t TTEST_LOCAL_SAMPLES = 4096;
+
+    /// Number of histogram bins per sample for 8 bit samples
+    const size_t TTEST_HIST_BINS_8BIT = 256;
+    /// Number of histogram bins per sample for 16 bit samples, i.e. upto 12 significant bits
+    const size_t TTEST_HIST_BINS_16BIT = 4096;
+    /// Maximal total size of the histograms in bytes, the moments are accumulated directly above it
+    const size_t TTEST_HIST_MEMORY_BUDGET = 1024 * 1024 * 1024;
+    /// Size of the histograms of a tile of samples counted at once, in bytes
+    const size_t TTEST_HIST_TILE_BYTES = 256 * 1024;
+    /// Number of traces counted per tile of samples at once
+    const size_t TTEST_HIST_BATCH_TRACES = 256;
+
     template <class T, class U>
-    void UniHoTTestAddTraces(Moments2DContext<T>& c, const U* buffer, size_t samplesPerTrace, size_t noOfTraces, size_t attackOrder) {
+    void UniHoTTestAddTraces(Moments2DContext<T>& c, const U* buffer, size_t samplesPerTrace, size_t noOfTraces, size_t attackOrder, size_t threads = 0) {
     //void UniHoTTestAddTraces(Moments2DContext<T>& c, const PowerTraces<U>& randTraces, size_t attackOrder) {
 
         if(c.p1MOrder() != 1
@@ -44,9 +62,9 @@ namespace SICAK {
         //const long long samplesPerTrace = randTraces.samplesPerTrace();
         //const long long noOfRandTraces = randTraces.noOfTraces();
 
-        Matrix<T> deltaT(samplesPerTrace, 2 * attackOrder);
-        Matrix<T> minusDivN(2 * attackOrder, 1);
-        Matrix<T> nCr(2*attackOrder + 1, 2 * attackOrder + 1, 0);
+        typedef typename WorkType<T>::type W;
+
+        Matrix<W> nCr(2*attackOrder + 1, 2 * attackOrder + 1, 0);
 
         // precompute combination numbers
         for(size_t n = 0; n <= 2*attackOrder; n++){
@@ -56,160 +74,351 @@ namespace SICAK {
             }
         }
 
-        // random traces
-        for (size_t trace = 0; trace < noOfTraces; trace++) {
+        // Samples are mutually independent: every thread processes all the traces within its own range of samples,
+        // every sample sees the same sequence of operations regardless of the number of threads
+        const int noOfThreads = WorkerThreads(threads);
+        const size_t sampleBlocks = std::max<size_t>(std::min(samplesPerTrace, static_cast<size_t>(noOfThreads)), 1);
+        const long long noOfBlocks = static_cast<long long>(sampleBlocks);
+        const size_t card = c.p1Card();
 
-            T n = c.p1Card() + 1.0; // n = cardinality of the merged set
-            T divN = 1.0 / n;
+        // Single precision contexts: the statistics of a chunk of samples are accumulated in a local double precision buffer
+        // and rounded into the context once per call, instead of once per trace
+        const bool localStats = !std::is_same<T, W>::value;
 
-            {
-                //  precompute deltaT
-                T * p_deltaT = &(deltaT(0, 0));
-                //const U * p_pt = &(randTraces(0, trace));
-                const U * p_pt = buffer + (trace * samplesPerTrace);
-                const T * p_tracesAvg = &( c.p1M(1)(0) );
-                for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+        #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+        for (long long block = 0; block < noOfBlocks; block++) {
 
-                    (*p_deltaT++) = static_cast<T>((*p_pt++)) - (*p_tracesAvg++);
+            size_t firstSample, lastSample;
+            SplitRange(samplesPerTrace, sampleBlocks, static_cast<size_t>(block), firstSample, lastSample);
+            const size_t chunkLength = localStats ? std::min(lastSample - firstSample, TTEST_LOCAL_SAMPLES) : (lastSample - firstSample);
 
-                }
+            Matrix<W> deltaT(chunkLength, 2 * attackOrder);
+            Matrix<W> minusDivN(2 * attackOrder, 1);
+            Matrix<W> chunkStats(localStats ? chunkLength : 0, localStats ? 2 * attackOrder : 0); // column 0 holds the means, column 'deg - 1' the CSs of order 'deg'
 
-                // and all its necessary powers
-                for (size_t order = 1; order < 2 * attackOrder; order++){
+            for (size_t firstChunk = firstSample; firstChunk < lastSample; firstChunk += chunkLength) {
 
-                    const T * p_firstDeltaT = &(deltaT(0, 0));
-                    const T * p_lastDeltaT = &(deltaT(0, order-1));
-                    p_deltaT = &(deltaT(0, order));
+                const size_t chunkSamples = std::min(chunkLength, lastSample - firstChunk);
 
-                    for (size_t sample = 0; sample < samplesPerTrace; sample++) {
-                        (*p_deltaT++) = (*p_lastDeltaT++) * (*p_firstDeltaT++);
+                // the means (deg = 1) and the CSs (deg >= 2) of the chunk
+                auto stats = [&](size_t deg) -> W * {
+                    if constexpr (std::is_same<T, W>::value) {
+                        return (deg == 1) ? &( c.p1M(1)(firstChunk) ) : &( c.p1CS(deg)(firstChunk) );
+                    } else {
+                        return &( chunkStats(0, deg - 1) );
                     }
+                };
 
+                for (size_t deg = 1; localStats && deg <= 2 * attackOrder; deg++) {
+                    const T * p_src = (deg == 1) ? &( c.p1M(1)(firstChunk) ) : &( c.p1CS(deg)(firstChunk) );
+                    std::copy_n(p_src, chunkSamples, stats(deg));
                 }
 
-                // precompute (-1*divN)^d
-                minusDivN(0,0) = (-1.0) * divN;
-                for (size_t order = 1; order < 2 * attackOrder; order++){
+                // random traces
+                for (size_t trace = 0; trace < noOfTraces; trace++) {
 
-                    minusDivN(order, 0) = minusDivN(order-1, 0) * minusDivN(0,0);
+                    W n = (card + trace) + 1.0; // n = cardinality of the merged set
+                    W divN = 1.0 / n;
 
-                }
+                    {
+                        //  precompute deltaT
+                        VecConvertSub(&(deltaT(0, 0)), buffer + (trace * samplesPerTrace) + firstChunk, stats(1), chunkSamples);
 
-            }
+                        // and all its necessary powers
+                        for (size_t order = 1; order < 2 * attackOrder; order++){
 
-            for(size_t deg = 2 * attackOrder; deg >= 2; deg--){
+                            VecMul(&(deltaT(0, order)), &(deltaT(0, order-1)), &(deltaT(0, 0)), chunkSamples);
 
-                const T p_alpha = ( (n > 1) ? (1.0 - std::pow( (-1.0)/(n-1.0), deg-1 ) ) : 0 );
-                const T p_beta = p_alpha * std::pow( ((n-1.0) * divN), deg);
-                const T * p_deltaT = &( deltaT(0, deg - 1) );
-                T * p_p1CSdeg = &(c.p1CS(deg)(0));
+                        }
 
-                for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+                        // precompute (-1*divN)^d
+                        minusDivN(0,0) = (-1.0) * divN;
+                        for (size_t order = 1; order < 2 * attackOrder; order++){
 
-                    (*p_p1CSdeg++) += p_beta * (*p_deltaT++);
+                            minusDivN(order, 0) = minusDivN(order-1, 0) * minusDivN(0,0);
 
-                }
+                        }
+
+                    }
+
+                    for(size_t deg = 2 * attackOrder; deg >= 2; deg--){
+
+                        const W p_alpha = ( (n > 1) ? (1.0 - std::pow( (-1.0)/(n-1.0), deg-1 ) ) : 0 );
+                        const W p_beta = p_alpha * std::pow( ((n-1.0) * divN), deg);
+                        W * p_p1CSdeg = stats(deg);
 
-                for(size_t p = 1; p <= deg - 2; p++){
+                        VecAxpy(p_p1CSdeg, p_beta, &( deltaT(0, deg - 1) ), chunkSamples);
 
-                    const T * p_p1CSless = &( c.p1CS(deg-p)(0) );
-                    const T p_delta = minusDivN(p - 1, 0) * nCr(deg, p);
-                    const T * p_deltaTPow = &( deltaT(0, p - 1) );
-                    p_p1CSdeg = &(c.p1CS(deg)(0));
+                        for(size_t p = 1; p <= deg - 2; p++){
 
-                    for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+                            const W p_delta = minusDivN(p - 1, 0) * nCr(deg, p);
 
-                        (*p_p1CSdeg++) += *(p_p1CSless++) * p_delta * (*p_deltaTPow++);
+                            VecAxpyMul(p_p1CSdeg, stats(deg - p), p_delta, &( deltaT(0, p - 1) ), chunkSamples);
+
+                        }
 
                     }
 
+                    VecAxpy(stats(1), divN, &(deltaT(0, 0)), chunkSamples);
+
+                }
+
+                for (size_t deg = 1; localStats && deg <= 2 * attackOrder; deg++) {
+                    T * p_dst = (deg == 1) ? &( c.p1M(1)(firstChunk) ) : &( c.p1CS(deg)(firstChunk) );
+                    std::copy_n(stats(deg), chunkSamples, p_dst);
                 }
 
             }
 
-            for (size_t sample = 0; sample < samplesPerTrace; sample++) {
+        }
 
-                c.p1M(1)(sample) += deltaT(sample, 0) * divN;
+        c.p1Card() = card + noOfTraces;
 
-            }
+    }
+
+    /// Checks whether all the values fit into the range of the histograms
+    template <class U>
+    bool UniHistInRange(const HistogramContext & h, const U * buffer, size_t length) {
+
+        const long long low = h.offset();
+        const long long high = h.offset() + static_cast<long long>(h.bins()) - 1;
+
+        if(!std::numeric_limits<U>::is_integer)
+            return false;
+
+        // every value of the type fits
+        if(static_cast<long long>(std::numeric_limits<U>::min()) >= low && static_cast<long long>(std::numeric_limits<U>::max()) <= high)
+            return true;
+
+        U minVal = std::numeric_limits<U>::max();
+        U maxVal = std::numeric_limits<U>::min();
+
+        for(size_t i = 0; i < length; i++){
+            minVal = std::min(minVal, buffer[i]);
+            maxVal = std::max(maxVal, buffer[i]);
+        }
+
+        return length == 0 || (static_cast<long long>(minVal) >= low && static_cast<long long>(maxVal) <= high);
+
+    }
+
+    /// Counts the traces in the per-sample histograms, all the values must fit into the range of the histograms (see UniHistInRange)
+    template <class U>
+    void UniHistAddTraces(HistogramContext & h, const U * buffer, size_t samplesPerTrace, size_t noOfTraces, size_t threads = 0) {
+
+        if (h.width() != samplesPerTrace)
+            qFatal("Numbers of samples don't match.");
+
+        if (h.card() + noOfTraces > HistogramContext::MAX_CARD)
+            qFatal("Histogram bins would overflow.");
+
+        // Samples are mutually independent: every thread counts all the traces within its own range of samples
+        const int noOfThreads = WorkerThreads(threads);
+        const size_t sampleBlocks = std::max<size_t>(std::min(samplesPerTrace, static_cast<size_t>(noOfThreads)), 1);
+        const long long noOfBlocks = static_cast<long long>(sampleBlocks);
+        const long long offset = h.offset();
+        const size_t stride = h.stride();
+        const size_t tileSamples = std::max<size_t>(TTEST_HIST_TILE_BYTES / (stride * sizeof(uint32_t)), 1);
+        uint32_t * p_counts = h.counts().data();
+
+        #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+        for (long long block = 0; block < noOfBlocks; block++) {
+
+            size_t firstSample, lastSample;
+            SplitRange(samplesPerTrace, sampleBlocks, static_cast<size_t>(block), firstSample, lastSample);
 
-            c.p1Card() = c.p1Card() + 1;
+            // a tile of samples keeps its histograms in the cache while a batch of traces is counted
+            for (size_t firstTrace = 0; firstTrace < noOfTraces; firstTrace += TTEST_HIST_BATCH_TRACES) {
+
+                const size_t lastTrace = std::min(firstTrace + TTEST_HIST_BATCH_TRACES, noOfTraces);
+
+                for (size_t firstTile = firstSample; firstTile < lastSample; firstTile += tileSamples) {
+
+                    const size_t lastTile = std::min(firstTile + tileSamples, lastSample);
+
+                    for (size_t trace = firstTrace; trace < lastTrace; trace++) {
+
+                        const U * p_trace = buffer + trace * samplesPerTrace;
+
+                        for (size_t sample = firstTile; sample < lastTile; sample++) {
+                            p_counts[sample * stride + static_cast<size_t>(static_cast<long long>(p_trace[sample]) - offset)]++;
+                        }
+
+                    }
+
+                }
+
+            }
 
         }
 
+        h.card() += noOfTraces;
+
     }
 
+    /// Derives the means and the central moment sums upto the order 2 * attackOrder from the histograms,
+    /// overwrites the t-test context 'c' with them
     template <class T>
-    void UniHoTTestComputeTValsDegs(const Moments2DContext<T> & c1, const Moments2DContext<T> & c2, Matrix<T> & tValsDegs, size_t attackOrder){
-
-        if(c1.p1MOrder() != 1
-            || c1.p1CSOrder() < attackOrder * 2
-            || c1.p12ACSOrder() != 0
-            || c1.p1MOrder() != c2.p1MOrder()
-            || c1.p1CSOrder() != c2.p1CSOrder()
-            || c1.p1Width() != c2.p1Width()
-            ){
+    void UniHoTTestHistToContext(const HistogramContext & h, Moments2DContext<T> & c, size_t attackOrder, size_t threads = 0) {
+
+        if(c.p1MOrder() != 1
+            || c.p1CSOrder() != 2 * attackOrder
+            || c.p12ACSOrder() != 0
+            )
             qFatal("Not a valid higher-order univariate t-test context!");
-            return;
-        }
 
-        size_t samplesPerTrace = c1.p1Width();
+        if (c.p1Width() != h.width())
+            qFatal("Numbers of samples don't match.");
 
-        tValsDegs.init(samplesPerTrace, 2);
+        typedef typename WorkType<T>::type W;
 
-        T randomCardinality = c1.p1Card();
-        T constCardinality = c2.p1Card();
+        const int noOfThreads = WorkerThreads(threads);
+        const size_t samplesPerTrace = h.width();
+        const size_t sampleBlocks = std::max<size_t>(std::min(samplesPerTrace, static_cast<size_t>(noOfThreads)), 1);
+        const long long noOfBlocks = static_cast<long long>(sampleBlocks);
+        const size_t bins = h.bins();
+        const long long offset = h.offset();
+        const size_t card = h.card();
 
-        for(size_t sample = 0; sample < samplesPerTrace; sample++){
+        #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+        for (long long block = 0; block < noOfBlocks; block++) {
 
-            T meanDelta = 0;
-            T randomVariance = 1;
-            T constVariance = 1;
+            size_t firstSample, lastSample;
+            SplitRange(samplesPerTrace, sampleBlocks, static_cast<size_t>(block), firstSample, lastSample);
 
-            if(attackOrder == 1){
+            Matrix<W> cs(2 * attackOrder + 1, 1);
 
-                T randomMean = c1.p1M(1)(sample);
-                T constMean  = c2.p1M(1)(sample);
-                meanDelta = constMean - randomMean;
+            for (size_t sample = firstSample; sample < lastSample; sample++) {
 
-                randomVariance = c1.p1CS(2)(sample) / randomCardinality;
-                constVariance  = c2.p1CS(2)(sample) / constCardinality;
+                const uint32_t * p_counts = &( h.counts()(0, sample) );
 
-            } else if(attackOrder == 2){
+                // the sum of the values is exact
+                long long sum = 0;
+                for (size_t bin = 0; bin < bins; bin++) {
+                    sum += static_cast<long long>(p_counts[bin]) * (offset + static_cast<long long>(bin));
+                }
+
+                const W mean = (card > 0) ? static_cast<W>(sum) / static_cast<W>(card) : 0;
 
-                T randomMean = c1.p1CS(2)(sample) / randomCardinality;
-                T constMean  = c2.p1CS(2)(sample) / constCardinality;
-                meanDelta = constMean - randomMean;
+                cs.fill(0);
 
-                randomVariance = (c1.p1CS(4)(sample) / randomCardinality) - std::pow( c1.p1CS(2)(sample) / randomCardinality , 2 );
-                constVariance  = (c2.p1CS(4)(sample) / constCardinality)  - std::pow( c2.p1CS(2)(sample) / constCardinality  , 2 );
+                for (size_t bin = 0; bin < bins; bin++) {
 
+                    if (p_counts[bin] == 0) continue;
 
-            } else { // > 2
+                    const W count = static_cast<W>(p_counts[bin]);
+                    const W delta = static_cast<W>(offset + static_cast<long long>(bin)) - mean;
+                    W deltaPow = delta;
+
+                    for (size_t deg = 2; deg <= 2 * attackOrder; deg++) {
+                        deltaPow *= delta;
+                        cs(deg, 0) += count * deltaPow;
+                    }
 
-                T randomMean = (c1.p1CS(attackOrder)(sample) / randomCardinality) / std::pow( std::sqrt( c1.p1CS(2)(sample) / randomCardinality ) , attackOrder);
-                T constMean  = (c2.p1CS(attackOrder)(sample) / constCardinality)  / std::pow( std::sqrt( c2.p1CS(2)(sample) / constCardinality  ) , attackOrder);
-                meanDelta = constMean - randomMean;
+                }
 
-                randomVariance = ( (c1.p1CS(attackOrder*2)(sample) / randomCardinality) - std::pow( c1.p1CS(attackOrder)(sample) / randomCardinality , 2) )
-                                 / std::pow( c1.p1CS(2)(sample) / randomCardinality , attackOrder);
-                constVariance  = ( (c2.p1CS(attackOrder*2)(sample) / constCardinality)  - std::pow( c2.p1CS(attackOrder)(sample) / constCardinality  , 2) )
-                                / std::pow( c2.p1CS(2)(sample) / constCardinality  , attackOrder);
+                c.p1M(1)(sample) = mean;
+                for (size_t deg = 2; deg <= 2 * attackOrder; deg++) {
+                    c.p1CS(deg)(sample) = cs(deg, 0);
+                }
 
             }
 
+        }
+
+        c.p1Card() = card;
+
+    }
+
+    /// Computes the difference of the means (the standardized moments of the given order) of the classes and their variances at the sample
+    template <class T, class R>
+    inline void UniHoTTestSampleStats(const Moments2DContext<T> & c1, const Moments2DContext<T> & c2, size_t sample, size_t attackOrder, R randomCardinality, R constCardinality, R & meanDelta, R & randomVariance, R & constVariance){
+
+        if(attackOrder == 1){
+
+            R randomMean = c1.p1M(1)(sample);
+            R constMean  = c2.p1M(1)(sample);
+            meanDelta = constMean - randomMean;
+
+            randomVariance = c1.p1CS(2)(sample) / randomCardinality;
+            constVariance  = c2.p1CS(2)(sample) / constCardinality;
+
+        } else if(attackOrder == 2){
+
+            R randomMean = c1.p1CS(2)(sample) / randomCardinality;
+            R constMean  = c2.p1CS(2)(sample) / constCardinality;
+            meanDelta = constMean - randomMean;
+
+            randomVariance = (c1.p1CS(4)(sample) / randomCardinality) - std::pow( c1.p1CS(2)(sample) / randomCardinality , 2 );
+            constVariance  = (c2.p1CS(4)(sample) / constCardinality)  - std::pow( c2.p1CS(2)(sample) / constCardinality  , 2 );
+
+
+        } else { // > 2
+
+            R randomMean = (c1.p1CS(attackOrder)(sample) / randomCardinality) / std::pow( std::sqrt( c1.p1CS(2)(sample) / randomCardinality ) , attackOrder);
+            R constMean  = (c2.p1CS(attackOrder)(sample) / constCardinality)  / std::pow( std::sqrt( c2.p1CS(2)(sample) / constCardinality  ) , attackOrder);
+            meanDelta = constMean - randomMean;
+
+            randomVariance = ( (c1.p1CS(attackOrder*2)(sample) / randomCardinality) - std::pow( c1.p1CS(attackOrder)(sample) / randomCardinality , 2) )
+                             / std::pow( c1.p1CS(2)(sample) / randomCardinality , attackOrder);
+            constVariance  = ( (c2.p1CS(attackOrder*2)(sample) / constCardinality)  - std::pow( c2.p1CS(attackOrder)(sample) / constCardinality  , 2) )
+                            / std::pow( c2.p1CS(2)(sample) / constCardinality  , attackOrder);
+
+        }
+
+    }
+
+    /// Checks the contexts of the two classes are valid for the t-test of the given order
+    template <class T>
+    bool UniHoTTestValidContexts(const Moments2DContext<T> & c1, const Moments2DContext<T> & c2, size_t attackOrder){
+
+        return c1.p1MOrder() == 1
+            && c1.p1CSOrder() >= attackOrder * 2
+            && c1.p12ACSOrder() == 0
+            && c1.p1MOrder() == c2.p1MOrder()
+            && c1.p1CSOrder() == c2.p1CSOrder()
+            && c1.p1Width() == c2.p1Width();
+
+    }
+
+    /// Computes the t-values and the degrees of freedom, the output type R may differ from the type of the contexts T
+    template <class T, class R = T>
+    void UniHoTTestComputeTValsDegs(const Moments2DContext<T> & c1, const Moments2DContext<T> & c2, Matrix<R> & tValsDegs, size_t attackOrder, size_t threads = 0){
+
+        if(!UniHoTTestValidContexts(c1, c2, attackOrder)){
+            qFatal("Not a valid higher-order univariate t-test context!");
+            return;
+        }
+
+        size_t samplesPerTrace = c1.p1Width();
+
+        tValsDegs.init(samplesPerTrace, 2);
+
+        R randomCardinality = c1.p1Card();
+        R constCardinality = c2.p1Card();
+
+        const long long samplesPerTraceLL = static_cast<long long>(samplesPerTrace);
+
+        #pragma omp parallel for schedule(static) num_threads(WorkerThreads(threads))
+        for(long long sample = 0; sample < samplesPerTraceLL; sample++){
+
+            R meanDelta = 0;
+            R randomVariance = 1;
+            R constVariance = 1;
+
+            UniHoTTestSampleStats(c1, c2, sample, attackOrder, randomCardinality, constCardinality, meanDelta, randomVariance, constVariance);
 
             // t-values
             tValsDegs(sample, 0) = (meanDelta) / std::sqrt((constVariance / constCardinality) + (randomVariance / randomCardinality));
 
-            T num = ( constVariance / constCardinality ) + ( randomVariance / randomCardinality );
+            R num = ( constVariance / constCardinality ) + ( randomVariance / randomCardinality );
             num = num * num;
 
-            T den1 = ( constVariance / constCardinality );
+            R den1 = ( constVariance / constCardinality );
             den1 = den1 * den1;
             den1 = den1 / ( constCardinality - 1.0);
 
-            T den2 = ( randomVariance / randomCardinality );
+            R den2 = ( randomVariance / randomCardinality );
             den2 = den2 * den2;
             den2 = den2 / ( randomCardinality - 1.0);
 
@@ -220,6 +429,99 @@ namespace SICAK {
 
     }
 
+    /// Computes the summary of the t-values without keeping them: summary(0) = max |t|, summary(1) = index of its sample,
+    /// summary(2) = number of samples with |t| above the threshold. Undefined t-values (e.g., of constant samples) are skipped.
+    template <class T, class R = T>
+    void UniHoTTestComputeSummary(const Moments2DContext<T> & c1, const Moments2DContext<T> & c2, Vector<R> & summary, size_t attackOrder, R threshold, size_t threads = 0){
+
+        if(!UniHoTTestValidContexts(c1, c2, attackOrder)){
+            qFatal("Not a valid higher-order univariate t-test context!");
+            return;
+        }
+
+        summary.init(3, 0);
+
+        const size_t samplesPerTrace = c1.p1Width();
+
+        R randomCardinality = c1.p1Card();
+        R constCardinality = c2.p1Card();
+
+        R maxT = 0;
+        size_t maxSample = 0;
+        size_t above = 0;
+
+        const long long samplesPerTraceLL = static_cast<long long>(samplesPerTrace);
+
+        #pragma omp parallel num_threads(WorkerThreads(threads))
+        {
+
+            R threadMaxT = 0;
+            size_t threadMaxSample = 0;
+            size_t threadAbove = 0;
+
+            #pragma omp for schedule(static) nowait
+            for(long long sample = 0; sample < samplesPerTraceLL; sample++){
+
+                R meanDelta = 0;
+                R randomVariance = 1;
+                R constVariance = 1;
+
+                UniHoTTestSampleStats(c1, c2, sample, attackOrder, randomCardinality, constCardinality, meanDelta, randomVariance, constVariance);
+
+                R absT = std::abs((meanDelta) / std::sqrt((constVariance / constCardinality) + (randomVariance / randomCardinality)));
+
+                // NaN never compares greater
+                if(absT > threadMaxT) {
+                    threadMaxT = absT;
+                    threadMaxSample = sample;
+                }
+
+                if(absT > threshold) {
+                    threadAbove++;
+                }
+
+            }
+
+            // ties keep the lower sample, so the result does not depend on the number of threads
+            #pragma omp critical
+            {
+                if(threadMaxT > maxT || (threadMaxT == maxT && threadMaxSample < maxSample)) {
+                    maxT = threadMaxT;
+                    maxSample = threadMaxSample;
+                }
+                above += threadAbove;
+            }
+
+        }
+
+        summary(0) = maxT;
+        summary(1) = static_cast<R>(maxSample);
+        summary(2) = static_cast<R>(above);
+
+    }
+
+    /// Merges the summary of a window of samples starting at 'sampleOffset' into the summary of the whole traces (see UniHoTTestComputeSummary),
+    /// the window at the offset 0 starts over
+    template <class R>
+    void UniHoTTestMergeSummary(Vector<R> & summary, const Vector<R> & windowSummary, size_t sampleOffset){
+
+        if(sampleOffset == 0 || summary.length() != 3) {
+            summary.init(3);
+            for(size_t i = 0; i < 3; i++){
+                summary(i) = windowSummary(i);
+            }
+            return;
+        }
+
+        if(windowSummary(0) > summary(0)) {
+            summary(0) = windowSummary(0);
+            summary(1) = windowSummary(1) + static_cast<R>(sampleOffset);
+        }
+
+        summary(2) += windowSummary(2);
+
+    }
+
 }
 
 #endif // TTEST_HPP
@@ -21,12 +21,36 @@
 #define TYPESMOMENT_HPP
 
 #include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 #include <QtGlobal>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace SICAK {
 
+    /* Parallel execution helpers */
+
+    /// Resolves the requested number of worker threads, 0 stands for all the available cores
+    inline int WorkerThreads(size_t threads) {
+#ifdef _OPENMP
+        return (threads > 0) ? static_cast<int>(threads) : omp_get_max_threads();
+#else
+        (void)threads;
+        return 1;
+#endif
+    }
+
+    /// Splits 'length' items into 'parts' contiguous ranges of a similar size, returns the bounds of the range no. 'part'
+    inline void SplitRange(size_t length, size_t parts, size_t part, size_t & begin, size_t & end) {
+        begin = (length * part) / parts;
+        end = (length * (part + 1)) / parts;
+    }
+
     /* Basic data types */
 
     template <class T>
@@ -47,11 +71,17 @@ namespace SICAK {
         }
 
         /// Move constructor
-        Vector(Vector&& other) : m_data(std::move(other.m_data)), m_length(other.m_length) {  }
+        Vector(Vector&& other) : m_data(std::move(other.m_data)), m_length(other.m_length), m_capacity(other.m_capacity) {
+            other.m_length = 0;
+            other.m_capacity = 0;
+        }
         /// Move assignment operator
         Vector& operator=(Vector&& other) {
             m_data = std::move(other.m_data);
             m_length = other.m_length;
+            m_capacity = other.m_capacity;
+            other.m_length = 0;
+            other.m_capacity = 0;
             return (*this);
         }
 
@@ -246,11 +276,20 @@ namespace SICAK {
 
     /* Statistical context */
 
+    /// Type of the intermediate results used when updating a context, single precision contexts are updated in double precision
+    template <class T>
+    struct WorkType { typedef T type; };
+
+    template <>
+    struct WorkType<float> { typedef double type; };
+
     template <class T>
     class Moments2DContext {
 
     public:
 
+        typedef typename WorkType<T>::type W;
+
         /// Constructs an empty context, needs to be initialized first (init)
         Moments2DContext():
             m_p1Width(0), m_p2Width(0), m_p1Card(0), m_p2Card(0),
@@ -417,6 +456,97 @@ namespace SICAK {
 
         }
 
+        /// Size of the context in bytes
+        virtual size_t size() const {
+
+            size_t p1CSLen = (m_p1CSOrder > 1) ? m_p1CSOrder - 1 : 0;
+            size_t p2CSLen = (m_p2CSOrder > 1) ? m_p2CSOrder - 1 : 0;
+
+            return sizeof(T) * ( (m_p1MOrder + p1CSLen) * m_p1Width + (m_p2MOrder + p2CSLen) * m_p2Width + m_p12ACSOrder * m_p1Width * m_p2Width );
+
+        }
+
+        /// Calls f(data, length) on every array of the context in a fixed order: the raw moments, the central moment sums
+        /// and the adjusted central moment sums. Along with the cardinalities, the arrays hold the whole state of the context.
+        template <class F>
+        void forEachBuffer(F f) {
+
+            size_t p1CSLen = (m_p1CSOrder > 1) ? m_p1CSOrder - 1 : 0;
+            size_t p2CSLen = (m_p2CSOrder > 1) ? m_p2CSOrder - 1 : 0;
+
+            for(size_t order = 0; order < m_p1MOrder; order++) f(m_p1M[order].data(), m_p1M[order].length());
+            for(size_t order = 0; order < m_p2MOrder; order++) f(m_p2M[order].data(), m_p2M[order].length());
+            for(size_t order = 0; order < p1CSLen; order++) f(m_p1CS[order].data(), m_p1CS[order].length());
+            for(size_t order = 0; order < p2CSLen; order++) f(m_p2CS[order].data(), m_p2CS[order].length());
+            for(size_t order = 0; order < m_p12ACSOrder; order++) f(m_p12ACS[order].data(), m_p12ACS[order].length());
+
+        }
+
+        template <class F>
+        void forEachBuffer(F f) const {
+
+            size_t p1CSLen = (m_p1CSOrder > 1) ? m_p1CSOrder - 1 : 0;
+            size_t p2CSLen = (m_p2CSOrder > 1) ? m_p2CSOrder - 1 : 0;
+
+            for(size_t order = 0; order < m_p1MOrder; order++) f(static_cast<const T *>(m_p1M[order].data()), m_p1M[order].length());
+            for(size_t order = 0; order < m_p2MOrder; order++) f(static_cast<const T *>(m_p2M[order].data()), m_p2M[order].length());
+            for(size_t order = 0; order < p1CSLen; order++) f(static_cast<const T *>(m_p1CS[order].data()), m_p1CS[order].length());
+            for(size_t order = 0; order < p2CSLen; order++) f(static_cast<const T *>(m_p2CS[order].data()), m_p2CS[order].length());
+            for(size_t order = 0; order < m_p12ACSOrder; order++) f(static_cast<const T *>(m_p12ACS[order].data()), m_p12ACS[order].length());
+
+        }
+
+        /// Merges another context of the same configuration into this one using the pairwise update formulas,
+        /// the result is equal to a context that has been fed with the data of both the contexts
+        virtual void merge(const Moments2DContext & other, size_t threads = 0) {
+
+            if(other.m_p1Width != m_p1Width || other.m_p2Width != m_p2Width
+                || other.m_p1MOrder != m_p1MOrder || other.m_p2MOrder != m_p2MOrder
+                || other.m_p1CSOrder != m_p1CSOrder || other.m_p2CSOrder != m_p2CSOrder
+                || other.m_p12ACSOrder != m_p12ACSOrder) {
+                qCritical("Cannot merge contexts of a different configuration!");
+                return;
+            }
+
+            if((m_p1CSOrder > 1 && m_p1MOrder < 1) || (m_p2CSOrder > 1 && m_p2MOrder < 1)) {
+                qCritical("Merging the central moment sums requires the means!");
+                return;
+            }
+
+            if(m_p12ACSOrder > 0 && (m_p1Card != m_p2Card || other.m_p1Card != other.m_p2Card || m_p1CSOrder < m_p12ACSOrder || m_p1MOrder < 1 || m_p2MOrder < 1)) {
+                qCritical("Merging the adjusted central moment sums requires equal cardinalities of both populations, their means and central moment sums upto the same order!");
+                return;
+            }
+
+            const int noOfThreads = WorkerThreads(threads);
+
+            size_t maxOrder = std::max(std::max(m_p1CSOrder, m_p2CSOrder), m_p12ACSOrder);
+            Matrix<W> nCr(maxOrder + 1, maxOrder + 1, 0);
+            for(size_t n = 0; n <= maxOrder; n++){
+                nCr(n, 0) = 1;
+                for(size_t r = 1; r <= n; r++){
+                    nCr(n, r) = (nCr(n, r-1) * (n - r + 1)) / r;
+                }
+            }
+
+            // ACSs go first, they are based on the central moment sums and the means of both the contexts before merging
+            if(m_p12ACSOrder > 0 && other.m_p1Card > 0) {
+                mergeACS(other, nCr, noOfThreads);
+            }
+
+            if(other.m_p1Card > 0) {
+                mergePopulation(m_p1M.get(), m_p1CS.get(), m_p1Card, other.m_p1M.get(), other.m_p1CS.get(), other.m_p1Card, m_p1Width, m_p1MOrder, m_p1CSOrder, nCr, noOfThreads);
+            }
+
+            if(other.m_p2Card > 0) {
+                mergePopulation(m_p2M.get(), m_p2CS.get(), m_p2Card, other.m_p2M.get(), other.m_p2CS.get(), other.m_p2Card, m_p2Width, m_p2MOrder, m_p2CSOrder, nCr, noOfThreads);
+            }
+
+            m_p1Card += other.m_p1Card;
+            m_p2Card += other.m_p2Card;
+
+        }
+
         /// Width of the first population
         virtual size_t p1Width() const { return m_p1Width; }
         /// Width of the second population
@@ -475,6 +605,116 @@ namespace SICAK {
 
     protected:
 
+        /// Merges the raw moments and the central moment sums of one population (b) into another (a):
+        /// CS(p) = sum_k nCr(p, k) * ( (-n_b * delta / n)^k * CS_a(p-k) + (n_a * delta / n)^k * CS_b(p-k) ), where CS(0) = n and CS(1) = 0
+        static void mergePopulation(Vector<T> * aM, Vector<T> * aCS, size_t aCard, const Vector<T> * bM, const Vector<T> * bCS, size_t bCard, size_t width, size_t mOrder, size_t csOrder, const Matrix<W> & nCr, int noOfThreads) {
+
+            const W na = static_cast<W>(aCard);
+            const W nb = static_cast<W>(bCard);
+            const W n = na + nb;
+            const long long widthLL = static_cast<long long>(width);
+
+            #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+            for(long long i = 0; i < widthLL; i++){
+
+                const W delta = (mOrder > 0) ? (static_cast<W>(bM[0](i)) - aM[0](i)) : 0;
+                const W alpha = (-1.0) * nb * delta / n;
+                const W beta = na * delta / n;
+
+                for(size_t p = csOrder; p >= 2; p--){
+
+                    W sum = 0;
+                    W alphaPow = 1;
+                    W betaPow = 1;
+
+                    for(size_t k = 0; k <= p; k++){
+
+                        size_t j = p - k;
+                        W csA = (j == 0) ? na : ((j == 1) ? 0 : aCS[j-2](i));
+                        W csB = (j == 0) ? nb : ((j == 1) ? 0 : bCS[j-2](i));
+
+                        sum += nCr(p, k) * (alphaPow * csA + betaPow * csB);
+
+                        alphaPow *= alpha;
+                        betaPow *= beta;
+
+                    }
+
+                    aCS[p-2](i) = sum;
+
+                }
+
+                if(mOrder > 0) {
+                    aM[0](i) += delta * (nb / n);
+                }
+
+                for(size_t order = 2; order <= mOrder; order++){
+                    aM[order-1](i) = (na * aM[order-1](i) + nb * bM[order-1](i)) / n;
+                }
+
+            }
+
+        }
+
+        /// Merges the adjusted central moment sums ACS(d) = sum (x - mean_x)^d * (y - mean_y) of another context into this one:
+        /// ACS(d) = sum_k nCr(d, k) * ( (-n_b * delta_x / n)^k * (ACS_a(d-k) - (n_b * delta_y / n) * CS_a(d-k)) + (n_a * delta_x / n)^k * (ACS_b(d-k) + (n_a * delta_y / n) * CS_b(d-k)) ), where ACS(0) = 0
+        void mergeACS(const Moments2DContext & other, const Matrix<W> & nCr, int noOfThreads) {
+
+            const W na = static_cast<W>(m_p1Card);
+            const W nb = static_cast<W>(other.m_p1Card);
+            const W n = na + nb;
+            const long long p2WidthLL = static_cast<long long>(m_p2Width);
+
+            Vector<W> deltaX(m_p1Width);
+            for(size_t sample = 0; sample < m_p1Width; sample++){
+                deltaX(sample) = static_cast<W>(other.m_p1M[0](sample)) - m_p1M[0](sample);
+            }
+
+            #pragma omp parallel for schedule(static) num_threads(noOfThreads)
+            for(long long row = 0; row < p2WidthLL; row++){
+
+                const W deltaY = static_cast<W>(other.m_p2M[0](row)) - m_p2M[0](row);
+                const W gammaA = nb * deltaY / n;
+                const W gammaB = na * deltaY / n;
+
+                for(size_t d = m_p12ACSOrder; d >= 1; d--){
+
+                    T * p_acs = m_p12ACS[d-1].data() + row * m_p1Width;
+
+                    for(size_t sample = 0; sample < m_p1Width; sample++){
+
+                        const W alpha = (-1.0) * nb * deltaX(sample) / n;
+                        const W beta = na * deltaX(sample) / n;
+
+                        W sum = 0;
+                        W alphaPow = 1;
+                        W betaPow = 1;
+
+                        for(size_t k = 0; k <= d; k++){
+
+                            size_t j = d - k;
+                            W acsA = (j == 0) ? 0 : m_p12ACS[j-1].data()[row * m_p1Width + sample];
+                            W acsB = (j == 0) ? 0 : other.m_p12ACS[j-1].data()[row * m_p1Width + sample];
+                            W csA = (j == 0) ? na : ((j == 1) ? 0 : m_p1CS[j-2](sample));
+                            W csB = (j == 0) ? nb : ((j == 1) ? 0 : other.m_p1CS[j-2](sample));
+
+                            sum += nCr(d, k) * (alphaPow * (acsA - gammaA * csA) + betaPow * (acsB + gammaB * csB));
+
+                            alphaPow *= alpha;
+                            betaPow *= beta;
+
+                        }
+
+                        p_acs[sample] = sum;
+
+                    }
+
+                }
+
+            }
+
+        }
+
         size_t m_p1Width;
         size_t m_p2Width;
 
@@ -498,6 +738,121 @@ namespace SICAK {
         std::unique_ptr<Matrix<T>[]> m_p12ACS;
     };
 
+    /// Per-sample histograms of integer samples, the sample values offset ... offset + bins - 1 are counted.
+    /// An exact alternative to the moments for narrow sample types: moments of any order can be derived from the histograms.
+    class HistogramContext {
+
+    public:
+
+        /// Maximal number of values counted in a single bin
+        static const size_t MAX_CARD = UINT32_MAX;
+        /// Unused bins padding the histograms of every sample, avoids the cache set conflicts of power-of-two strides
+        static const size_t PADDING = 16;
+
+        /// Constructs an empty context, needs to be initialized first (init)
+        HistogramContext(): m_width(0), m_bins(0), m_offset(0), m_card(0), m_counts() {}
+
+        /// Constructs an initialized context
+        HistogramContext(size_t width, size_t bins, long long offset): m_width(0), m_bins(0), m_offset(0), m_card(0), m_counts() {
+            (*this).init(width, bins, offset);
+        }
+
+        virtual ~HistogramContext() {}
+
+        virtual void init(size_t width, size_t bins, long long offset) {
+            m_width = width;
+            m_bins = bins;
+            m_offset = offset;
+            m_counts.init(bins + PADDING, width);
+            (*this).reset();
+        }
+
+        /// Zeroes all the counts
+        virtual void reset() {
+            m_counts.fill(0);
+            m_card = 0;
+        }
+
+        /// Number of samples per trace
+        virtual size_t width() const { return m_width; }
+        /// Number of bins per sample
+        virtual size_t bins() const { return m_bins; }
+        /// Value counted in the first bin
+        virtual long long offset() const { return m_offset; }
+
+        /// Number of traces counted
+        virtual size_t & card() { return m_card; }
+        virtual const size_t & card() const { return m_card; }
+
+        /// Distance between the histograms of the neighbouring samples
+        virtual size_t stride() const { return m_counts.cols(); }
+
+        /// Counts of the values, bins of a single sample are stored contiguously (col = bin, row = sample)
+        virtual Matrix<uint32_t> & counts() { return m_counts; }
+        virtual const Matrix<uint32_t> & counts() const { return m_counts; }
+
+        /// Size of the histograms in bytes
+        virtual size_t size() const { return m_counts.size(); }
+
+    protected:
+
+        size_t m_width;
+        size_t m_bins;
+        long long m_offset;
+        size_t m_card;
+
+        Matrix<uint32_t> m_counts;
+
+    };
+
+    /* Split-and-combine accumulation */
+
+    /// Minimal number of traces per partial context, smaller chunks are not worth the merge
+    const size_t SPLIT_MIN_TRACES = 64;
+    /// Maximal total size of the partial contexts in bytes
+    const size_t SPLIT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+    /// Returns the number of partial contexts the traces should be split into, 1 stands for no split
+    template <class T>
+    size_t SplitMergeParts(const Moments2DContext<T> & c, size_t noOfTraces, size_t threads, size_t memoryBudget = SPLIT_MEMORY_BUDGET) {
+
+        size_t parts = static_cast<size_t>(WorkerThreads(threads));
+        parts = std::min(parts, noOfTraces / SPLIT_MIN_TRACES);
+        parts = std::min(parts, memoryBudget / std::max(c.size(), static_cast<size_t>(1)));
+
+        return std::max(parts, static_cast<size_t>(1));
+
+    }
+
+    /// Splits the traces into contiguous chunks, accumulates every chunk into its own partial context in parallel
+    /// and merges the partial contexts into 'c' in a fixed order, i.e. the result does not depend on the scheduling.
+    /// The addTraces(context, firstTrace, noOfTraces) functor is expected to run single-threaded.
+    template <class T, class F>
+    void SplitMergeAddTraces(Moments2DContext<T> & c, size_t noOfTraces, size_t parts, F addTraces) {
+
+        std::vector<std::unique_ptr<Moments2DContext<T>>> partials(parts);
+        const long long partsLL = static_cast<long long>(parts);
+
+        for(size_t part = 0; part < parts; part++){
+            partials[part].reset(new Moments2DContext<T>(c.p1Width(), c.p2Width(), c.p1MOrder(), c.p2MOrder(), c.p1CSOrder(), c.p2CSOrder(), c.p12ACSOrder(), 0));
+        }
+
+        #pragma omp parallel for schedule(static, 1) num_threads(static_cast<int>(parts))
+        for(long long part = 0; part < partsLL; part++){
+
+            size_t first, last;
+            SplitRange(noOfTraces, parts, static_cast<size_t>(part), first, last);
+
+            addTraces(*(partials[part]), first, last - first);
+
+        }
+
+        for(size_t part = 0; part < parts; part++){
+            c.merge(*(partials[part]), parts);
+        }
+
+    }
+
 }
 
 #endif // TYPESMOMENT_HPP
@@ -19,8 +19,8 @@
 
 #include "tcpaaction.h"
 
-TCPAAction::TCPAAction(QString name, QString info, std::function<void(void)> run)
-    : m_name(name), m_info(info), m_run(run)
+TCPAAction::TCPAAction(QString name, QString info, std::function<void(void)> run, std::function<void(void)> abort, std::function<std::pair<size_t, size_t>(void)> progress)
+    : m_name(name), m_info(info), m_run(run), m_abort(abort), m_progress(progress)
 {
 
 }
@@ -47,6 +47,15 @@ void TCPAAction::run()
 
 void TCPAAction::abort()
 {
+    if (m_abort)
+        m_abort();
+}
+
+std::pair<size_t, size_t> TCPAAction::getProgress() const
+{
+    if (m_progress)
+        return m_progress();
 
+    return {0, 0};
 }
 
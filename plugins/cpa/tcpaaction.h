@@ -25,7 +25,8 @@
 class TCPAAction : public TAnalAction
 {
 public:
-    explicit TCPAAction(QString name, QString info, std::function<void(void)> run);
+    /// The abort stops the run at the next checkpoint, the progress reports the processed and all the work items; both are optional
+    explicit TCPAAction(QString name, QString info, std::function<void(void)> run, std::function<void(void)> abort = nullptr, std::function<std::pair<size_t, size_t>(void)> progress = nullptr);
 
     /// AnalAction name
     virtual QString getName() const override;
@@ -38,11 +39,15 @@ public:
     virtual void run() override;
     /// Abort the current run of analytic action
     virtual void abort() override;
+    /// Get the progress of the current run
+    virtual std::pair<size_t, size_t> getProgress() const override;
 
 private:
     QString m_name;
     QString m_info;
     std::function<void(void)> m_run;
+    std::function<void(void)> m_abort;
+    std::function<std::pair<size_t, size_t>(void)> m_progress;
 };
 
 #endif // TCPAACTION_H
@@ -20,13 +20,16 @@
 #include "tcpadevice.h"
 
 #include <QtGlobal>
+#include <cstring>
+#include <limits>
+#include <utility>
 
 #include "tcpaaction.h"
 #include "tcpainputstream.h"
 #include "tcpaoutputstream.h"
 #include "cpa.hpp"
 
-TCPADevice::TCPADevice(): m_traceLength(0), m_predictCount(0), m_traceType("Unsigned 8 bit"), m_predictType("Unsigned 8 bit"), m_order(1) {
+TCPADevice::TCPADevice(): m_traceLength(0), m_predictCount(0), m_traceType("Unsigned 8 bit"), m_predictType("Unsigned 8 bit"), m_order(1), m_threads(0), m_singlePrecision(false), m_singleOutput(false), m_snapshotInterval(0), m_reducedOutput(false), m_topK(10), m_windowWidth(0), m_windowOffset(0), m_windowCard(0), m_checkpointGroup("/cpa"), m_input(&m_inputs[0]), m_computeInput(&m_inputs[1]), m_ingestStop(false), m_busy(false), m_abort(false), m_processedTraces(0), m_totalTraces(0), m_snapshotRecord(0) {
 
     m_preInitParams = TConfigParam("CPA configuration", "", TConfigParam::TType::TDummy, "");
 
@@ -59,6 +62,38 @@ TCPADevice::TCPADevice(): m_traceLength(0), m_predictCount(0), m_traceType("Unsi
     TConfigParam order = TConfigParam("Maximum order", "1", TConfigParam::TType::TUInt, "Maximum order of the CPA");
     m_preInitParams.addSubParam(order);
 
+    TConfigParam threads = TConfigParam("Worker threads", "0", TConfigParam::TType::TUInt, "Number of threads used for the computation (0 = all available cores). Results are reproducible for a fixed number of threads.");
+    m_preInitParams.addSubParam(threads);
+
+    TConfigParam precision = TConfigParam("Accumulator precision", "Double (64 bit)", TConfigParam::TType::TEnum, "Precision of the accumulated statistics. Single precision halves the memory and bandwidth, every batch of traces is accumulated in double precision and rounded into the statistics once.");
+    precision.addEnumValue("Double (64 bit)");
+    precision.addEnumValue("Single (32 bit)");
+    m_preInitParams.addSubParam(precision);
+
+    TConfigParam outputType = TConfigParam("Output data type", "Real 64 bit (double)", TConfigParam::TType::TEnum, "Data type of the correlation coefficients");
+    outputType.addEnumValue("Real 64 bit (double)");
+    outputType.addEnumValue("Real 32 bit (float)");
+    m_preInitParams.addSubParam(outputType);
+
+    TConfigParam snapshotInterval = TConfigParam("Snapshot every N traces", "0", TConfigParam::TType::TUInt, "Records the peak absolute correlation of every key candidate after every N traces into the snapshot streams (0 = disabled)");
+    m_preInitParams.addSubParam(snapshotInterval);
+
+    TConfigParam outputMode = TConfigParam("Output mode", "Correlation matrices", TConfigParam::TType::TEnum, "Correlation matrices, or only the peak correlation of every key candidate and a ranking of the candidates (the matrices are never allocated)");
+    outputMode.addEnumValue("Correlation matrices");
+    outputMode.addEnumValue("Peaks and top-k");
+    TConfigParam topK = TConfigParam("Top-k candidates", "10", TConfigParam::TType::TUInt, "The number of the best ranked key candidates in the top-k streams");
+    outputMode.addSubParam(topK);
+    m_preInitParams.addSubParam(outputMode);
+
+    TConfigParam windowWidth = TConfigParam("Sample window (samples)", "0", TConfigParam::TType::TUInt, "Processes the traces in windows of the given number of samples, only the statistics of a single window are kept in memory and the rest is stored in temporary files (0 = whole traces at once)");
+    m_preInitParams.addSubParam(windowWidth);
+
+    m_postInitParams = TConfigParam("CPA checkpoint", "", TConfigParam::TType::TDummy, "");
+    TConfigParam checkpointFile = TConfigParam("Checkpoint file", "", TConfigParam::TType::TFileName, "HDF5 file the accumulated statistics are saved into and loaded from by the Save/Load context actions");
+    m_postInitParams.addSubParam(checkpointFile);
+    TConfigParam checkpointGroup = TConfigParam("Checkpoint group", "/cpa", TConfigParam::TType::TString, "Group of the HDF5 file holding the checkpoint, it is replaced on every save");
+    m_postInitParams.addSubParam(checkpointGroup);
+
 }
 
 TCPADevice::~TCPADevice() {
@@ -139,30 +174,180 @@ TConfigParam TCPADevice::setPreInitParams(TConfigParam params) {
         orderParam->setState(TConfigParam::TState::TError, "Maximum order must be 1 or greater.");
     }            
 
+    TConfigParam * threadsParam = m_preInitParams.getSubParamByName("Worker threads", &iok);
+    if(!iok) {
+        qCritical("Worker threads parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_threads = threadsParam->getValue().toUInt(&iok);
+    if (!iok) {
+        threadsParam->setState(TConfigParam::TState::TError, "Number of worker threads must be a non-negative integer (0 = all available cores).");
+    }
+
+    TConfigParam * precisionParam = m_preInitParams.getSubParamByName("Accumulator precision", &iok);
+    if(!iok) {
+        qCritical("Accumulator precision parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    QString precisionVal = precisionParam->getValue();
+    if(precisionVal == "Double (64 bit)") {
+        m_singlePrecision = false;
+    } else if(precisionVal == "Single (32 bit)") {
+        m_singlePrecision = true;
+    } else {
+        precisionParam->setState(TConfigParam::TState::TError, "Invalid accumulator precision.");
+    }
+
+    TConfigParam * outputTypeParam = m_preInitParams.getSubParamByName("Output data type", &iok);
+    if(!iok) {
+        qCritical("Output data type parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    QString outputTypeVal = outputTypeParam->getValue();
+    if(outputTypeVal == "Real 64 bit (double)") {
+        m_singleOutput = false;
+    } else if(outputTypeVal == "Real 32 bit (float)") {
+        m_singleOutput = true;
+    } else {
+        outputTypeParam->setState(TConfigParam::TState::TError, "Invalid output data type.");
+    }
+
+    TConfigParam * snapshotIntervalParam = m_preInitParams.getSubParamByName("Snapshot every N traces", &iok);
+    if(!iok) {
+        qCritical("Snapshot interval parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_snapshotInterval = snapshotIntervalParam->getValue().toUInt(&iok);
+    if (!iok) {
+        snapshotIntervalParam->setState(TConfigParam::TState::TError, "Snapshot interval must be a non-negative integer (0 = disabled).");
+    }
+
+    TConfigParam * outputModeParam = m_preInitParams.getSubParamByName("Output mode", &iok);
+    if(!iok) {
+        qCritical("Output mode parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    QString outputModeVal = outputModeParam->getValue();
+    if(outputModeVal == "Correlation matrices") {
+        m_reducedOutput = false;
+    } else if(outputModeVal == "Peaks and top-k") {
+        m_reducedOutput = true;
+    } else {
+        outputModeParam->setState(TConfigParam::TState::TError, "Invalid output mode.");
+    }
+
+    TConfigParam * topKParam = outputModeParam->getSubParamByName("Top-k candidates", &iok);
+    if(!iok) {
+        qCritical("Top-k candidates parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_topK = topKParam->getValue().toUInt(&iok);
+    if (!iok || m_topK < 1) {
+        topKParam->setState(TConfigParam::TState::TError, "The number of top-k candidates must be a positive integer.");
+    }
+
+    TConfigParam * windowWidthParam = m_preInitParams.getSubParamByName("Sample window (samples)", &iok);
+    if(!iok) {
+        qCritical("Sample window parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_windowWidth = windowWidthParam->getValue().toUInt(&iok);
+    if (!iok) {
+        windowWidthParam->setState(TConfigParam::TState::TError, "Sample window must be a non-negative integer (0 = whole traces at once).");
+    }
+    if (m_windowWidth >= m_traceLength) {
+        m_windowWidth = 0;
+    }
+
+    // the peaks carry the sample indices in the output data type, float holds the integers exactly up to 2^24
+    if (m_singleOutput && (m_reducedOutput || m_snapshotInterval > 0) && m_traceLength > (size_t(1) << std::numeric_limits<float>::digits)) {
+        outputTypeParam->setState(TConfigParam::TState::TError, "The float output can't hold the sample indices of the peaks for traces longer than 16777216 samples, use double.");
+    }
+
     return m_preInitParams;
 
 }
 
 void TCPADevice::init(bool *ok) {
 
-    m_analActions.append(new TCPAAction("Compute correlation matrix (+ flush streams)", "", [=](){ computeCorrelations(); }));
-    m_analActions.append(new TCPAAction("Reset (delete all data)", "", [=](){ resetContexts(); }));
+    m_analActions.append(new TCPAAction("Compute correlation matrix (+ flush streams)", "", [=](){ runAction([=](){ computeCorrelations(); }); }, [=](){ abortAction(); }, [=](){ return getProgress(); }));
+    m_analActions.append(new TCPAAction("Reset (delete all data)", "", [=](){ runAction([=](){ resetContexts(); }); }));
+    m_analActions.append(new TCPAAction("Save context (checkpoint)", "Saves the accumulated statistics into the checkpoint file", [=](){ runAction([=](){ saveContext(); }); }));
+    m_analActions.append(new TCPAAction("Load context (resume)", "Replaces the accumulated statistics with the ones from the checkpoint file", [=](){ runAction([=](){ loadContext(); }); }));
 
     m_analOutputStreams.append(new TCPAOutputStream("Traces", "Stream of traces", [=](const uint8_t * buffer, size_t length){ return addTraces(buffer, length); }));
     m_analOutputStreams.append(new TCPAOutputStream("Predictions", "Stream of predictions", [=](const uint8_t * buffer, size_t length){ return addPredicts(buffer, length); }));
 
     for(int order = 1; order <= m_order; order++){
 
-        QString streamName = QString("%1-order correlation matrix").arg(order);
-        m_analInputStreams.append(new TCPAInputStream(streamName, "Stream of correlation coefficients", [=, order0 = order](uint8_t * buffer, size_t length){ return getCorrelations(buffer, length, order0); }, [=, order0 = order](){ return availableBytes(order0); }));
+        // the reduced output keeps the peaks in place of the correlation matrix
+        if(m_reducedOutput) {
+
+            QString streamName = QString("%1-order peaks").arg(order);
+            m_analInputStreams.append(new TCPAInputStream(streamName, "Stream of peak correlations of every key candidate", [=, order0 = order](uint8_t * buffer, size_t length){ return getCorrelations(buffer, length, order0); }, [=, order0 = order](){ return availableBytes(order0); }));
+
+            streamName = QString("%1-order top-k").arg(order);
+            m_analInputStreams.append(new TCPAInputStream(streamName, "Stream of the best ranked key candidates", [=, order0 = order](uint8_t * buffer, size_t length){ return getTopK(buffer, length, order0); }, [=, order0 = order](){ return availableTopKBytes(order0); }));
+
+        } else {
+
+            QString streamName = QString("%1-order correlation matrix").arg(order);
+            m_analInputStreams.append(new TCPAInputStream(streamName, "Stream of correlation coefficients", [=, order0 = order](uint8_t * buffer, size_t length){ return getCorrelations(buffer, length, order0); }, [=, order0 = order](){ return availableBytes(order0); }));
+
+        }
 
         m_correlations.append(new SICAK::Matrix<qreal>());
+        m_correlationsSingle.append(new SICAK::Matrix<float>());
         m_position.append(0);
 
+        m_ranking.append(new SICAK::Matrix<qreal>());
+        m_rankingSingle.append(new SICAK::Matrix<float>());
+        m_rankingPosition.append(0);
+
+        m_correlationStore.append(new TFileBuffer());
+
     }
 
-    m_context = SICAK::Moments2DContext<qreal>(m_traceLength, m_predictCount, 1, 1, 2 * m_order, 2, m_order);
-    m_context.reset();
+    for(int order = 1; order <= m_order && m_snapshotInterval > 0; order++){
+
+        QString streamName = QString("%1-order snapshots").arg(order);
+        m_analInputStreams.append(new TCPAInputStream(streamName, "Stream of correlation peaks of every key candidate after every N traces", [=, order0 = order](uint8_t * buffer, size_t length){ return getSnapshots(buffer, length, order0); }, [=, order0 = order](){ return availableSnapshotBytes(order0); }));
+
+        m_snapshots.append(QByteArray());
+        m_snapshotPosition.append(0);
+        m_snapshotBase.append(0);
+
+    }
+
+    // in the tiled mode, the context is initialized for every window separately
+    if(m_windowWidth > 0) {
+        m_windowCard = 0;
+    } else if(m_singlePrecision) {
+        m_contextSingle = SICAK::Moments2DContext<float>(m_traceLength, m_predictCount, 1, 1, 2 * m_order, 2, m_order);
+        m_contextSingle.reset();
+    } else {
+        m_context = SICAK::Moments2DContext<qreal>(m_traceLength, m_predictCount, 1, 1, 2 * m_order, 2, m_order);
+        m_context.reset();
+    }
+
+    // the tiled mode keeps the submitted traces pending until the computation
+    if(m_windowWidth == 0) {
+        startIngestion();
+    }
 
     if (ok != nullptr) *ok = true;
 
@@ -170,6 +355,8 @@ void TCPADevice::init(bool *ok) {
 
 void TCPADevice::deInit(bool *ok) {
 
+    stopIngestion();
+
     for (int i = 0; i < m_analActions.length(); i++) {
         delete m_analActions[i];
     }
@@ -186,25 +373,84 @@ void TCPADevice::deInit(bool *ok) {
     m_analOutputStreams.clear();
 
     m_context.reset();
+    m_contextSingle.reset();
 
-    m_traces.clear();
+    for (TInput & input : m_inputs) {
+        input.traces.clear();
+        input.predicts.clear();
+        input.pendingTraces.clear();
+        input.ingestedTraces = 0;
+    }
 
     for (int i = 0; i < m_correlations.length(); i++) {
         delete m_correlations[i];
     }
     m_correlations.clear();
 
+    for (int i = 0; i < m_correlationsSingle.length(); i++) {
+        delete m_correlationsSingle[i];
+    }
+    m_correlationsSingle.clear();
+
     m_position.clear();
 
+    for (int i = 0; i < m_ranking.length(); i++) {
+        delete m_ranking[i];
+        delete m_rankingSingle[i];
+    }
+    m_ranking.clear();
+    m_rankingSingle.clear();
+    m_rankingPosition.clear();
+
+    m_snapshots.clear();
+    m_snapshotPosition.clear();
+    m_snapshotBase.clear();
+
+    for (int i = 0; i < m_correlationStore.length(); i++) {
+        delete m_correlationStore[i];
+    }
+    m_correlationStore.clear();
+
+    m_contextStore.clear();
+    m_windowCard = 0;
+
     if (ok != nullptr) *ok = true;
 }
 
 TConfigParam TCPADevice::getPostInitParams() const {
-    return TConfigParam();
+    return m_postInitParams;
 }
 
 TConfigParam TCPADevice::setPostInitParams(TConfigParam params) {
-    return TConfigParam();
+
+    bool iok;
+
+    m_postInitParams = params;
+    m_postInitParams.resetState(true);
+
+    TConfigParam * checkpointFileParam = m_postInitParams.getSubParamByName("Checkpoint file", &iok);
+    if(!iok) {
+        qCritical("Checkpoint file parameter not found in the post-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_checkpointFile = checkpointFileParam->getValue();
+
+    TConfigParam * checkpointGroupParam = m_postInitParams.getSubParamByName("Checkpoint group", &iok);
+    if(!iok) {
+        qCritical("Checkpoint group parameter not found in the post-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_checkpointGroup = checkpointGroupParam->getValue();
+    if (!m_checkpointGroup.startsWith('/') || m_checkpointGroup.length() < 2) {
+        checkpointGroupParam->setState(TConfigParam::TState::TError, "Checkpoint group must be an absolute path other than the root group (e.g., /cpa).");
+    }
+
+    return m_postInitParams;
+
 }
 
 QList<TAnalAction *> TCPADevice::getActions() const
@@ -224,45 +470,230 @@ QList<TAnalOutputStream *> TCPADevice::getOutputDataStreams() const
 
 bool TCPADevice::isBusy() const
 {
-    return false;
+    return m_busy;
+}
+
+void TCPADevice::abortAction(){
+    m_abort = true;
+}
+
+std::pair<size_t, size_t> TCPADevice::getProgress() const {
+    return {m_processedTraces, m_totalTraces};
+}
+
+void TCPADevice::runAction(const std::function<void(void)> & action){
+
+    std::lock_guard<std::recursive_mutex> computeLock(m_computeMutex);
+    std::lock_guard<std::recursive_mutex> resultsLock(m_resultsMutex);
+
+    m_abort = false;
+    m_processedTraces = 0;
+    m_totalTraces = 0;
+    m_busy = true;
+
+    action();
+
+    m_busy = false;
+    m_totalTraces = 0;
+
 }
 
 size_t TCPADevice::addTraces(const uint8_t * buffer, size_t length){
 
-    m_traces.reserve(m_traces.size() + length); // preallocate space
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
 
-    for(int i = 0; i < length; i++){
-        m_traces.append(buffer[i]);
+    // the tiled mode keeps the pending traces in a file
+    if(m_windowWidth > 0) {
+        return m_input->pendingTraces.append(buffer, length) ? length : 0;
     }
 
+    m_input->traces.append(buffer, length);
+
+    // the complete batches are added to the context by the ingestion thread
+    m_ingestCondition.notify_one();
+
     return length;
 
 }
 
 size_t TCPADevice::addPredicts(const uint8_t * buffer, size_t length){
 
-    m_predicts.reserve(m_predicts.size() + length); // preallocate space
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
 
-    for(int i = 0; i < length; i++){
-        m_predicts.append(buffer[i]);
+    m_input->predicts.append(buffer, length);
+
+    // the tiled mode replays the predictions along with the pending traces
+    if(m_windowWidth == 0) {
+        m_ingestCondition.notify_one();
     }
 
     return length;
 
 }
 
+bool TCPADevice::ingestTraces(TInput & input){
+
+    const size_t traceSize = getTypeSize(m_traceType) * m_traceLength;
+    const size_t predictSize = getTypeSize(m_predictType) * m_predictCount;
+    const size_t batchTraces = std::max<size_t>(INGEST_BATCH_SIZE / traceSize, 1);
+
+    // only the traces whose predictions have arrived too are complete
+    size_t noOfTraces = std::min(input.traces.size() / traceSize, input.predicts.size() / predictSize);
+
+    while(noOfTraces > 0) {
+
+        if(m_abort)
+            return false;
+
+        const size_t count = std::min(batchTraces, noOfTraces);
+
+        addRawTracesToContext(input.traces.data(), input.predicts.data(), count);
+
+        input.traces.consume(count * traceSize);
+        input.predicts.consume(count * predictSize);
+        input.ingestedTraces += count;
+        noOfTraces -= count;
+        m_processedTraces += count;
+
+    }
+
+    return true;
+
+}
+
+void TCPADevice::ingestionLoop(){
+
+    const size_t traceSize = getTypeSize(m_traceType) * m_traceLength;
+    const size_t predictSize = getTypeSize(m_predictType) * m_predictCount;
+    const size_t batchTraces = std::max<size_t>(INGEST_BATCH_SIZE / traceSize, 1);
+
+    // only the traces whose predictions have arrived too are complete
+    auto batchComplete = [&](){
+        return std::min(m_input->traces.size() / traceSize, m_input->predicts.size() / predictSize) >= batchTraces;
+    };
+
+    std::unique_lock<std::mutex> inputLock(m_inputMutex);
+
+    while(true) {
+
+        m_ingestCondition.wait(inputLock, [&](){ return m_ingestStop || batchComplete(); });
+        if(m_ingestStop)
+            return;
+
+        // the contexts are locked first, a computation may take the input over meanwhile
+        inputLock.unlock();
+        std::lock_guard<std::recursive_mutex> computeLock(m_computeMutex);
+        inputLock.lock();
+
+        if(m_ingestStop || !batchComplete())
+            continue;
+
+        // the complete traces are handed over, so the submission goes on while they are added to the context
+        const size_t noOfTraces = std::min(m_input->traces.size() / traceSize, m_input->predicts.size() / predictSize);
+        m_ingestTraces.takeFront(m_input->traces, noOfTraces * traceSize);
+        m_ingestPredicts.takeFront(m_input->predicts, noOfTraces * predictSize);
+        m_input->ingestedTraces += noOfTraces;
+        inputLock.unlock();
+
+        for(size_t added = 0; added < noOfTraces; added += batchTraces) {
+
+            const size_t count = std::min(batchTraces, noOfTraces - added);
+            addRawTracesToContext(m_ingestTraces.data() + added * traceSize, m_ingestPredicts.data() + added * predictSize, count);
+
+        }
+
+        m_ingestTraces.consume(m_ingestTraces.size());
+        m_ingestPredicts.consume(m_ingestPredicts.size());
+
+        inputLock.lock();
+
+    }
+
+}
+
+void TCPADevice::startIngestion(){
+
+    m_ingestStop = false;
+    m_ingestThread = std::thread(&TCPADevice::ingestionLoop, this);
+
+}
+
+void TCPADevice::stopIngestion(){
+
+    if(!m_ingestThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+        m_ingestStop = true;
+    }
+
+    m_ingestCondition.notify_all();
+    m_ingestThread.join();
+
+    m_ingestTraces.clear();
+    m_ingestPredicts.clear();
+
+}
+
+void TCPADevice::restoreInput(){
+
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
+
+    m_computeInput->traces.append(m_input->traces.data(), m_input->traces.size());
+    m_computeInput->predicts.append(m_input->predicts.data(), m_input->predicts.size());
+    m_computeInput->pendingTraces.append(m_input->pendingTraces);
+    m_computeInput->ingestedTraces += m_input->ingestedTraces;
+
+    m_input->traces.clear();
+    m_input->predicts.clear();
+    m_input->pendingTraces.clear();
+    m_input->ingestedTraces = 0;
+
+    std::swap(m_input, m_computeInput);
+
+}
+
 void TCPADevice::resetContexts() {
 
     m_context.reset();
-    m_traces.clear();
-    m_predicts.clear();
+    m_contextSingle.reset();
+
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+        for (TInput & input : m_inputs) {
+            input.traces.clear();
+            input.predicts.clear();
+            input.pendingTraces.clear();
+            input.ingestedTraces = 0;
+        }
+    }
+
+    m_contextStore.clear();
+    m_windowCard = 0;
+
+    for (int i = 0; i < m_correlationStore.length(); i++) {
+        m_correlationStore[i]->clear();
+    }
 
     for (int i = 0; i < m_correlations.length(); i++) {
         m_correlations[i]->fill(0);
+        m_correlationsSingle[i]->fill(0);
     }
 
     for (int i = 0; i < m_position.length(); i++) {
-        m_position[i] = m_correlations[i]->size();
+        m_position[i] = correlationsSize(i + 1);
+    }
+
+    for (int i = 0; i < m_ranking.length(); i++) {
+        m_ranking[i]->fill(0);
+        m_rankingSingle[i]->fill(0);
+        m_rankingPosition[i] = rankingSize(i + 1);
+    }
+
+    for (int i = 0; i < m_snapshots.length(); i++) {
+        m_snapshots[i].clear();
+        m_snapshotPosition[i] = 0;
     }
 
     qInfo("All previously submitted or computed (unread) data have been erased.");
@@ -294,540 +725,642 @@ size_t TCPADevice::getTypeSize(const QString & dataType){
 
 }
 
-void TCPADevice::computeCorrelations(){
+template <class U, class V>
+void TCPADevice::addTracesToContext(const U * traces, const V * predicts, size_t noOfTraces){
 
-    if(m_traces.size() % (getTypeSize(m_traceType) * m_traceLength) != 0){
-        qCritical("Buffer does not contain a valid amount of traces/samples");
-        return;
-    }
+    size_t processed = 0;
+    const size_t width = m_singlePrecision ? m_contextSingle.p1Width() : m_context.p1Width();
 
-    if(m_predicts.size() % (getTypeSize(m_predictType) * m_predictCount) != 0){
-        qCritical("Buffer does not contain a valid amount of predictions");
-        return;
-    }
+    // the traces are split at the snapshot checkpoints
+    while(processed < noOfTraces) {
 
-    size_t noOfTraces = m_traces.size() / (getTypeSize(m_traceType) * m_traceLength);
-    size_t noOfPredictSets = m_predicts.size() / (getTypeSize(m_predictType) * m_predictCount);
+        size_t chunk = noOfTraces - processed;
+        size_t card = m_singlePrecision ? m_contextSingle.p1Card() : m_context.p1Card();
 
-    if(noOfTraces != noOfPredictSets){
-        qCritical("Number of traces and number of prediction sets does not match!");
-        return;
-    }
+        if(m_snapshotInterval > 0) {
+            chunk = std::min(chunk, m_snapshotInterval - (card % m_snapshotInterval));
+        }
 
-    qInfo("Unread correlation matrices were erased. The submitted data will be added to all the previously submitted data (unless the Reset action was run), and the new correlations will be computed upon all of these.");
-    qInfo(QString("Now processing %1 bytes of power traces (%2 power traces, %3 samples each) and %4 bytes of leakage predictions (%2 sets, one for every trace, each consisting of %5 leakage predictions).").arg(m_traces.size()).arg(noOfTraces).arg(m_traceLength).arg(m_predicts.size()).arg(m_predictCount).toLatin1());
+        if(m_singlePrecision) {
+            addTracesToContext(m_contextSingle, traces + processed * width, predicts + processed * m_predictCount, chunk);
+        } else {
+            addTracesToContext(m_context, traces + processed * width, predicts + processed * m_predictCount, chunk);
+        }
 
-    // Add traces to the context
-    // ... sorry (need explicit cast on both traces and predictions, shit happens)
-    if(m_traceType == "Unsigned 8 bit") {
+        processed += chunk;
+        card += chunk;
 
-        if(m_predictType == "Unsigned 8 bit") {
+        if(m_snapshotInterval > 0 && card % m_snapshotInterval == 0) {
+            if(m_singlePrecision) {
+                takeSnapshots(m_contextSingle);
+            } else {
+                takeSnapshots(m_context);
+            }
+        }
 
-            if(m_order == 1) {
+    }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+}
 
-            } else {
+template <class T, class U, class V>
+void TCPADevice::addTracesToContext(SICAK::Moments2DContext<T> & context, const U * traces, const V * predicts, size_t noOfTraces){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    const size_t width = context.p1Width();
 
-            }
+    if(m_order == 1) {
 
-        } else if(m_predictType == "Signed 8 bit"){
+        // the batched engine sweeps the cross-sum matrix once per batch instead of once per trace,
+        // single precision contexts always go through it, as it accumulates the batch in double precision
+        if(noOfTraces > 1 || m_singlePrecision) {
+            SICAK::UniFoCpaAddTracesBatched(context, traces, predicts, noOfTraces, m_predictCount, width, m_threads);
+        } else {
+            SICAK::UniFoCpaAddTraces(context, traces, predicts, noOfTraces, m_predictCount, width, m_threads);
+        }
 
-            if(m_order == 1) {
+    } else {
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        // every thread fills its own partial context with a contiguous chunk of traces, the partial contexts are merged afterwards
+        size_t parts = SICAK::SplitMergeParts(context, noOfTraces, m_threads);
 
-            } else {
+        if(parts > 1) {
+            SICAK::SplitMergeAddTraces(context, noOfTraces, parts, [&](SICAK::Moments2DContext<T> & partial, size_t firstTrace, size_t count){
+                SICAK::UniHoCpaAddTraces(partial, traces + firstTrace * width, predicts + firstTrace * m_predictCount, count, m_predictCount, width, m_order, 1);
+            });
+        } else {
+            SICAK::UniHoCpaAddTraces(context, traces, predicts, noOfTraces, m_predictCount, width, m_order, m_threads);
+        }
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    }
 
-            }
+}
 
-        } else if(m_predictType == "Unsigned 16 bit"){
+template <class T>
+void TCPADevice::takeSnapshots(const SICAK::Moments2DContext<T> & context){
 
-            if(m_order == 1) {
+    for(int order = 1; order <= m_order; order++){
+        if(m_singleOutput) {
+            appendSnapshot<float>(context, order);
+        } else {
+            appendSnapshot<qreal>(context, order);
+        }
+    }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    m_snapshotRecord++;
 
-            } else {
+}
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+template <class R, class T>
+void TCPADevice::appendSnapshot(const SICAK::Moments2DContext<T> & context, size_t order){
 
-            }
+    SICAK::Matrix<R> peaks;
+    SICAK::UniCpaComputePeaks(context, peaks, order, m_threads);
 
-        } else if(m_predictType == "Signed 16 bit"){
+    // the record: number of traces, then max |r| and its sample index for every key candidate
+    R noOfTraces = static_cast<R>(context.p1Card());
+    QByteArray & snapshots = m_snapshots[order-1];
 
-            if(m_order == 1) {
+    // in the tiled mode, the first window creates the record and the other windows keep the higher peaks
+    if(m_windowOffset > 0) {
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        const size_t recordSize = sizeof(R) + peaks.size();
+        uint8_t * p_record = reinterpret_cast<uint8_t *>(snapshots.data()) + m_snapshotBase[order-1] + m_snapshotRecord * recordSize + sizeof(R);
 
-            } else {
+        for(size_t candidate = 0; candidate < peaks.rows(); candidate++){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+            R peak[2];
+            std::memcpy(peak, p_record + candidate * sizeof(peak), sizeof(peak));
 
+            if(peaks(0, candidate) > peak[0]) {
+                peak[0] = peaks(0, candidate);
+                peak[1] = peaks(1, candidate) + static_cast<R>(m_windowOffset);
+                std::memcpy(p_record + candidate * sizeof(peak), peak, sizeof(peak));
             }
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+        }
 
-            if(m_order == 1) {
+        return;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    }
 
-            } else {
+    snapshots.append(reinterpret_cast<const char *>(&noOfTraces), sizeof(R));
+    snapshots.append(reinterpret_cast<const char *>(peaks.data()), peaks.size());
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+}
 
-            }
+template <class T>
+bool TCPADevice::computeCorrelationMatrices(const SICAK::Moments2DContext<T> & context){
 
-        } else if(m_predictType == "Signed 32 bit"){
+    if(m_singleOutput) {
+        return computeCorrelationMatrices(context, m_correlationsSingle, m_rankingSingle);
+    } else {
+        return computeCorrelationMatrices(context, m_correlations, m_ranking);
+    }
 
-            if(m_order == 1) {
+}
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+template <class T, class R>
+bool TCPADevice::computeCorrelationMatrices(const SICAK::Moments2DContext<T> & context, QList<SICAK::Matrix<R> *> & correlations, QList<SICAK::Matrix<R> *> & ranking){
 
-            } else {
+    const bool tiled = m_windowWidth > 0;
+    const bool lastWindow = m_windowOffset + context.p1Width() >= m_traceLength;
+
+    for(int i = 1; i <= m_order; i++){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        if(m_reducedOutput) {
 
+            if(tiled) {
+                // the peaks of the window are merged with the peaks of the previous windows
+                SICAK::Matrix<R> peaks;
+                SICAK::UniCpaComputePeaks(context, peaks, i, m_threads);
+                SICAK::UniCpaMergePeaks(*(correlations[i-1]), peaks, m_windowOffset);
+            } else {
+                SICAK::UniCpaComputePeaks(context, *(correlations[i-1]), i, m_threads);
             }
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+            if(lastWindow) {
+                SICAK::UniCpaRankPeaks(*(correlations[i-1]), *(ranking[i-1]), m_topK);
+            }
 
-            if(m_order == 1) {
+        } else {
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+            SICAK::Matrix<R> window;
+            SICAK::Matrix<R> & matrix = tiled ? window : *(correlations[i-1]);
 
+            if(m_order == 1) {
+                SICAK::UniFoCpaComputeCorrelationMatrix(context, matrix, m_threads);
             } else {
+                SICAK::UniHoCpaComputeCorrelationMatrix(context, matrix, i, m_threads);
+            }
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
+            // the correlations of the window are placed at their samples in the file-backed matrix
+            for(size_t candidate = 0; tiled && candidate < window.rows(); candidate++){
+                if(!m_correlationStore[i-1]->write((candidate * m_traceLength + m_windowOffset) * sizeof(R), reinterpret_cast<const uint8_t *>(&(window(0, candidate))), window.cols() * sizeof(R)))
+                    return false;
             }
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+        }
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
+        m_position[i-1] = 0;
+        m_rankingPosition[i-1] = 0;
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint8_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
-
-        } else {
-            qFatal("Unexpected predictions type while adding traces.");
-            return;
-        }
-
-    } else if(m_traceType == "Signed 8 bit"){
+    }
 
-        if(m_predictType == "Unsigned 8 bit") {
+    return true;
 
-            if(m_order == 1) {
+}
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+bool TCPADevice::computeTiled(const TInput & input, size_t noOfTraces){
 
-            } else {
+    const size_t sampleSize = getTypeSize(m_traceType);
+    const size_t predictSize = getTypeSize(m_predictType) * m_predictCount;
+    const size_t batchTraces = std::max<size_t>(TILE_BUFFER_SIZE / (m_windowWidth * sampleSize), 1);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    std::vector<uint8_t> windowTraces(std::min(batchTraces, noOfTraces) * m_windowWidth * sampleSize);
 
-            }
+    for(int i = 0; i < m_snapshots.length(); i++){
+        m_snapshotBase[i] = m_snapshots[i].size();
+    }
 
-        } else if(m_predictType == "Signed 8 bit"){
+    // all the windows have to see the same traces, the updated contexts replace the stored ones only when the replay completes
+    TFileBuffer store;
+    size_t loadOffset = 0;
+    size_t storeOffset = 0;
 
-            if(m_order == 1) {
+    // the results of an aborted or failed replay only cover some of the windows, they are erased along with its snapshots
+    auto abortTiled = [&](){
+        for(int i = 0; i < m_position.length(); i++){
+            m_position[i] = correlationsSize(i + 1);
+            m_rankingPosition[i] = rankingSize(i + 1);
+        }
+        for(int i = 0; i < m_snapshots.length(); i++){
+            m_snapshots[i].truncate(static_cast<qsizetype>(m_snapshotBase[i]));
+            m_snapshotPosition[i] = std::min(m_snapshotPosition[i], m_snapshotBase[i]);
+        }
+        m_windowOffset = 0;
+        return false;
+    };
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    for(m_windowOffset = 0; m_windowOffset < m_traceLength; m_windowOffset += m_windowWidth){
 
-            } else {
+        const size_t width = std::min(m_windowWidth, m_traceLength - m_windowOffset);
+        m_snapshotRecord = 0;
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        if(m_abort)
+            return abortTiled();
 
-            }
+        bool loaded;
 
-        } else if(m_predictType == "Unsigned 16 bit"){
+        if(m_singlePrecision) {
+            loaded = loadWindowContext(m_contextSingle, width, loadOffset);
+        } else {
+            loaded = loadWindowContext(m_context, width, loadOffset);
+        }
 
-            if(m_order == 1) {
+        if(!loaded)
+            return abortTiled();
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        // the samples of the window are gathered from a batch of the pending traces
+        for(size_t firstTrace = 0; firstTrace < noOfTraces; firstTrace += batchTraces){
 
-            } else {
+            if(m_abort)
+                return abortTiled();
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+            const size_t count = std::min(batchTraces, noOfTraces - firstTrace);
 
+            for(size_t trace = 0; trace < count; trace++){
+                if(!input.pendingTraces.read(((firstTrace + trace) * m_traceLength + m_windowOffset) * sampleSize, windowTraces.data() + trace * width * sampleSize, width * sampleSize))
+                    return abortTiled();
             }
 
-        } else if(m_predictType == "Signed 16 bit"){
+            addRawTracesToContext(windowTraces.data(), input.predicts.data() + firstTrace * predictSize, count);
+            m_processedTraces += count;
 
-            if(m_order == 1) {
+        }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        bool stored;
 
-            } else {
+        if(m_singlePrecision) {
+            stored = storeWindowContext(m_contextSingle, store, storeOffset) && computeCorrelationMatrices(m_contextSingle);
+        } else {
+            stored = storeWindowContext(m_context, store, storeOffset) && computeCorrelationMatrices(m_context);
+        }
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        if(!stored)
+            return abortTiled();
 
-            }
+    }
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+    m_contextStore.swap(store);
+    m_windowOffset = 0;
+    m_windowCard += noOfTraces;
 
-            if(m_order == 1) {
+    return true;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+}
 
-            } else {
+template <class T>
+bool TCPADevice::loadWindowContext(SICAK::Moments2DContext<T> & context, size_t width, size_t & storeOffset){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    context.init(width, m_predictCount, 1, 1, 2 * m_order, 2, m_order);
+    context.reset();
 
-            }
+    bool ok = true;
 
-        } else if(m_predictType == "Signed 32 bit"){
+    context.forEachBuffer([&](T * data, size_t length){
+        // the window has not been stored yet
+        if(ok && m_windowCard > 0) {
+            ok = m_contextStore.read(storeOffset, reinterpret_cast<uint8_t *>(data), length * sizeof(T));
+        }
+        storeOffset += length * sizeof(T);
+    });
 
-            if(m_order == 1) {
+    context.p1Card() = m_windowCard;
+    context.p2Card() = m_windowCard;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    return ok;
 
-            } else {
+}
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+template <class T>
+bool TCPADevice::storeWindowContext(const SICAK::Moments2DContext<T> & context, TFileBuffer & store, size_t & storeOffset){
 
-            }
+    bool ok = true;
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+    context.forEachBuffer([&](const T * data, size_t length){
+        ok = ok && store.write(storeOffset, reinterpret_cast<const uint8_t *>(data), length * sizeof(T));
+        storeOffset += length * sizeof(T);
+    });
 
-            if(m_order == 1) {
+    return ok;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+}
 
-            } else {
+void TCPADevice::saveContext(){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+        if(m_input->traces.size() > 0 || m_input->pendingTraces.size() > 0) {
+            qWarning("Some of the traces submitted since the last computation are not part of the accumulated statistics yet and will not be saved.");
+        }
+    }
 
-            }
+    TContextCheckpoint checkpoint;
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+    if(!checkpoint.create(m_checkpointFile, m_checkpointGroup, getName()))
+        return;
 
-            if(m_order == 1) {
+    bool ok = checkpoint.writeAttribute("trace_length", m_traceLength)
+           && checkpoint.writeAttribute("prediction_count", m_predictCount)
+           && checkpoint.writeAttribute("order", m_order)
+           && checkpoint.writeAttribute("sample_window", m_windowWidth);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    if(ok) {
+        if(m_singlePrecision) {
+            ok = saveContext(checkpoint, m_contextSingle);
+        } else {
+            ok = saveContext(checkpoint, m_context);
+        }
+    }
 
-            } else {
+    // the previous checkpoint is only replaced by a complete one
+    ok = ok && checkpoint.commit();
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int8_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    if(ok) {
+        qInfo(QString("The accumulated statistics of %1 traces were saved into the checkpoint.").arg(m_windowWidth > 0 ? m_windowCard : (m_singlePrecision ? m_contextSingle.p1Card() : m_context.p1Card())).toLatin1());
+    }
 
-            }
+}
 
-        } else {
-            qFatal("Unexpected predictions type while adding traces.");
-            return;
-        }
+template <class T>
+bool TCPADevice::saveContext(TContextCheckpoint & checkpoint, const SICAK::Moments2DContext<T> & context){
 
-    } else if(m_traceType == "Unsigned 16 bit"){
+    if(m_windowWidth == 0) {
+        return checkpoint.writeContext("context", context);
+    }
 
-        if(m_predictType == "Unsigned 8 bit") {
+    // in the tiled mode every window context is restored from the context file and saved separately
+    SICAK::Moments2DContext<T> window;
+    size_t storeOffset = 0;
 
-            if(m_order == 1) {
+    for(size_t offset = 0, windowNo = 0; offset < m_traceLength; offset += m_windowWidth, windowNo++){
+        if(!loadWindowContext(window, std::min(m_windowWidth, m_traceLength - offset), storeOffset) || !checkpoint.writeContext(QString("window_%1").arg(windowNo), window))
+            return false;
+    }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    return true;
 
-            } else {
+}
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+void TCPADevice::loadContext(){
 
-            }
+    TContextCheckpoint checkpoint;
 
-        } else if(m_predictType == "Signed 8 bit"){
+    if(!checkpoint.open(m_checkpointFile, m_checkpointGroup, getName()))
+        return;
 
-            if(m_order == 1) {
+    quint64 traceLength, predictCount, order, windowWidth;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    if(!checkpoint.readAttribute("trace_length", traceLength)
+       || !checkpoint.readAttribute("prediction_count", predictCount)
+       || !checkpoint.readAttribute("order", order)
+       || !checkpoint.readAttribute("sample_window", windowWidth)) {
+        return;
+    }
 
-            } else {
+    if(traceLength != m_traceLength || predictCount != m_predictCount || order != m_order || windowWidth != m_windowWidth) {
+        qCritical("The checkpoint does not match the configuration of the device (trace length, number of predictions, order or sample window).");
+        return;
+    }
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    bool ok;
 
-            }
+    if(m_singlePrecision) {
+        ok = loadContext(checkpoint, m_contextSingle);
+    } else {
+        ok = loadContext(checkpoint, m_context);
+    }
 
-        } else if(m_predictType == "Unsigned 16 bit"){
+    if(ok) {
+        qInfo(QString("The accumulated statistics of %1 traces were loaded from the checkpoint, the submitted traces will be added to them.").arg(m_windowWidth > 0 ? m_windowCard : (m_singlePrecision ? m_contextSingle.p1Card() : m_context.p1Card())).toLatin1());
+    }
 
-            if(m_order == 1) {
+}
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+template <class T>
+bool TCPADevice::loadContext(TContextCheckpoint & checkpoint, SICAK::Moments2DContext<T> & context){
 
-            } else {
+    // the current statistics are only replaced once the whole checkpoint has been read
+    if(m_windowWidth == 0) {
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        SICAK::Moments2DContext<T> loaded(m_traceLength, m_predictCount, 1, 1, 2 * m_order, 2, m_order);
 
-            }
+        if(!checkpoint.readContext("context", loaded))
+            return false;
 
-        } else if(m_predictType == "Signed 16 bit"){
+        context = std::move(loaded);
+        return true;
 
-            if(m_order == 1) {
+    }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    SICAK::Moments2DContext<T> window;
+    TFileBuffer store;
+    size_t storeOffset = 0;
+    size_t card = 0;
 
-            } else {
+    for(size_t offset = 0, windowNo = 0; offset < m_traceLength; offset += m_windowWidth, windowNo++){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        window.init(std::min(m_windowWidth, m_traceLength - offset), m_predictCount, 1, 1, 2 * m_order, 2, m_order);
 
-            }
+        if(!checkpoint.readContext(QString("window_%1").arg(windowNo), window))
+            return false;
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+        if(!storeWindowContext(window, store, storeOffset))
+            return false;
 
-            if(m_order == 1) {
+        card = window.p1Card();
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    }
 
-            } else {
+    m_contextStore.swap(store);
+    m_windowCard = card;
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    return true;
 
-            }
+}
 
-        } else if(m_predictType == "Signed 32 bit"){
+void TCPADevice::addRawTracesToContext(const uint8_t * traces, const uint8_t * predicts, size_t noOfTraces){
 
-            if(m_order == 1) {
+    // Add traces to the context
+    // ... sorry (need explicit cast on both traces and predictions, shit happens)
+    if(m_traceType == "Unsigned 8 bit") {
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        if(m_predictType == "Unsigned 8 bit") {
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Signed 8 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+        } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Signed 16 bit"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint16_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint8_t *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
         } else {
             qFatal("Unexpected predictions type while adding traces.");
             return;
         }
 
-    } else if(m_traceType == "Signed 16 bit"){
+    } else if(m_traceType == "Signed 8 bit"){
 
         if(m_predictType == "Unsigned 8 bit") {
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 8 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const int8_t *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Signed 32 bit"){
+        } else {
+            qFatal("Unexpected predictions type while adding traces.");
+            return;
+        }
 
-            if(m_order == 1) {
+    } else if(m_traceType == "Unsigned 16 bit"){
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        if(m_predictType == "Unsigned 8 bit") {
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Signed 8 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+        } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Signed 16 bit"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int16_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint16_t *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
         } else {
             qFatal("Unexpected predictions type while adding traces.");
             return;
         }
 
-    } else if(m_traceType == "Unsigned 32 bit"){
+    } else if(m_traceType == "Signed 16 bit"){
 
         if(m_predictType == "Unsigned 8 bit") {
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 8 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const int16_t *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Signed 32 bit"){
+        } else {
+            qFatal("Unexpected predictions type while adding traces.");
+            return;
+        }
 
-            if(m_order == 1) {
+    } else if(m_traceType == "Unsigned 32 bit"){
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        if(m_predictType == "Unsigned 8 bit") {
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Signed 8 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+        } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Signed 16 bit"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<uint32_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const uint32_t *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
         } else {
             qFatal("Unexpected predictions type while adding traces.");
@@ -838,99 +1371,35 @@ void TCPADevice::computeCorrelations(){
 
         if(m_predictType == "Unsigned 8 bit") {
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 8 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Unsigned 32 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Real 32 bit (float)"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Real 64 bit (double)"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<int32_t *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const int32_t *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
         } else {
             qFatal("Unexpected predictions type while adding traces.");
@@ -941,250 +1410,282 @@ void TCPADevice::computeCorrelations(){
 
         if(m_predictType == "Unsigned 8 bit") {
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 8 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
-
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
-
-            }
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
         } else if(m_predictType == "Signed 16 bit"){
 
-            if(m_order == 1) {
-
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-            } else {
-
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const float *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Signed 32 bit"){
+        } else {
+            qFatal("Unexpected predictions type while adding traces.");
+            return;
+        }
 
-            if(m_order == 1) {
+    } else if(m_traceType == "Real 64 bit (double)"){
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        if(m_predictType == "Unsigned 8 bit") {
 
-            } else {
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const uint8_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Signed 8 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const int8_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+        } else if(m_predictType == "Unsigned 16 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const uint16_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Signed 16 bit"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const int16_t *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Unsigned 32 bit"){
 
-            }
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const uint32_t *>(predicts), noOfTraces);
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+        } else if(m_predictType == "Signed 32 bit"){
 
-            if(m_order == 1) {
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const int32_t *>(predicts), noOfTraces);
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        } else if(m_predictType == "Real 32 bit (float)"){
 
-            } else {
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const float *>(predicts), noOfTraces);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<float *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        } else if(m_predictType == "Real 64 bit (double)"){
 
-            }
+            addTracesToContext(reinterpret_cast<const double *>(traces), reinterpret_cast<const double *>(predicts), noOfTraces);
 
         } else {
             qFatal("Unexpected predictions type while adding traces.");
             return;
         }
 
-    } else if(m_traceType == "Real 64 bit (double)"){
-
-        if(m_predictType == "Unsigned 8 bit") {
-
-            if(m_order == 1) {
+    } else {
+        qFatal("Unexpected trace type while adding traces.");
+        return;
+    }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+}
 
-            } else {
+void TCPADevice::computeCorrelations(){
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<uint8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    size_t noOfTraces;
 
-            }
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
 
-        } else if(m_predictType == "Signed 8 bit"){
+        const size_t tracesSize = (m_windowWidth > 0) ? m_input->pendingTraces.size() : m_input->traces.size();
 
-            if(m_order == 1) {
+        if(tracesSize % (getTypeSize(m_traceType) * m_traceLength) != 0){
+            qCritical("Buffer does not contain a valid amount of traces/samples");
+            return;
+        }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        if(m_input->predicts.size() % (getTypeSize(m_predictType) * m_predictCount) != 0){
+            qCritical("Buffer does not contain a valid amount of predictions");
+            return;
+        }
 
-            } else {
+        noOfTraces = tracesSize / (getTypeSize(m_traceType) * m_traceLength);
+        size_t noOfPredictSets = m_input->predicts.size() / (getTypeSize(m_predictType) * m_predictCount);
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<int8_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        if(noOfTraces != noOfPredictSets){
+            qCritical("Number of traces and number of prediction sets does not match!");
+            return;
+        }
 
-            }
+        // the data submitted during the computation go into the other input
+        std::swap(m_input, m_computeInput);
+    }
 
-        } else if(m_predictType == "Unsigned 16 bit"){
+    TInput & input = *m_computeInput;
 
-            if(m_order == 1) {
+    qInfo("Unread correlation matrices were erased. The submitted data will be added to all the previously submitted data (unless the Reset action was run), and the new correlations will be computed upon all of these.");
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    // the complete batches submitted earlier have already been added to the context
+    const size_t submittedTraces = noOfTraces + input.ingestedTraces;
+    qInfo(QString("Now processing %1 bytes of power traces (%2 power traces, %3 samples each) and %4 bytes of leakage predictions (%2 sets, one for every trace, each consisting of %5 leakage predictions).").arg(submittedTraces * getTypeSize(m_traceType) * m_traceLength).arg(submittedTraces).arg(m_traceLength).arg(submittedTraces * getTypeSize(m_predictType) * m_predictCount).arg(m_predictCount).toLatin1());
 
-            } else {
+    if(m_windowWidth > 0) {
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<uint16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        // the tiled mode replays the pending traces window by window
+        m_totalTraces = noOfTraces * ((m_traceLength + m_windowWidth - 1) / m_windowWidth);
 
-            }
+        if(!computeTiled(input, noOfTraces)) {
+            qWarning("The computation was aborted or a temporary file failed, the accumulated statistics are left as they were before it and the pending traces are kept for the next computation.");
+            restoreInput();
+            return;
+        }
 
-        } else if(m_predictType == "Signed 16 bit"){
+        input.pendingTraces.clear();
+        input.predicts.clear();
 
-            if(m_order == 1) {
+    } else {
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+        m_totalTraces = noOfTraces;
 
-            } else {
+        if(!ingestTraces(input)) {
+            qWarning(QString("The computation was aborted after %1 of %2 traces, the added traces remain in the accumulated statistics and the rest is kept for the next computation.").arg(m_processedTraces.load()).arg(noOfTraces).toLatin1());
+            restoreInput();
+            return;
+        }
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<int16_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+        // Clear processed data from the buffers
+        input.traces.clear();
+        input.predicts.clear();
 
-            }
+        // compute correlation matrices
+        if(m_singlePrecision) {
+            computeCorrelationMatrices(m_contextSingle);
+        } else {
+            computeCorrelationMatrices(m_context);
+        }
 
-        } else if(m_predictType == "Unsigned 32 bit"){
+    }
 
-            if(m_order == 1) {
+    input.ingestedTraces = 0;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    if(m_reducedOutput) {
+        qInfo(QString("Generated %1 bytes of data (peaks of %2 key candidates) and %3 bytes of data (top %4 key candidates) on every order, now available for reading.").arg(correlationsSize(1)).arg(m_predictCount).arg(rankingSize(1)).arg(std::min(m_topK, m_predictCount)).toLatin1());
+    } else {
+        qInfo(QString("Generated %1 bytes of data (%2 x %3 correlation matrices) on every stream, now available for reading.").arg(correlationsSize(1)).arg(m_traceLength).arg(m_predictCount).toLatin1());
+    }
 
-            } else {
+}
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<uint32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+size_t TCPADevice::getCorrelations(uint8_t * buffer, size_t length, size_t order0){
 
-            }
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
 
-        } else if(m_predictType == "Signed 32 bit"){
+    // the tiled mode keeps the correlation matrices in files
+    if(m_windowWidth > 0 && !m_reducedOutput) {
 
-            if(m_order == 1) {
+        size_t sent = std::min(length, availableBytes(order0));
+        if(!m_correlationStore[order0-1]->read(m_position[order0-1], buffer, sent)) return 0;
+        m_position[order0-1] += sent;
+        return sent;
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    }
 
-            } else {
+    const size_t sent = std::min(length, availableBytes(order0));
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<int32_t *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+    if(sent > 0) {
+        std::memcpy(buffer, correlationsData(order0) + m_position[order0-1], sent);
+        m_position[order0-1] += sent;
+    }
 
-            }
+    return sent;
 
-        } else if(m_predictType == "Real 32 bit (float)"){
+}
 
-            if(m_order == 1) {
+size_t TCPADevice::availableBytes(size_t order){
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
 
-            } else {
+    return correlationsSize(order) - m_position[order-1];
+}
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<float *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+size_t TCPADevice::getTopK(uint8_t * buffer, size_t length, size_t order0){
 
-            }
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
 
-        } else if(m_predictType == "Real 64 bit (double)"){
+    const size_t sent = std::min(length, availableTopKBytes(order0));
 
-            if(m_order == 1) {
+    if(sent > 0) {
+        std::memcpy(buffer, rankingData(order0) + m_rankingPosition[order0-1], sent);
+        m_rankingPosition[order0-1] += sent;
+    }
 
-                SICAK::UniFoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength);
+    return sent;
 
-            } else {
+}
 
-                SICAK::UniHoCpaAddTraces(m_context, reinterpret_cast<double *>(m_traces.data()), reinterpret_cast<double *>(m_predicts.data()), noOfTraces, m_predictCount, m_traceLength, m_order);
+size_t TCPADevice::availableTopKBytes(size_t order){
 
-            }
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
 
-        } else {
-            qFatal("Unexpected predictions type while adding traces.");
-            return;
-        }
+    return rankingSize(order) - m_rankingPosition[order-1];
+}
 
+const uint8_t * TCPADevice::rankingData(size_t order) const {
+    if(m_singleOutput) {
+        return reinterpret_cast<const uint8_t *>(m_rankingSingle[order-1]->data());
     } else {
-        qFatal("Unexpected trace type while adding traces.");
-        return;
+        return reinterpret_cast<const uint8_t *>(m_ranking[order-1]->data());
     }
+}
 
-    // Clear processed data from the buffers
-    m_traces.clear();
-    m_predicts.clear();
-
-    // compute correlation matrices
-    if(m_order == 1){
-
-        SICAK::UniFoCpaComputeCorrelationMatrix(m_context, *(m_correlations[0]));
-        m_position[0] = 0;
+size_t TCPADevice::rankingSize(size_t order) const {
+    return m_singleOutput ? m_rankingSingle[order-1]->size() : m_ranking[order-1]->size();
+}
 
-    } else {
+size_t TCPADevice::getSnapshots(uint8_t * buffer, size_t length, size_t order0){
 
-        for(int i = 1; i <= m_order; i++){
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
 
-            SICAK::UniHoCpaComputeCorrelationMatrix(m_context, *(m_correlations[i-1]), i);
-            m_position[i-1] = 0;
-
-        }
+    const size_t sent = std::min(length, availableSnapshotBytes(order0));
 
+    if(sent > 0) {
+        std::memcpy(buffer, m_snapshots[order0-1].constData() + m_snapshotPosition[order0-1], sent);
+        m_snapshotPosition[order0-1] += sent;
     }
 
-    qInfo(QString("Generated %1 bytes of data (%2 x %3 correlation matrices) on every stream, now available for reading.").arg(m_correlations[0]->size()).arg(m_traceLength).arg(m_predictCount).toLatin1());
+    return sent;
 
 }
 
-size_t TCPADevice::getCorrelations(uint8_t * buffer, size_t length, size_t order0){
-
-    int sent = 0;
+size_t TCPADevice::availableSnapshotBytes(size_t order){
 
-    for (sent = 0; m_position[order0-1] < (m_correlations[order0-1]->size()) && sent < length; sent++, m_position[order0-1]++) {
-        buffer[sent] = *(reinterpret_cast<uint8_t *>(m_correlations[order0-1]->data()) + m_position[order0-1]);
-    }
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
 
-    return sent;
+    return m_snapshots[order-1].size() - m_snapshotPosition[order-1];
+}
 
+const uint8_t * TCPADevice::correlationsData(size_t order) const {
+    if(m_singleOutput) {
+        return reinterpret_cast<const uint8_t *>(m_correlationsSingle[order-1]->data());
+    } else {
+        return reinterpret_cast<const uint8_t *>(m_correlations[order-1]->data());
+    }
 }
 
-size_t TCPADevice::availableBytes(size_t order){
-    return m_correlations[order-1]->size() - m_position[order-1];
+size_t TCPADevice::correlationsSize(size_t order) const {
+    if(m_windowWidth > 0 && !m_reducedOutput) return m_correlationStore[order-1]->size();
+    return m_singleOutput ? m_correlationsSingle[order-1]->size() : m_correlations[order-1]->size();
 }
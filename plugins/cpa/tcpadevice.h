@@ -20,12 +20,21 @@
 #ifndef TCPADEVICE_H
 #define TCPADEVICE_H
 
+#include <QByteArray>
 #include <QString>
 #include <QList>
 #include <QQueue>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "tconfigparam.h"
 #include "tanaldevice.h"
 #include "typesmoment.hpp"
+#include "tfilebuffer.hpp"
+#include "tdatabuffer.hpp"
+#include "tcontextcheckpoint.hpp"
 
 class TCPADevice : public TAnalDevice {
 
@@ -63,39 +72,168 @@ public:
 
     virtual bool isBusy() const override;
 
+    /// Stops the running computation at the next batch of traces, the traces not processed yet are kept for the next run
+    void abortAction();
+    /// Number of the processed and of all the traces of the running computation
+    std::pair<size_t, size_t> getProgress() const;
+
     size_t addTraces(const uint8_t * buffer, size_t length);
     size_t addPredicts(const uint8_t * buffer, size_t length);
 
     void resetContexts();
     void computeCorrelations();
 
+    /// Saves the accumulated statistics into the checkpoint file
+    void saveContext();
+    /// Replaces the accumulated statistics with the ones from the checkpoint file
+    void loadContext();
+
     size_t getCorrelations(uint8_t * buffer, size_t length, size_t order0);
     size_t availableBytes(size_t order);
 
+    size_t getTopK(uint8_t * buffer, size_t length, size_t order0);
+    size_t availableTopKBytes(size_t order);
+
+    size_t getSnapshots(uint8_t * buffer, size_t length, size_t order0);
+    size_t availableSnapshotBytes(size_t order);
+
     size_t getTypeSize(const QString & dataType);    
 
 private:
 
+    /// Size of the buffer holding the samples of a window gathered from the pending traces, in bytes
+    static const size_t TILE_BUFFER_SIZE = 32 * 1024 * 1024;
+    /// Amount of the submitted traces that is added to the context as soon as it is complete, in bytes
+    static constexpr size_t INGEST_BATCH_SIZE = 32 * 1024 * 1024;
+
+    /// Traces and predictions submitted since the last computation. A computation takes the input over,
+    /// so the new data are accepted into the other one meanwhile.
+    struct TInput {
+        TDataBuffer traces;
+        TDataBuffer predicts;
+        TFileBuffer pendingTraces; // the tiled mode
+        size_t ingestedTraces = 0; // added to the context already
+    };
+
+    /// Runs the action with the accumulated statistics locked, the device is busy meanwhile
+    void runAction(const std::function<void(void)> & action);
+
+    /// Adds the complete traces of the input along with their predictions to the context and drops them from the input,
+    /// stops at a batch boundary when aborted, returns false then
+    bool ingestTraces(TInput & input);
+    /// Runs in the ingestion thread: takes the complete batches over from the input and adds them to the context,
+    /// so the submission of the data overlaps with the update of the context
+    void ingestionLoop();
+    void startIngestion();
+    void stopIngestion();
+    /// Returns the traces not processed by an aborted computation to the input, ahead of the ones submitted meanwhile
+    void restoreInput();
+
+    /// Adds the traces and the predictions in their configured data types
+    void addRawTracesToContext(const uint8_t * traces, const uint8_t * predicts, size_t noOfTraces);
+    /// Adds the traces and the predictions to the context of the selected precision
+    template <class U, class V>
+    void addTracesToContext(const U * traces, const V * predicts, size_t noOfTraces);
+    /// Adds the traces and the predictions to the context, chooses the engine according to the order and the amount of data
+    template <class T, class U, class V>
+    void addTracesToContext(SICAK::Moments2DContext<T> & context, const U * traces, const V * predicts, size_t noOfTraces);
+    /// Records the correlation peaks of all orders at a snapshot checkpoint
+    template <class T>
+    void takeSnapshots(const SICAK::Moments2DContext<T> & context);
+    template <class R, class T>
+    void appendSnapshot(const SICAK::Moments2DContext<T> & context, size_t order);
+    /// Computes the correlation matrices (or the peaks) of all orders in the selected output type, in the tiled mode of the current window;
+    /// returns false when the correlations could not be written into their files
+    template <class T>
+    bool computeCorrelationMatrices(const SICAK::Moments2DContext<T> & context);
+    template <class T, class R>
+    bool computeCorrelationMatrices(const SICAK::Moments2DContext<T> & context, QList<SICAK::Matrix<R> *> & correlations, QList<SICAK::Matrix<R> *> & ranking);
+
+    /// Replays the pending traces of the input window by window, every window context is loaded from the context file and stored
+    /// into a new one, which replaces it once all the windows are done. Stops at a window or batch boundary when aborted, or when a file
+    /// cannot be read or written, returns false then.
+    bool computeTiled(const TInput & input, size_t noOfTraces);
+    /// Loads the window context from the context file at the offset, which is moved past it; returns false when the file cannot be read
+    template <class T>
+    bool loadWindowContext(SICAK::Moments2DContext<T> & context, size_t width, size_t & storeOffset);
+    /// Stores the window context into the file at the offset, which is moved past it; returns false when the file cannot be written
+    template <class T>
+    bool storeWindowContext(const SICAK::Moments2DContext<T> & context, TFileBuffer & store, size_t & storeOffset);
+
+    /// Saves/loads the context, or all the window contexts in the tiled mode
+    template <class T>
+    bool saveContext(TContextCheckpoint & checkpoint, const SICAK::Moments2DContext<T> & context);
+    template <class T>
+    bool loadContext(TContextCheckpoint & checkpoint, SICAK::Moments2DContext<T> & context);
+
+    /// Raw data of the correlation matrix (or the peaks in the reduced output mode) of the given order, in the selected output type
+    const uint8_t * correlationsData(size_t order) const;
+    size_t correlationsSize(size_t order) const;
+    /// Raw data of the top-k key candidates of the given order, in the selected output type
+    const uint8_t * rankingData(size_t order) const;
+    size_t rankingSize(size_t order) const;
+
     TConfigParam m_preInitParams;
+    TConfigParam m_postInitParams;
 
     size_t m_traceLength;
     size_t m_predictCount;
     QString m_traceType;
     QString m_predictType;
     size_t m_order;
+    size_t m_threads;
+    bool m_singlePrecision;
+    bool m_singleOutput;
+    size_t m_snapshotInterval;
+    bool m_reducedOutput;
+    size_t m_topK;
+    size_t m_windowWidth; // 0 - whole traces at once
+    size_t m_windowOffset;
+    size_t m_windowCard;
+    QString m_checkpointFile;
+    QString m_checkpointGroup;
 
     SICAK::Moments2DContext<qreal> m_context;
+    SICAK::Moments2DContext<float> m_contextSingle;
 
     QList<TAnalAction *> m_analActions;
     QList<TAnalInputStream *> m_analInputStreams;
     QList<TAnalOutputStream *> m_analOutputStreams;
 
-    QList<uint8_t> m_traces;
-    QList<uint8_t> m_predicts;
+    TInput m_inputs[2];
+    TInput * m_input; // accepts the submitted data
+    TInput * m_computeInput; // taken over by the running computation
+    std::mutex m_inputMutex; // guards the input
+    std::recursive_mutex m_computeMutex; // guards the contexts
+    std::recursive_mutex m_resultsMutex; // guards the results, held by the actions but never by the ingestion thread
+
+    std::thread m_ingestThread;
+    std::condition_variable m_ingestCondition; // notified under the input mutex when data are submitted
+    bool m_ingestStop;
+    TDataBuffer m_ingestTraces; // the traces handed over to the ingestion thread
+    TDataBuffer m_ingestPredicts;
+
+    std::atomic<bool> m_busy;
+    std::atomic<bool> m_abort;
+    std::atomic<size_t> m_processedTraces;
+    std::atomic<size_t> m_totalTraces;
 
     QList<SICAK::Matrix<qreal> *> m_correlations;
+    QList<SICAK::Matrix<float> *> m_correlationsSingle;
     QList<size_t> m_position;
 
+    QList<SICAK::Matrix<qreal> *> m_ranking;
+    QList<SICAK::Matrix<float> *> m_rankingSingle;
+    QList<size_t> m_rankingPosition;
+
+    QList<QByteArray> m_snapshots;
+    QList<size_t> m_snapshotPosition;
+    QList<size_t> m_snapshotBase;
+    size_t m_snapshotRecord;
+
+    TFileBuffer m_contextStore;
+    QList<TFileBuffer *> m_correlationStore;
+
 };
 
 #endif // TCPADEVICE_H
@@ -20,6 +20,7 @@
 #include "tpredictaes.h"
 
 #include <QtGlobal>
+#include <cstring>
 
 #include "tpredictaction.h"
 #include "tpredictinputstream.h"
@@ -172,11 +173,7 @@ bool TPredictAES::isBusy() const
 
 size_t TPredictAES::addData(const uint8_t * buffer, size_t length){
 
-    m_data.reserve(m_data.size() + length); // preallocate space
-
-    for(int i = 0; i < length; i++){
-        m_data.append(buffer[i]);
-    }
+    m_data.append(buffer, length);
 
     return length;
 
@@ -234,7 +231,7 @@ const int inv_shiftRows[16] = { 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6
 
 void TPredictAES::computePredictions(){
 
-    if(m_data.length() % 16 != 0){
+    if(m_data.size() % 16 != 0){
         qCritical("Buffer does not contain a valid amount of bytes (not divisible by 16)");
         return;
     }
@@ -247,7 +244,7 @@ void TPredictAES::computePredictions(){
         m_position[i] = m_predictions[i]->length();
     }
 
-    qInfo(QString("Unread previously generated data were erased. Now processing %1 bytes of data (%2 cipher blocks).").arg(m_data.length()).arg(blockCount).toLatin1());
+    qInfo(QString("Unread previously generated data were erased. Now processing %1 bytes of data (%2 cipher blocks).").arg(m_data.size()).arg(blockCount).toLatin1());
 
     for(size_t byte = 0; byte < 16; byte++){
 
@@ -309,10 +306,11 @@ void TPredictAES::computePredictions(){
 
 size_t TPredictAES::getPredictions(uint8_t * buffer, size_t length, size_t byte){
 
-    size_t sent = 0;
+    const size_t sent = std::min(length, availableBytes(byte));
 
-    for (sent = 0; m_position[byte] < (m_predictions[byte]->size()) && sent < length; sent++, m_position[byte]++) {
-        buffer[sent] = (m_predictions[byte])->at(m_position[byte]);
+    if(sent > 0) {
+        std::memcpy(buffer, m_predictions[byte]->data() + m_position[byte], sent);
+        m_position[byte] += sent;
     }
 
     return sent;
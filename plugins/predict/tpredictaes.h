@@ -25,6 +25,7 @@
 #include <QQueue>
 #include "tconfigparam.h"
 #include "tanaldevice.h"
+#include "tdatabuffer.hpp"
 #include "typesmoment.hpp"
 
 class TPredictAES : public TAnalDevice {
@@ -81,7 +82,7 @@ private:
     QList<TAnalInputStream *> m_analInputStreams;
     QList<TAnalOutputStream *> m_analOutputStreams;
 
-    QList<uint8_t> m_data;
+    TDataBuffer m_data;
 
     QList<QList<uint8_t> *> m_predictions;
     QList<size_t> m_position;
@@ -19,8 +19,8 @@
 
 #include "tttestaction.h"
 
-TTTestAction::TTTestAction(QString name, QString info, std::function<void(void)> run)
-    : m_name(name), m_info(info), m_run(run)
+TTTestAction::TTTestAction(QString name, QString info, std::function<void(void)> run, std::function<void(void)> abort, std::function<std::pair<size_t, size_t>(void)> progress)
+    : m_name(name), m_info(info), m_run(run), m_abort(abort), m_progress(progress)
 {
 
 }
@@ -47,5 +47,14 @@ void TTTestAction::run()
 
 void TTTestAction::abort()
 {
+    if (m_abort)
+        m_abort();
+}
+
+std::pair<size_t, size_t> TTTestAction::getProgress() const
+{
+    if (m_progress)
+        return m_progress();
 
+    return {0, 0};
 }
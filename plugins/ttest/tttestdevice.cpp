@@ -20,13 +20,15 @@
 #include "tttestdevice.h"
 
 #include <QtGlobal>
+#include <cstring>
+#include <utility>
 
 #include "tttestaction.h"
 #include "tttestinputstream.h"
 #include "tttestoutputstream.h"
 #include "ttest.hpp"
 
-TTTestDevice::TTTestDevice(): m_traceLength(0), m_numberOfClasses(0), m_traceType("Unsigned 8 bit"), m_order(1), m_inputFormat(0), m_labelType("Unsigned 8 bit"), m_nonLabeledTraces(nullptr) {
+TTTestDevice::TTTestDevice(): m_traceLength(0), m_numberOfClasses(0), m_traceType("Unsigned 8 bit"), m_order(1), m_threads(0), m_singlePrecision(false), m_singleOutput(false), m_histogramEngine(false), m_windowWidth(0), m_windowOffset(0), m_checkpointGroup("/ttest"), m_tvlaMonitor(false), m_tvlaThreshold(4.5), m_tvlaStableAfter(10), m_inputFormat(0), m_labelType("Unsigned 8 bit"), m_input(&m_inputs[0]), m_computeInput(&m_inputs[1]), m_ingestStop(false), m_busy(false), m_abort(false), m_processedTraces(0), m_totalTraces(0), m_tvlaSummaryPosition(0), m_tvlaLeakage(0), m_tvlaLeakagePosition(1), m_tvlaStableCount(0), m_tvlaStable(0), m_tvlaStablePosition(1) {
     m_preInitParams = TConfigParam("Welch's t-test configuration", "", TConfigParam::TType::TDummy, "");
     TConfigParam traceLength = TConfigParam("Trace length (in samples)", "1000", TConfigParam::TType::TUInt, "The number of samples per data trace");
     m_preInitParams.addSubParam(traceLength);
@@ -44,6 +46,24 @@ TTTestDevice::TTTestDevice(): m_traceLength(0), m_numberOfClasses(0), m_traceTyp
     m_preInitParams.addSubParam(traceType);
     TConfigParam order = TConfigParam("Maximum order", "1", TConfigParam::TType::TUInt, "Maximum order of the t-test");
     m_preInitParams.addSubParam(order);
+    TConfigParam threads = TConfigParam("Worker threads", "0", TConfigParam::TType::TUInt, "Number of threads used for the computation (0 = all available cores). Results are reproducible for a fixed number of threads.");
+    m_preInitParams.addSubParam(threads);
+    TConfigParam precision = TConfigParam("Accumulator precision", "Double (64 bit)", TConfigParam::TType::TEnum, "Precision of the accumulated statistics. Single precision halves the memory and bandwidth, every batch of traces is accumulated in double precision and rounded into the statistics once.");
+    precision.addEnumValue("Double (64 bit)");
+    precision.addEnumValue("Single (32 bit)");
+    m_preInitParams.addSubParam(precision);
+    TConfigParam outputType = TConfigParam("Output data type", "Real 64 bit (double)", TConfigParam::TType::TEnum, "Data type of the t-values and the degrees of freedom");
+    outputType.addEnumValue("Real 64 bit (double)");
+    outputType.addEnumValue("Real 32 bit (float)");
+    m_preInitParams.addSubParam(outputType);
+    TConfigParam windowWidth = TConfigParam("Sample window (samples)", "0", TConfigParam::TType::TUInt, "Processes the traces in windows of the given number of samples, only the statistics of a single window are kept in memory and the rest is stored in temporary files (0 = whole traces at once)");
+    m_preInitParams.addSubParam(windowWidth);
+    TConfigParam tvlaMonitor = TConfigParam("TVLA monitor", "false", TConfigParam::TType::TBool, "Updates the summary of the t-values of the classes 0 and 1 (max |t|, its sample and the number of samples above the threshold) on every computation, without computing the full t-values");
+    TConfigParam tvlaThreshold = TConfigParam("Threshold (|t|)", "4.5", TConfigParam::TType::TReal, "Leakage is detected when |t| of any sample exceeds the threshold");
+    tvlaMonitor.addSubParam(tvlaThreshold);
+    TConfigParam tvlaStableAfter = TConfigParam("Stable after (computations)", "10", TConfigParam::TType::TUInt, "The summary is stable when max |t| of every order stays below the threshold and does not rise above its previous maximum for the given number of computations in a row (0 = never stable)");
+    tvlaMonitor.addSubParam(tvlaStableAfter);
+    m_preInitParams.addSubParam(tvlaMonitor);
 
     TConfigParam inputFormat = TConfigParam("Input format", "Input stream per class", TConfigParam::TType::TEnum, "Input format. Labels must be numbers of the class (starting with 0).");
     inputFormat.addEnumValue("Input stream per class");
@@ -58,6 +78,12 @@ TTTestDevice::TTTestDevice(): m_traceLength(0), m_numberOfClasses(0), m_traceTyp
     inputFormat.addSubParam(labelType);
     m_preInitParams.addSubParam(inputFormat);
 
+    m_postInitParams = TConfigParam("Welch's t-test checkpoint", "", TConfigParam::TType::TDummy, "");
+    TConfigParam checkpointFile = TConfigParam("Checkpoint file", "", TConfigParam::TType::TFileName, "HDF5 file the accumulated statistics are saved into and loaded from by the Save/Load context actions");
+    m_postInitParams.addSubParam(checkpointFile);
+    TConfigParam checkpointGroup = TConfigParam("Checkpoint group", "/ttest", TConfigParam::TType::TString, "Group of the HDF5 file holding the checkpoint, it is replaced on every save");
+    m_postInitParams.addSubParam(checkpointGroup);
+
 }
 
 TTTestDevice::~TTTestDevice() {
@@ -128,6 +154,98 @@ TConfigParam TTTestDevice::setPreInitParams(TConfigParam params) {
         orderParam->setState(TConfigParam::TState::TError, "Maximum order must be 1 or greater.");
     }
 
+    TConfigParam * threadsParam = m_preInitParams.getSubParamByName("Worker threads", &iok);
+    if(!iok) {
+        qCritical("Worker threads parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_threads = threadsParam->getValue().toUInt(&iok);
+    if (!iok) {
+        threadsParam->setState(TConfigParam::TState::TError, "Number of worker threads must be a non-negative integer (0 = all available cores).");
+    }
+
+    TConfigParam * precisionParam = m_preInitParams.getSubParamByName("Accumulator precision", &iok);
+    if(!iok) {
+        qCritical("Accumulator precision parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    QString precisionVal = precisionParam->getValue();
+    if(precisionVal == "Double (64 bit)") {
+        m_singlePrecision = false;
+    } else if(precisionVal == "Single (32 bit)"){
+        m_singlePrecision = true;
+    } else {
+        precisionParam->setState(TConfigParam::TState::TError, "Invalid accumulator precision.");
+    }
+
+    TConfigParam * outputTypeParam = m_preInitParams.getSubParamByName("Output data type", &iok);
+    if(!iok) {
+        qCritical("Output data type parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    QString outputTypeVal = outputTypeParam->getValue();
+    if(outputTypeVal == "Real 64 bit (double)") {
+        m_singleOutput = false;
+    } else if(outputTypeVal == "Real 32 bit (float)"){
+        m_singleOutput = true;
+    } else {
+        outputTypeParam->setState(TConfigParam::TState::TError, "Invalid output data type.");
+    }
+
+    TConfigParam * windowWidthParam = m_preInitParams.getSubParamByName("Sample window (samples)", &iok);
+    if(!iok) {
+        qCritical("Sample window parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_windowWidth = windowWidthParam->getValue().toUInt(&iok);
+    if (!iok) {
+        windowWidthParam->setState(TConfigParam::TState::TError, "Sample window must be a non-negative integer (0 = whole traces at once).");
+    }
+    if (m_windowWidth >= m_traceLength) {
+        m_windowWidth = 0;
+    }
+
+    TConfigParam * tvlaMonitorParam = m_preInitParams.getSubParamByName("TVLA monitor", &iok);
+    if(!iok) {
+        qCritical("TVLA monitor parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_tvlaMonitor = tvlaMonitorParam->getValue() == "true";
+
+    TConfigParam * tvlaThresholdParam = tvlaMonitorParam->getSubParamByName("Threshold (|t|)", &iok);
+    if(!iok) {
+        qCritical("TVLA threshold parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_tvlaThreshold = tvlaThresholdParam->getValue().toDouble(&iok);
+    if (!iok || m_tvlaThreshold <= 0) {
+        tvlaThresholdParam->setState(TConfigParam::TState::TError, "Threshold must be a positive number.");
+    }
+
+    TConfigParam * tvlaStableAfterParam = tvlaMonitorParam->getSubParamByName("Stable after (computations)", &iok);
+    if(!iok) {
+        qCritical("TVLA stable after parameter not found in the pre-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_tvlaStableAfter = tvlaStableAfterParam->getValue().toUInt(&iok);
+    if (!iok) {
+        tvlaStableAfterParam->setState(TConfigParam::TState::TError, "Stable after must be a non-negative integer (0 = never stable).");
+    }
+
     TConfigParam * inputFormatParam = m_preInitParams.getSubParamByName("Input format", &iok);
     if(!iok) {
         qCritical("Input format parameter not found in the pre-init params");
@@ -158,8 +276,10 @@ TConfigParam TTTestDevice::setPreInitParams(TConfigParam params) {
 
 void TTTestDevice::init(bool *ok) {
 
-    m_analActions.append(new TTTestAction("Compute t-values (+ flush streams)", "Computes t-values", [=](){ computeTVals(); }));
-    m_analActions.append(new TTTestAction("Reset (delete all data)", "Deletes all the received data", [=](){ resetContexts(); }));
+    m_analActions.append(new TTTestAction("Compute t-values (+ flush streams)", "Computes t-values", [=](){ runAction([=](){ computeTVals(); }); }, [=](){ abortAction(); }, [=](){ return getProgress(); }));
+    m_analActions.append(new TTTestAction("Reset (delete all data)", "Deletes all the received data", [=](){ runAction([=](){ resetContexts(); }); }));
+    m_analActions.append(new TTTestAction("Save context (checkpoint)", "Saves the accumulated statistics into the checkpoint file", [=](){ runAction([=](){ saveContext(); }); }));
+    m_analActions.append(new TTTestAction("Load context (resume)", "Replaces the accumulated statistics with the ones from the checkpoint file", [=](){ runAction([=](){ loadContext(); }); }));
 
     if(m_inputFormat == 1){ // 1 - labels
 
@@ -180,21 +300,72 @@ void TTTestDevice::init(bool *ok) {
             for (int j = i + 1; j < m_numberOfClasses; j++) {
 
                 QString streamName = QString("%1-order t-vals %2 vs %3").arg(order).arg(i).arg(j);
-                m_analInputStreams.append(new TTTestInputStream(streamName, "Stream of t-values", [=, class1 = i, class2 = j, order0 = order](uint8_t * buffer, size_t length){ return getTValues(buffer, length, class1, class2, order0); }, [=, class1 = i, class2 = j, order0 = order](){ return availableBytes(class1, class2, order0); }));
+                m_analInputStreams.append(new TTTestInputStream(streamName, "Stream of t-values", [=, stream = m_tvals.length()](uint8_t * buffer, size_t length){ return getTValues(buffer, length, stream); }, [=, stream = m_tvals.length()](){ return availableBytes(stream); }));
 
                 m_tvals.append(new SICAK::Matrix<qreal>());
+                m_tvalsSingle.append(new SICAK::Matrix<float>());
                 m_position.append(0);
+                m_stale.append(false);
+                m_streamClass1.append(i);
+                m_streamClass2.append(j);
+                m_streamOrder.append(order);
 
             }
         }
     }
 
+    if(m_tvlaMonitor) {
+        m_analInputStreams.append(new TTTestInputStream("TVLA summary 0 vs 1", "Stream of max |t|, its sample and the number of samples above the threshold, for every order", [=](uint8_t * buffer, size_t length){ return getTvlaSummary(buffer, length); }, [=](){ return availableTvlaSummaryBytes(); }));
+        m_analInputStreams.append(new TTTestInputStream("TVLA leakage 0 vs 1", "Byte of 1 when max |t| of any order exceeds the threshold, 0 otherwise", [=](uint8_t * buffer, size_t length){ return getTvlaLeakage(buffer, length); }, [=](){ return availableTvlaLeakageBytes(); }));
+        m_analInputStreams.append(new TTTestInputStream("TVLA stable 0 vs 1", "Byte of 1 when max |t| of every order has stayed below the threshold without rising for the configured number of computations, 0 otherwise", [=](uint8_t * buffer, size_t length){ return getTvlaStable(buffer, length); }, [=](){ return availableTvlaStableBytes(); }));
+    }
+
+    // integer samples of upto 12 bits are counted in per-sample histograms instead of updating the moments,
+    // the wide histograms of 16 bit samples only pay off for higher orders
+    size_t histBins = 0;
+    long long histOffset = 0;
+
+    if(m_traceType == "Unsigned 8 bit") {
+        histBins = SICAK::TTEST_HIST_BINS_8BIT;
+    } else if(m_traceType == "Signed 8 bit"){
+        histBins = SICAK::TTEST_HIST_BINS_8BIT;
+        histOffset = -static_cast<long long>(SICAK::TTEST_HIST_BINS_8BIT / 2);
+    } else if(m_traceType == "Unsigned 16 bit" && m_order > 1){
+        histBins = SICAK::TTEST_HIST_BINS_16BIT;
+    } else if(m_traceType == "Signed 16 bit" && m_order > 1){
+        histBins = SICAK::TTEST_HIST_BINS_16BIT;
+        histOffset = -static_cast<long long>(SICAK::TTEST_HIST_BINS_16BIT / 2);
+    }
+
+    // the histograms would have to be stored along with the window contexts, the tiled mode only uses the moments
+    m_histogramEngine = m_windowWidth == 0 && histBins > 0 && (histBins * m_traceLength * m_numberOfClasses * sizeof(uint32_t)) <= SICAK::TTEST_HIST_MEMORY_BUDGET;
+
+    // in the tiled mode the contexts only span a single window
+    const size_t contextWidth = m_windowWidth > 0 ? m_windowWidth : m_traceLength;
+
     for(int i = 0; i < m_numberOfClasses; i++){
-        m_contexts.append(new SICAK::Moments2DContext<qreal>(m_traceLength, 0, 1, 0, 2*m_order, 0, 0));
-        m_contexts[i]->reset();
+        if(m_histogramEngine) {
+            m_histograms.append(new SICAK::HistogramContext(m_traceLength, histBins, histOffset));
+        }
+        if(m_singlePrecision) {
+            m_contextsSingle.append(new SICAK::Moments2DContext<float>(contextWidth, 0, 1, 0, 2*m_order, 0, 0));
+            m_contextsSingle[i]->reset();
+        } else {
+            m_contexts.append(new SICAK::Moments2DContext<qreal>(contextWidth, 0, 1, 0, 2*m_order, 0, 0));
+            m_contexts[i]->reset();
+        }
+        m_windowCards.append(0);
+        for (TInput & input : m_inputs) {
+            input.pendingTraces.append(new TFileBuffer());
+            input.nonLabeledTraces.append(new TDataBuffer());
+            input.ingestedTraces.append(0);
+        }
     }
 
-    m_nonLabeledTraces = new QList<uint8_t>[m_numberOfClasses];
+    // the tiled mode keeps the submitted traces pending until the computation
+    if(m_windowWidth == 0) {
+        startIngestion();
+    }
 
     if (ok != nullptr) *ok = true;
 
@@ -202,6 +373,8 @@ void TTTestDevice::init(bool *ok) {
 
 void TTTestDevice::deInit(bool *ok) {
 
+    stopIngestion();
+
     for (int i = 0; i < m_analActions.length(); i++) {
         delete m_analActions[i];
     }
@@ -222,6 +395,17 @@ void TTTestDevice::deInit(bool *ok) {
     }
     m_contexts.clear();
 
+    for (int i = 0; i < m_contextsSingle.length(); i++) {
+        delete m_contextsSingle[i];
+    }
+    m_contextsSingle.clear();
+
+    for (int i = 0; i < m_histograms.length(); i++) {
+        delete m_histograms[i];
+    }
+    m_histograms.clear();
+    m_histogramEngine = false;
+
     for (int i = 0; i < m_tvals.length(); i++) {
         if(m_tvals[i] != nullptr)
             delete m_tvals[i];
@@ -229,23 +413,89 @@ void TTTestDevice::deInit(bool *ok) {
     }
     m_tvals.clear();
 
+    for (int i = 0; i < m_tvalsSingle.length(); i++) {
+        delete m_tvalsSingle[i];
+    }
+    m_tvalsSingle.clear();
+
     m_position.clear();
+    m_stale.clear();
+    m_streamClass1.clear();
+    m_streamClass2.clear();
+    m_streamOrder.clear();
+
+    for (int i = 0; i < m_derivedContexts.length(); i++) {
+        delete m_derivedContexts[i];
+    }
+    m_derivedContexts.clear();
+
+    for (int i = 0; i < m_derivedContextsSingle.length(); i++) {
+        delete m_derivedContextsSingle[i];
+    }
+    m_derivedContextsSingle.clear();
+
+    discardTvlaSummary();
+    resetTvlaStability();
+
+    for (TInput & input : m_inputs) {
+
+        input.traces.clear();
+        input.labels.clear();
+
+        for (int i = 0; i < input.pendingTraces.length(); i++) {
+            delete input.pendingTraces[i];
+        }
+        input.pendingTraces.clear();
+        input.pendingLabeledTraces.clear();
+
+        for (int i = 0; i < input.nonLabeledTraces.length(); i++) {
+            delete input.nonLabeledTraces[i];
+        }
+        input.nonLabeledTraces.clear();
+        input.ingestedTraces.clear();
+        input.ingestedLabeledTraces = 0;
+        input.invalidLabels = false;
+
+    }
 
-    m_traces.clear();
-    m_labels.clear();
-    if(m_nonLabeledTraces != nullptr)
-        delete [] m_nonLabeledTraces;
-    m_nonLabeledTraces = nullptr;
+    m_contextStore.clear();
+    m_windowCards.clear();
 
     if (ok != nullptr) *ok = true;
 }
 
 TConfigParam TTTestDevice::getPostInitParams() const {
-    return TConfigParam();
+    return m_postInitParams;
 }
 
 TConfigParam TTTestDevice::setPostInitParams(TConfigParam params) {
-    return TConfigParam();
+    bool iok;
+
+    m_postInitParams = params;
+    m_postInitParams.resetState(true);
+
+    TConfigParam * checkpointFileParam = m_postInitParams.getSubParamByName("Checkpoint file", &iok);
+    if(!iok) {
+        qCritical("Checkpoint file parameter not found in the post-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_checkpointFile = checkpointFileParam->getValue();
+
+    TConfigParam * checkpointGroupParam = m_postInitParams.getSubParamByName("Checkpoint group", &iok);
+    if(!iok) {
+        qCritical("Checkpoint group parameter not found in the post-init params");
+        TConfigParam errorParam;
+        errorParam.setState(TConfigParam::TState::TError);
+        return errorParam;
+    }
+    m_checkpointGroup = checkpointGroupParam->getValue();
+    if (!m_checkpointGroup.startsWith('/') || m_checkpointGroup.length() < 2) {
+        checkpointGroupParam->setState(TConfigParam::TState::TError, "Checkpoint group must be an absolute path other than the root group (e.g., /ttest).");
+    }
+
+    return m_postInitParams;
 }
 
 QList<TAnalAction *> TTTestDevice::getActions() const
@@ -265,41 +515,314 @@ QList<TAnalOutputStream *> TTTestDevice::getOutputDataStreams() const
 
 bool TTTestDevice::isBusy() const
 {
-    return false;
+    return m_busy;
+}
+
+void TTTestDevice::abortAction(){
+    m_abort = true;
+}
+
+std::pair<size_t, size_t> TTTestDevice::getProgress() const {
+    return {m_processedTraces, m_totalTraces};
+}
+
+void TTTestDevice::runAction(const std::function<void(void)> & action){
+
+    std::lock_guard<std::recursive_mutex> computeLock(m_computeMutex);
+    std::lock_guard<std::recursive_mutex> resultsLock(m_resultsMutex);
+
+    m_abort = false;
+    m_processedTraces = 0;
+    m_totalTraces = 0;
+    m_busy = true;
+
+    action();
+
+    m_busy = false;
+    m_totalTraces = 0;
+
 }
 
 size_t TTTestDevice::addTraces(const uint8_t * buffer, size_t length, size_t classNo){
 
-    m_nonLabeledTraces[classNo].reserve(m_nonLabeledTraces[classNo].size() + length); // preallocate space
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
 
-    for(int i = 0; i < length; i++){
-        m_nonLabeledTraces[classNo].append(buffer[i]);
+    // in the tiled mode the traces wait in a temporary file, they are replayed window by window
+    if(m_windowWidth > 0) {
+        return m_input->pendingTraces[classNo]->append(buffer, length) ? length : 0;
     }
 
+    m_input->nonLabeledTraces[classNo]->append(buffer, length);
+
+    // the complete batches are added to the contexts by the ingestion thread
+    m_ingestCondition.notify_one();
+
     return length;
 
 }
 
-void TTTestDevice::resetContexts() {
+bool TTTestDevice::ingestTraces(TInput & input, size_t classNo){
+
+    TDataBuffer & traces = *(input.nonLabeledTraces[classNo]);
+    const size_t traceSize = getTypeSize(m_traceType) * m_traceLength;
+    const size_t batchTraces = std::max<size_t>(INGEST_BATCH_SIZE / traceSize, 1);
+
+    size_t noOfTraces = traces.size() / traceSize;
+
+    while(noOfTraces > 0) {
+
+        if(m_abort)
+            return false;
+
+        const size_t count = std::min(batchTraces, noOfTraces);
+
+        addRawTracesToContext(classNo, traces.data(), count);
+
+        traces.consume(count * traceSize);
+        input.ingestedTraces[classNo] += count;
+        noOfTraces -= count;
+        m_processedTraces += count;
+
+    }
+
+    return true;
+
+}
+
+bool TTTestDevice::ingestLabeledTraces(TInput & input){
+
+    const size_t traceSize = getTypeSize(m_traceType) * m_traceLength;
+    const size_t labelSize = getTypeSize(m_labelType);
+
+    // only the traces whose labels have arrived too are complete
+    size_t noOfTraces = std::min(input.traces.size() / traceSize, input.labels.size() / labelSize);
+
+    if(noOfTraces == 0)
+        return true;
+
+    // the labels are checked before any of the traces is added
+    if(!checkLabels(input.labels, noOfTraces)){
+        qCritical("Invalid trace label");
+        return false;
+    }
+
+    const size_t batchTraces = std::max<size_t>(BUCKET_BUFFER_SIZE / traceSize, 1);
+
+    while(noOfTraces > 0) {
+
+        if(m_abort)
+            return false;
+
+        const size_t count = std::min(batchTraces, noOfTraces);
+
+        addLabeledTracesToContexts(input.traces.data(), input.labels, 0, count, m_traceLength);
+
+        input.traces.consume(count * traceSize);
+        input.labels.consume(count * labelSize);
+        input.ingestedLabeledTraces += count;
+        noOfTraces -= count;
+        m_processedTraces += count;
+
+    }
+
+    return true;
+
+}
+
+void TTTestDevice::ingestionLoop(){
+
+    const size_t traceSize = getTypeSize(m_traceType) * m_traceLength;
+    const size_t labelSize = getTypeSize(m_labelType);
+    const size_t batchTraces = std::max<size_t>(INGEST_BATCH_SIZE / traceSize, 1);
+    const size_t labeledBatchTraces = std::max<size_t>(std::min(INGEST_BATCH_SIZE, BUCKET_BUFFER_SIZE) / traceSize, 1);
+
+    // returns the class with a complete batch, the number of classes for a batch of labeled traces, or -1
+    auto completeBatch = [&]() -> int {
+        for(int i = 0; i < m_numberOfClasses; i++){
+            if(m_input->nonLabeledTraces[i]->size() / traceSize >= batchTraces)
+                return i;
+        }
+        // only the traces whose labels have arrived too are complete
+        if(!m_input->invalidLabels && std::min(m_input->traces.size() / traceSize, m_input->labels.size() / labelSize) >= labeledBatchTraces)
+            return m_numberOfClasses;
+        return -1;
+    };
+
+    std::unique_lock<std::mutex> inputLock(m_inputMutex);
+
+    while(true) {
+
+        m_ingestCondition.wait(inputLock, [&](){ return m_ingestStop || completeBatch() >= 0; });
+        if(m_ingestStop)
+            return;
+
+        // the contexts are locked first, a computation may take the input over meanwhile
+        inputLock.unlock();
+        std::lock_guard<std::recursive_mutex> computeLock(m_computeMutex);
+        inputLock.lock();
+
+        if(m_ingestStop)
+            return;
+
+        const int classNo = completeBatch();
+        if(classNo < 0)
+            continue;
+
+        // the complete traces are handed over, so the submission goes on while they are added to the contexts
+        if(classNo < m_numberOfClasses) {
+
+            TDataBuffer & traces = *(m_input->nonLabeledTraces[classNo]);
+            const size_t noOfTraces = traces.size() / traceSize;
+            m_ingestTraces.takeFront(traces, noOfTraces * traceSize);
+            m_input->ingestedTraces[classNo] += noOfTraces;
+            inputLock.unlock();
+
+            for(size_t added = 0; added < noOfTraces; added += batchTraces) {
+                addRawTracesToContext(classNo, m_ingestTraces.data() + added * traceSize, std::min(batchTraces, noOfTraces - added));
+            }
+
+        } else {
+
+            const size_t noOfTraces = std::min(m_input->traces.size() / traceSize, m_input->labels.size() / labelSize);
+
+            // the labels are checked before any of the traces is added, the invalid traces stay for the computation to report
+            if(!checkLabels(m_input->labels, noOfTraces)){
+                m_input->invalidLabels = true;
+                continue;
+            }
+
+            m_ingestTraces.takeFront(m_input->traces, noOfTraces * traceSize);
+            m_ingestLabels.takeFront(m_input->labels, noOfTraces * labelSize);
+            m_input->ingestedLabeledTraces += noOfTraces;
+            inputLock.unlock();
+
+            for(size_t added = 0; added < noOfTraces; added += labeledBatchTraces) {
+                addLabeledTracesToContexts(m_ingestTraces.data() + added * traceSize, m_ingestLabels, added, std::min(labeledBatchTraces, noOfTraces - added), m_traceLength);
+            }
+
+        }
+
+        m_ingestTraces.consume(m_ingestTraces.size());
+        m_ingestLabels.consume(m_ingestLabels.size());
+
+        inputLock.lock();
+
+    }
+
+}
+
+void TTTestDevice::startIngestion(){
+
+    m_ingestStop = false;
+    m_ingestThread = std::thread(&TTTestDevice::ingestionLoop, this);
+
+}
+
+void TTTestDevice::stopIngestion(){
+
+    if(!m_ingestThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+        m_ingestStop = true;
+    }
+
+    m_ingestCondition.notify_all();
+    m_ingestThread.join();
+
+    m_ingestTraces.clear();
+    m_ingestLabels.clear();
+
+}
+
+void TTTestDevice::restoreInput(){
+
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
 
     for(int i = 0; i < m_numberOfClasses; i++){
+        m_computeInput->nonLabeledTraces[i]->append(m_input->nonLabeledTraces[i]->data(), m_input->nonLabeledTraces[i]->size());
+        m_computeInput->pendingTraces[i]->append(*(m_input->pendingTraces[i]));
+        m_computeInput->ingestedTraces[i] += m_input->ingestedTraces[i];
+        m_input->nonLabeledTraces[i]->clear();
+        m_input->pendingTraces[i]->clear();
+        m_input->ingestedTraces[i] = 0;
+    }
+
+    m_computeInput->traces.append(m_input->traces.data(), m_input->traces.size());
+    m_computeInput->labels.append(m_input->labels.data(), m_input->labels.size());
+    m_computeInput->pendingLabeledTraces.append(m_input->pendingLabeledTraces);
+    m_computeInput->ingestedLabeledTraces += m_input->ingestedLabeledTraces;
+    m_computeInput->invalidLabels = m_computeInput->invalidLabels || m_input->invalidLabels;
+
+    m_input->traces.clear();
+    m_input->labels.clear();
+    m_input->pendingLabeledTraces.clear();
+    m_input->ingestedLabeledTraces = 0;
+    m_input->invalidLabels = false;
+
+    std::swap(m_input, m_computeInput);
+
+}
+
+bool TTTestDevice::checkLabels(const TDataBuffer & data, size_t count) const {
+
+    // the labels are decoded in chunks
+    std::vector<size_t> labels(std::min(count, LABEL_CHUNK));
+
+    for(size_t first = 0; first < count; first += LABEL_CHUNK){
+        const size_t chunk = std::min(LABEL_CHUNK, count - first);
+        getLabels(data, first, chunk, labels.data());
+        if(std::any_of(labels.begin(), labels.begin() + chunk, [&](size_t label){ return label >= m_numberOfClasses; })){
+            return false;
+        }
+    }
+
+    return true;
+
+}
+
+void TTTestDevice::resetContexts() {
+
+    for(int i = 0; i < m_contexts.length(); i++){
         m_contexts[i]->reset();
     }
 
-    m_traces.clear();
-    m_labels.clear();
+    for(int i = 0; i < m_contextsSingle.length(); i++){
+        m_contextsSingle[i]->reset();
+    }
 
-    for(int i = 0; i < m_numberOfClasses; i++){
-        m_nonLabeledTraces[i].clear();
+    for(int i = 0; i < m_histograms.length(); i++){
+        m_histograms[i]->reset();
     }
 
-    for (int i = 0; i < m_tvals.length(); i++) {
-        m_tvals[i]->fill(0);
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+        for (TInput & input : m_inputs) {
+
+            input.traces.clear();
+            input.labels.clear();
+            input.pendingLabeledTraces.clear();
+            input.ingestedLabeledTraces = 0;
+            input.invalidLabels = false;
+
+            for(int i = 0; i < m_numberOfClasses; i++){
+                input.nonLabeledTraces[i]->clear();
+                input.pendingTraces[i]->clear();
+                input.ingestedTraces[i] = 0;
+            }
+
+        }
     }
 
-    for (int i = 0; i < m_position.length(); i++) {
-        m_position[i] = m_tvals[i]->cols()*sizeof(qreal);
+    for(int i = 0; i < m_windowCards.length(); i++){
+        m_windowCards[i] = 0;
     }
+    m_contextStore.clear();
+
+    discardTVals();
+    discardTvlaSummary();
+    resetTvlaStability();
 
     qInfo("All previously submitted or computed (unread) data have been erased.");
 
@@ -307,22 +830,30 @@ void TTTestDevice::resetContexts() {
 
 size_t TTTestDevice::addLabeledTraces(const uint8_t * buffer, size_t length){
 
-    m_traces.reserve(m_traces.size() + length); // preallocate space
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
 
-    for(int i = 0; i < length; i++){
-        m_traces.append(buffer[i]);
+    if(m_windowWidth > 0) {
+        return m_input->pendingLabeledTraces.append(buffer, length) ? length : 0;
     }
 
+    m_input->traces.append(buffer, length);
+
+    // the complete batches are added to the contexts by the ingestion thread
+    m_ingestCondition.notify_one();
+
     return length;
 
 }
 
 size_t TTTestDevice::addLabels(const uint8_t * buffer, size_t length){
 
-    m_labels.reserve(m_labels.size() + length); // preallocate space
+    std::lock_guard<std::mutex> inputLock(m_inputMutex);
+
+    m_input->labels.append(buffer, length);
 
-    for(int i = 0; i < length; i++){
-        m_labels.append(buffer[i]);
+    // the tiled mode replays the labels along with the pending traces
+    if(m_windowWidth == 0) {
+        m_ingestCondition.notify_one();
     }
 
     return length;
@@ -354,206 +885,1025 @@ size_t TTTestDevice::getTypeSize(const QString & dataType){
 
 }
 
-void TTTestDevice::computeTVals(){
+template <class U>
+void TTTestDevice::addTracesToContext(size_t classNo, const U * traces, size_t noOfTraces){
 
-    size_t sampleSize = getTypeSize(m_traceType);
+    if(m_histogramEngine) {
 
-    qInfo("Unread t-values were erased. The submitted data will be added to all the previously submitted data (unless the Reset action was run), and the new t-values will be computed upon all of these.");
+        if(SICAK::UniHistInRange(*(m_histograms[classNo]), traces, noOfTraces * m_traceLength)) {
 
-    // Process nonLabeledTraces
-    for(int i=0; i < m_numberOfClasses; i++){
+            // the counts are folded into the moments before the bins overflow
+            if(m_histograms[classNo]->card() + noOfTraces > SICAK::HistogramContext::MAX_CARD) {
+                foldHistogram(classNo);
+            }
 
-        if(m_nonLabeledTraces[i].size() % (sampleSize * m_traceLength) != 0){
-            qCritical("Non-labeled traces buffer does not contain a valid amount of data: incomplete traces");
+            SICAK::UniHistAddTraces(*(m_histograms[classNo]), traces, m_traceLength, noOfTraces, m_threads);
             return;
+
         }
 
-        size_t noOfTraces = m_nonLabeledTraces[i].size() / (sampleSize * m_traceLength);
-
-        qInfo(QString("Now processing %1 bytes of data (%2 power traces) belonging to class %3.").arg(m_nonLabeledTraces[i].size()).arg(noOfTraces).arg(i).toLatin1());
-
-        if(noOfTraces > 0){
-
-            if(m_traceType == "Unsigned 8 bit") {
-                SICAK::UniHoTTestAddTraces<qreal, uint8_t>(*(m_contexts[i]), reinterpret_cast<const uint8_t *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Signed 8 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, int8_t>(*(m_contexts[i]), reinterpret_cast<const int8_t *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Unsigned 16 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, uint16_t>(*(m_contexts[i]), reinterpret_cast<const uint16_t *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Signed 16 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, int16_t>(*(m_contexts[i]), reinterpret_cast<const int16_t *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Unsigned 32 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, uint32_t>(*(m_contexts[i]), reinterpret_cast<const uint32_t *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Signed 32 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, int32_t>(*(m_contexts[i]), reinterpret_cast<const int32_t *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Real 32 bit (float)"){
-                SICAK::UniHoTTestAddTraces<qreal, float>(*(m_contexts[i]), reinterpret_cast<const float *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else if(m_traceType == "Real 64 bit (double)"){
-                SICAK::UniHoTTestAddTraces<qreal, double>(*(m_contexts[i]), reinterpret_cast<const double *>(m_nonLabeledTraces[i].data()), m_traceLength, noOfTraces, m_order);
-            } else {
-                qFatal("Unexpected trace type while adding traces.");
-                return;
-            }
+        qWarning("The sample values exceed the range of the histograms, switching to the power sums engine.");
 
+        for(int i = 0; i < m_histograms.length(); i++){
+            foldHistogram(i);
+            delete m_histograms[i];
         }
+        m_histograms.clear();
+        m_histogramEngine = false;
 
-        // Clear processed data from the buffers
-        m_nonLabeledTraces[i].clear();
+    }
 
+    if(m_singlePrecision) {
+        addTracesToContext(*(m_contextsSingle[classNo]), traces, noOfTraces);
+    } else {
+        addTracesToContext(*(m_contexts[classNo]), traces, noOfTraces);
     }
 
-    // Process labeled traces
-    if(m_traces.size() % (sampleSize * m_traceLength) != 0){
-        qCritical("Labeled traces buffer does not contain a valid amount of data: incomplete traces");
-        return;
+}
+
+template <class T, class U>
+void TTTestDevice::addTracesToContext(SICAK::Moments2DContext<T> & context, const U * traces, size_t noOfTraces){
+
+    // every thread fills its own partial context with a contiguous chunk of traces, the partial contexts are merged afterwards
+    size_t parts = SICAK::SplitMergeParts(context, noOfTraces, m_threads);
+
+    if(parts > 1) {
+        SICAK::SplitMergeAddTraces(context, noOfTraces, parts, [&](SICAK::Moments2DContext<T> & partial, size_t firstTrace, size_t count){
+            SICAK::UniHoTTestAddTraces<T, U>(partial, traces + firstTrace * context.p1Width(), context.p1Width(), count, m_order, 1);
+        });
+    } else {
+        SICAK::UniHoTTestAddTraces<T, U>(context, traces, context.p1Width(), noOfTraces, m_order, m_threads);
     }
 
-    size_t noOfTraces = m_traces.size() / (sampleSize * m_traceLength);
+}
 
-    size_t labelSize = getTypeSize(m_labelType);
+void TTTestDevice::foldHistogram(size_t classNo){
 
-    if(m_labels.size() % labelSize != 0){
-        qCritical("Labels buffer does not contain a valid amount of data: incomplete labels");
-        return;
+    if(m_singlePrecision) {
+        foldHistogram(classNo, *(m_contextsSingle[classNo]));
+    } else {
+        foldHistogram(classNo, *(m_contexts[classNo]));
     }
 
-    size_t noOfLabels = m_labels.size() / labelSize;
+}
+
+template <class T>
+void TTTestDevice::foldHistogram(size_t classNo, SICAK::Moments2DContext<T> & context){
 
-    if(noOfTraces != noOfLabels){
-        qCritical("Mismatching number of traces and labels");
+    if(m_histograms[classNo]->card() == 0)
         return;
-    }        
-
-    if(noOfTraces > 0) {
-
-        qInfo(QString("Now processing %1 bytes of data (%2 labeled power traces).").arg(m_traces.size()).arg(noOfTraces).toLatin1());
-
-        for(int i = 0; i < noOfTraces; i++){
-
-            size_t label;
-
-            if(m_labelType == "Unsigned 8 bit") {
-                label = reinterpret_cast<uint8_t *>(m_labels.data())[i];
-            } else if(m_labelType == "Signed 8 bit"){
-                label = reinterpret_cast<int8_t *>(m_labels.data())[i];
-            } else if(m_labelType == "Unsigned 16 bit"){
-                label = reinterpret_cast<uint16_t *>(m_labels.data())[i];
-            } else if(m_labelType == "Signed 16 bit"){
-                label = reinterpret_cast<int16_t *>(m_labels.data())[i];
-            } else if(m_labelType == "Unsigned 32 bit"){
-                label = reinterpret_cast<uint32_t *>(m_labels.data())[i];
-            } else if(m_labelType == "Signed 32 bit"){
-                label = reinterpret_cast<int32_t *>(m_labels.data())[i];
-            } else if(m_labelType == "Real 32 bit (float)"){
-                label = reinterpret_cast<float *>(m_labels.data())[i];
-            } else if(m_labelType == "Real 64 bit (double)"){
-                label = reinterpret_cast<double *>(m_labels.data())[i];
-            } else {
-                qFatal("Unexpected label type while adding traces.");
-                return;
-            }
 
-            if(label < 0 || label > m_numberOfClasses){
-                qCritical("Invalid trace label");
-                return;
-            }
+    SICAK::Moments2DContext<T> histContext(m_traceLength, 0, 1, 0, 2*m_order, 0, 0);
+    SICAK::UniHoTTestHistToContext(*(m_histograms[classNo]), histContext, m_order, m_threads);
 
-            if(m_traceType == "Unsigned 8 bit") {
-                SICAK::UniHoTTestAddTraces<qreal, uint8_t>(*(m_contexts[label]), reinterpret_cast<const uint8_t *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Signed 8 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, int8_t>(*(m_contexts[label]), reinterpret_cast<const int8_t *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Unsigned 16 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, uint16_t>(*(m_contexts[label]), reinterpret_cast<const uint16_t *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Signed 16 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, int16_t>(*(m_contexts[label]), reinterpret_cast<const int16_t *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Unsigned 32 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, uint32_t>(*(m_contexts[label]), reinterpret_cast<const uint32_t *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Signed 32 bit"){
-                SICAK::UniHoTTestAddTraces<qreal, int32_t>(*(m_contexts[label]), reinterpret_cast<const int32_t *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Real 32 bit (float)"){
-                SICAK::UniHoTTestAddTraces<qreal, float>(*(m_contexts[label]), reinterpret_cast<const float *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else if(m_traceType == "Real 64 bit (double)"){
-                SICAK::UniHoTTestAddTraces<qreal, double>(*(m_contexts[label]), reinterpret_cast<const double *>(m_traces.data()) + i * m_traceLength, m_traceLength, 1, m_order);
-            } else {
-                qFatal("Unexpected trace type while adding traces.");
-            }
+    context.merge(histContext, m_threads);
+    m_histograms[classNo]->reset();
+
+}
+
+template <class T>
+void TTTestDevice::deriveContexts(const QList<SICAK::Moments2DContext<T> *> & accumulated, QList<SICAK::Moments2DContext<T> *> & derived){
 
+    // the t-values are computed from the derived contexts, the ingestion thread goes on updating the accumulated ones meanwhile
+    for(int i = 0; i < accumulated.length(); i++){
+
+        if(i >= derived.length()) {
+            derived.append(new SICAK::Moments2DContext<T>(m_traceLength, 0, 1, 0, 2*m_order, 0, 0));
         }
 
-    }
+        derived[i]->reset();
 
-    // Clear processed data from the buffers
-    m_traces.clear();
-    m_labels.clear();
+        if(m_histogramEngine) {
 
-    // Compute t-vals
-    int k = 0;
-    for(int order = 1; order <= m_order; order++){
-        for (int i = 0; i < m_numberOfClasses; i++) {
-            for (int j = i + 1; j < m_numberOfClasses; j++) {
+            // the histogram engine derives the moments from the histograms, the moments folded earlier are merged in
+            SICAK::UniHoTTestHistToContext(*(m_histograms[i]), *(derived[i]), m_order, m_threads);
+            if(accumulated[i]->p1Card() > 0) {
+                derived[i]->merge(*(accumulated[i]), m_threads);
+            }
+
+        } else {
+
+            std::vector<const T *> buffers;
+            accumulated[i]->forEachBuffer([&](const T * data, size_t){ buffers.push_back(data); });
+
+            size_t buffer = 0;
+            derived[i]->forEachBuffer([&](T * data, size_t length){ std::memcpy(data, buffers[buffer++], length * sizeof(T)); });
+            derived[i]->p1Card() = accumulated[i]->p1Card();
+
+        }
+
+    }
+
+}
+
+void TTTestDevice::computeStreamTVals(size_t stream){
+
+    if(!m_stale[stream])
+        return;
+
+    bool ok;
+
+    if(m_singlePrecision) {
+        ok = computeStreamTVals(stream, m_derivedContextsSingle);
+    } else {
+        ok = computeStreamTVals(stream, m_derivedContexts);
+    }
+
+    // the t-values are left out when the window contexts cannot be read
+    if(!ok) {
+        *(m_tvals[stream]) = SICAK::Matrix<qreal>();
+        *(m_tvalsSingle[stream]) = SICAK::Matrix<float>();
+    }
+
+    m_stale[stream] = false;
+    m_position[stream] = 0;
+
+}
+
+template <class T>
+bool TTTestDevice::computeStreamTVals(size_t stream, const QList<SICAK::Moments2DContext<T> *> & contexts){
+
+    const size_t class1 = m_streamClass1[stream];
+    const size_t class2 = m_streamClass2[stream];
+    const size_t order = m_streamOrder[stream];
+
+    if(m_windowWidth == 0) {
+        if(m_singleOutput) {
+            computeTValsDegs(*(contexts[class1]), *(contexts[class2]), *(m_tvalsSingle[stream]), order);
+        } else {
+            computeTValsDegs(*(contexts[class1]), *(contexts[class2]), *(m_tvals[stream]), order);
+        }
+        return true;
+    }
+
+    // in the tiled mode the window contexts of the two classes are restored from the context file
+    SICAK::Moments2DContext<T> context1;
+    SICAK::Moments2DContext<T> context2;
+    size_t storeOffset = 0;
+
+    for(m_windowOffset = 0; m_windowOffset < m_traceLength; m_windowOffset += m_windowWidth){
+
+        const size_t width = std::min(m_windowWidth, m_traceLength - m_windowOffset);
+
+        // the window contexts of all the classes are stored one after another
+        size_t contextSize = 0;
+        context1.init(width, 0, 1, 0, 2 * m_order, 0, 0);
+        context1.forEachBuffer([&](T *, size_t length){ contextSize += length * sizeof(T); });
+
+        size_t offset1 = storeOffset + class1 * contextSize;
+        size_t offset2 = storeOffset + class2 * contextSize;
+
+        if(!loadWindowContext(context1, width, m_windowCards[class1], offset1) || !loadWindowContext(context2, width, m_windowCards[class2], offset2)) {
+            m_windowOffset = 0;
+            return false;
+        }
+
+        if(m_singleOutput) {
+            computeTValsDegs(context1, context2, *(m_tvalsSingle[stream]), order);
+        } else {
+            computeTValsDegs(context1, context2, *(m_tvals[stream]), order);
+        }
+
+        storeOffset += m_numberOfClasses * contextSize;
+
+    }
+
+    m_windowOffset = 0;
+
+    return true;
+
+}
+
+void TTTestDevice::discardTVals(){
+
+    for (int i = 0; i < m_tvals.length(); i++) {
+        *(m_tvals[i]) = SICAK::Matrix<qreal>();
+        *(m_tvalsSingle[i]) = SICAK::Matrix<float>();
+        m_position[i] = 0;
+        m_stale[i] = false;
+    }
+
+}
+
+template <class T, class R>
+void TTTestDevice::computeTValsDegs(const SICAK::Moments2DContext<T> & c1, const SICAK::Moments2DContext<T> & c2, SICAK::Matrix<R> & tValsDegs, size_t order){
+
+    if(m_windowWidth == 0) {
+        SICAK::UniHoTTestComputeTValsDegs(c1, c2, tValsDegs, order, m_threads);
+        return;
+    }
+
+    // the t-values of the window are placed into its columns of the whole matrix
+    SICAK::Matrix<R> windowTValsDegs;
+    SICAK::UniHoTTestComputeTValsDegs(c1, c2, windowTValsDegs, order, m_threads);
+
+    if(m_windowOffset == 0) {
+        tValsDegs.init(m_traceLength, 2);
+    }
+
+    for(size_t row = 0; row < 2; row++){
+        for(size_t col = 0; col < windowTValsDegs.cols(); col++){
+            tValsDegs(m_windowOffset + col, row) = windowTValsDegs(col, row);
+        }
+    }
+
+}
+
+template <class T>
+void TTTestDevice::updateTvlaSummary(const SICAK::Moments2DContext<T> & c1, const SICAK::Moments2DContext<T> & c2){
+
+    if(m_singleOutput) {
+        updateTvlaSummary(c1, c2, m_tvlaSummarySingle);
+    } else {
+        updateTvlaSummary(c1, c2, m_tvlaSummary);
+    }
+
+}
+
+template <class T, class R>
+void TTTestDevice::updateTvlaSummary(const SICAK::Moments2DContext<T> & c1, const SICAK::Moments2DContext<T> & c2, SICAK::Matrix<R> & summary){
+
+    // only the reductions of the t-values are kept, the t-values themselves are never stored
+    if(m_windowOffset == 0) {
+        summary.init(3, m_order, 0);
+    }
+
+    SICAK::Vector<R> windowSummary;
+    SICAK::Vector<R> orderSummary(3);
+
+    for(size_t order = 1; order <= m_order; order++){
+
+        SICAK::UniHoTTestComputeSummary(c1, c2, windowSummary, order, static_cast<R>(m_tvlaThreshold), m_threads);
+
+        for(size_t i = 0; i < 3; i++){
+            orderSummary(i) = summary(i, order - 1);
+        }
+
+        SICAK::UniHoTTestMergeSummary(orderSummary, windowSummary, m_windowOffset);
+
+        for(size_t i = 0; i < 3; i++){
+            summary(i, order - 1) = orderSummary(i);
+        }
+
+    }
+
+}
+
+void TTTestDevice::finishTvlaSummary(){
+
+    m_tvlaLeakage = 0;
+
+    // the run of computations in which no max |t| rose above its previous maximum
+    bool rising = m_tvlaPeaks.isEmpty();
+
+    for(size_t order = 1; order <= m_order; order++){
+
+        const qreal maxT = m_singleOutput ? m_tvlaSummarySingle(0, order - 1) : m_tvlaSummary(0, order - 1);
+        const qreal maxSample = m_singleOutput ? m_tvlaSummarySingle(1, order - 1) : m_tvlaSummary(1, order - 1);
+        const qreal above = m_singleOutput ? m_tvlaSummarySingle(2, order - 1) : m_tvlaSummary(2, order - 1);
+
+        if(maxT > m_tvlaThreshold) {
+            m_tvlaLeakage = 1;
+        }
+
+        if(m_tvlaPeaks.length() < static_cast<int>(order)) {
+            m_tvlaPeaks.append(maxT);
+        } else if(maxT > m_tvlaPeaks[order - 1]) {
+            m_tvlaPeaks[order - 1] = maxT;
+            rising = true;
+        }
+
+        qInfo(QString("TVLA monitor, %1-order t-test 0 vs 1: max |t| = %2 at sample %3, %4 samples above the threshold %5.").arg(order).arg(maxT).arg(maxSample).arg(above).arg(m_tvlaThreshold).toLatin1());
+
+    }
+
+    m_tvlaStableCount = (rising || m_tvlaLeakage) ? 0 : m_tvlaStableCount + 1;
+    m_tvlaStable = (m_tvlaStableAfter > 0 && m_tvlaStableCount >= m_tvlaStableAfter) ? 1 : 0;
+
+    if(m_tvlaStable) {
+        qInfo(QString("TVLA monitor: max |t| of every order has stayed below the threshold without rising for %1 computations.").arg(m_tvlaStableCount).toLatin1());
+    }
+
+    m_tvlaSummaryPosition = 0;
+    m_tvlaLeakagePosition = 0;
+    m_tvlaStablePosition = 0;
+
+}
 
-                SICAK::UniHoTTestComputeTValsDegs<qreal>(*(m_contexts[i]), *(m_contexts[j]), *(m_tvals[k]), order);
-                m_position[k] = 0;
-                k++;
+void TTTestDevice::discardTvlaSummary(){
 
+    m_tvlaSummary = SICAK::Matrix<qreal>();
+    m_tvlaSummarySingle = SICAK::Matrix<float>();
+    m_tvlaSummaryPosition = 0;
+    m_tvlaLeakage = 0;
+    m_tvlaLeakagePosition = 1; // nothing to read until the next computation
+    m_tvlaStable = 0;
+    m_tvlaStablePosition = 1;
+
+}
+
+void TTTestDevice::resetTvlaStability(){
+
+    m_tvlaPeaks.clear();
+    m_tvlaStableCount = 0;
+
+}
+
+const uint8_t * TTTestDevice::tValsData(int k) const {
+    if(m_singleOutput) {
+        return reinterpret_cast<const uint8_t *>(m_tvalsSingle[k]->data());
+    } else {
+        return reinterpret_cast<const uint8_t *>(m_tvals[k]->data());
+    }
+}
+
+size_t TTTestDevice::tValsSize(int k) const {
+    return m_singleOutput ? m_tvalsSingle[k]->size() : m_tvals[k]->size();
+}
+
+void TTTestDevice::computeTVals(){
+
+    size_t sampleSize = getTypeSize(m_traceType);
+    size_t labelSize = getTypeSize(m_labelType);
+
+    QList<size_t> noOfClassTraces;
+    size_t noOfTraces;
+
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+
+        for(int i=0; i < m_numberOfClasses; i++){
+
+            const size_t pendingSize = (m_windowWidth > 0) ? m_input->pendingTraces[i]->size() : m_input->nonLabeledTraces[i]->size();
+
+            if(pendingSize % (sampleSize * m_traceLength) != 0){
+                qCritical("Non-labeled traces buffer does not contain a valid amount of data: incomplete traces");
+                return;
             }
+
+            noOfClassTraces.append(pendingSize / (sampleSize * m_traceLength));
+
         }
+
+        const size_t pendingSize = (m_windowWidth > 0) ? m_input->pendingLabeledTraces.size() : m_input->traces.size();
+
+        if(pendingSize % (sampleSize * m_traceLength) != 0){
+            qCritical("Labeled traces buffer does not contain a valid amount of data: incomplete traces");
+            return;
+        }
+
+        noOfTraces = pendingSize / (sampleSize * m_traceLength);
+
+        if(m_input->labels.size() % labelSize != 0){
+            qCritical("Labels buffer does not contain a valid amount of data: incomplete labels");
+            return;
+        }
+
+        size_t noOfLabels = m_input->labels.size() / labelSize;
+
+        if(noOfTraces != noOfLabels){
+            qCritical("Mismatching number of traces and labels");
+            return;
+        }
+
+        // the labels are checked before any of the traces is added
+        if(!checkLabels(m_input->labels, noOfLabels)){
+            qCritical("Invalid trace label");
+            return;
+        }
+
+        // the data submitted during the computation go into the other input
+        std::swap(m_input, m_computeInput);
+    }
+
+    TInput & input = *m_computeInput;
+
+    qInfo("Unread t-values were erased. The submitted data will be added to all the previously submitted data (unless the Reset action was run), and the new t-values will be computed upon all of these.");
+
+    size_t totalTraces = noOfTraces;
+    for(int i = 0; i < m_numberOfClasses; i++){
+        totalTraces += noOfClassTraces[i];
     }
 
-    qInfo(QString("Generated %1 bytes of data (%2 t-values and %2 d.o.f.) on every stream, now available for reading.").arg(m_tvals[0]->size()).arg(m_traceLength).toLatin1());
+    // the tiled mode replays the pending traces window by window
+    m_totalTraces = (m_windowWidth > 0) ? totalTraces * ((m_traceLength + m_windowWidth - 1) / m_windowWidth) : totalTraces;
+
+    bool aborted = false;
+
+    // Process nonLabeledTraces
+    for(int i=0; i < m_numberOfClasses && !aborted; i++){
+
+        // the complete batches submitted earlier have already been added to the context
+        const size_t submittedTraces = noOfClassTraces[i] + input.ingestedTraces[i];
+
+        qInfo(QString("Now processing %1 bytes of data (%2 power traces) belonging to class %3.").arg(submittedTraces * sampleSize * m_traceLength).arg(submittedTraces).arg(i).toLatin1());
+
+        // in the tiled mode the traces are replayed window by window later on
+        if(m_windowWidth == 0){
+            aborted = !ingestTraces(input, i);
+        }
+
+    }
+
+    // Process labeled traces
+    const size_t submittedLabeledTraces = noOfTraces + input.ingestedLabeledTraces;
+
+    if(submittedLabeledTraces > 0 && !aborted) {
+
+        qInfo(QString("Now processing %1 bytes of data (%2 labeled power traces).").arg(submittedLabeledTraces * sampleSize * m_traceLength).arg(submittedLabeledTraces).toLatin1());
+
+        if(m_windowWidth == 0) {
+            aborted = !ingestLabeledTraces(input);
+        }
+
+    }
+
+    if(aborted) {
+        qWarning(QString("The computation was aborted after %1 of %2 traces, the added traces remain in the accumulated statistics and the rest is kept for the next computation.").arg(m_processedTraces.load()).arg(totalTraces).toLatin1());
+        restoreInput();
+        return;
+    }
+
+    if(m_windowWidth > 0) {
+
+        if(!computeTiled(input, noOfClassTraces, noOfTraces)) {
+            qWarning("The computation was aborted or a temporary file failed, the accumulated statistics are left as they were before it and the pending traces are kept for the next computation.");
+            restoreInput();
+            return;
+        }
+
+        for(int i = 0; i < input.pendingTraces.length(); i++){
+            input.pendingTraces[i]->clear();
+        }
+
+        input.pendingLabeledTraces.clear();
+
+    }
+
+    // Clear processed data from the buffers
+    for(int i = 0; i < m_numberOfClasses; i++){
+        input.nonLabeledTraces[i]->clear();
+        input.ingestedTraces[i] = 0;
+    }
+
+    input.traces.clear();
+    input.labels.clear();
+    input.ingestedLabeledTraces = 0;
+    input.invalidLabels = false;
+
+    // the tiled mode computes the t-values from the context file
+    if(m_windowWidth == 0) {
+        if(m_singlePrecision) {
+            deriveContexts(m_contextsSingle, m_derivedContextsSingle);
+        } else {
+            deriveContexts(m_contexts, m_derivedContexts);
+        }
+    }
+
+    // in the tiled mode the summary is updated window by window
+    if(m_tvlaMonitor) {
+        if(m_windowWidth == 0) {
+            if(m_singlePrecision) {
+                updateTvlaSummary(*(m_derivedContextsSingle[0]), *(m_derivedContextsSingle[1]));
+            } else {
+                updateTvlaSummary(*(m_derivedContexts[0]), *(m_derivedContexts[1]));
+            }
+        }
+        finishTvlaSummary();
+    }
+
+    // the t-values of a stream are only computed once the stream is read
+    discardTVals();
+
+    for (int i = 0; i < m_stale.length(); i++) {
+        m_stale[i] = true;
+    }
+
+    qInfo(QString("The t-values (%1 t-values and %1 d.o.f.) of every stream will be computed when the stream is first read.").arg(m_traceLength).toLatin1());
 }
 
-size_t TTTestDevice::getTValues(uint8_t * buffer, size_t length, size_t class1, size_t class2, size_t order){
+bool TTTestDevice::computeTiled(const TInput & input, const QList<size_t> & noOfTraces, size_t noOfLabeledTraces){
 
-    int k = 0;
+    const size_t sampleSize = getTypeSize(m_traceType);
+    const size_t batchTraces = std::max<size_t>(TILE_BUFFER_SIZE / (m_windowWidth * sampleSize), 1);
 
-    for(int orderIdx = 1; orderIdx <= m_order; orderIdx++){
-        for (int i = 0; i < m_numberOfClasses; i++) {
-            for (int j = i + 1; j < m_numberOfClasses; j++) {
+    size_t maxTraces = noOfLabeledTraces;
+    for(int i = 0; i < noOfTraces.length(); i++){
+        maxTraces = std::max(maxTraces, noOfTraces[i]);
+    }
+
+    std::vector<uint8_t> windowTraces(std::min(batchTraces, maxTraces) * m_windowWidth * sampleSize);
+
+    // all the windows have to see the same traces, the updated contexts replace the stored ones only when the replay completes
+    TFileBuffer store;
+    size_t loadOffset = 0;
+    size_t storeOffset = 0;
+
+    // the summary of an aborted or failed replay only covers some of the windows
+    auto abortTiled = [&](){
+        m_windowOffset = 0;
+        discardTvlaSummary();
+        return false;
+    };
+
+    for(m_windowOffset = 0; m_windowOffset < m_traceLength; m_windowOffset += m_windowWidth){
+
+        const size_t width = std::min(m_windowWidth, m_traceLength - m_windowOffset);
+
+        if(m_abort)
+            return abortTiled();
 
-                if(orderIdx == order && i == class1 && j == class2) {
+        // the contexts of all the classes are loaded, the labeled traces may belong to any of them
+        for(int i = 0; i < m_numberOfClasses; i++){
+
+            bool loaded;
 
-                    int sent = 0;
+            if(m_singlePrecision) {
+                loaded = loadWindowContext(*(m_contextsSingle[i]), width, m_windowCards[i], loadOffset);
+            } else {
+                loaded = loadWindowContext(*(m_contexts[i]), width, m_windowCards[i], loadOffset);
+            }
 
-                    //for (sent = 0; m_position[k] < (m_tvals[k]->cols() * sizeof(qreal)) && sent < length; sent++, m_position[k]++) {
-                    for (sent = 0; m_position[k] < (m_tvals[k]->size()) && sent < length; sent++, m_position[k]++) {
-                        buffer[sent] = *(reinterpret_cast<uint8_t *>(m_tvals[k]->data()) + m_position[k]);
-                    }
+            if(!loaded)
+                return abortTiled();
 
-                    return sent;
+        }
+
+        // the samples of the window are gathered from a batch of the pending traces
+        for(int i = 0; i < m_numberOfClasses; i++){
+            for(size_t firstTrace = 0; firstTrace < noOfTraces[i]; firstTrace += batchTraces){
 
+                if(m_abort)
+                    return abortTiled();
+
+                const size_t count = std::min(batchTraces, noOfTraces[i] - firstTrace);
+
+                for(size_t trace = 0; trace < count; trace++){
+                    if(!input.pendingTraces[i]->read(((firstTrace + trace) * m_traceLength + m_windowOffset) * sampleSize, windowTraces.data() + trace * width * sampleSize, width * sampleSize))
+                        return abortTiled();
                 }
 
-                k++;
+                addRawTracesToContext(i, windowTraces.data(), count);
+                m_processedTraces += count;
+
+            }
+        }
+
+        for(size_t firstTrace = 0; firstTrace < noOfLabeledTraces; firstTrace += batchTraces){
 
+            if(m_abort)
+                return abortTiled();
+
+            const size_t count = std::min(batchTraces, noOfLabeledTraces - firstTrace);
+
+            for(size_t trace = 0; trace < count; trace++){
+                if(!input.pendingLabeledTraces.read(((firstTrace + trace) * m_traceLength + m_windowOffset) * sampleSize, windowTraces.data() + trace * width * sampleSize, width * sampleSize))
+                    return abortTiled();
             }
+
+            addLabeledTracesToContexts(windowTraces.data(), input.labels, firstTrace, count, width);
+            m_processedTraces += count;
+
         }
+
+        if(m_tvlaMonitor) {
+            if(m_singlePrecision) {
+                updateTvlaSummary(*(m_contextsSingle[0]), *(m_contextsSingle[1]));
+            } else {
+                updateTvlaSummary(*(m_contexts[0]), *(m_contexts[1]));
+            }
+        }
+
+        for(int i = 0; i < m_numberOfClasses; i++){
+
+            bool stored;
+
+            if(m_singlePrecision) {
+                stored = storeWindowContext(*(m_contextsSingle[i]), store, storeOffset);
+            } else {
+                stored = storeWindowContext(*(m_contexts[i]), store, storeOffset);
+            }
+
+            if(!stored)
+                return abortTiled();
+
+        }
+
     }
 
-    return 0;
+    m_contextStore.swap(store);
+    m_windowOffset = 0;
+
+    for(int i = 0; i < m_numberOfClasses; i++){
+        m_windowCards[i] = m_singlePrecision ? m_contextsSingle[i]->p1Card() : m_contexts[i]->p1Card();
+    }
+
+    return true;
 
 }
 
-size_t TTTestDevice::availableBytes(size_t class1, size_t class2, size_t order){
+template <class T>
+bool TTTestDevice::loadWindowContext(SICAK::Moments2DContext<T> & context, size_t width, size_t card, size_t & storeOffset){
 
-    int k = 0;
+    context.init(width, 0, 1, 0, 2 * m_order, 0, 0);
+    context.reset();
 
-    for(int orderIdx = 1; orderIdx <= m_order; orderIdx++){
-        for (int i = 0; i < m_numberOfClasses; i++) {
-            for (int j = i + 1; j < m_numberOfClasses; j++) {
+    bool ok = true;
 
-                if(orderIdx == order && i == class1 && j == class2) {
+    context.forEachBuffer([&](T * data, size_t length){
+        // the window has not been stored yet
+        if(ok && card > 0) {
+            ok = m_contextStore.read(storeOffset, reinterpret_cast<uint8_t *>(data), length * sizeof(T));
+        }
+        storeOffset += length * sizeof(T);
+    });
 
-                    return m_tvals[k]->size() - m_position[k];
+    context.p1Card() = card;
 
-                }
+    return ok;
+
+}
+
+template <class T>
+bool TTTestDevice::storeWindowContext(const SICAK::Moments2DContext<T> & context, TFileBuffer & store, size_t & storeOffset){
+
+    bool ok = true;
+
+    context.forEachBuffer([&](const T * data, size_t length){
+        ok = ok && store.write(storeOffset, reinterpret_cast<const uint8_t *>(data), length * sizeof(T));
+        storeOffset += length * sizeof(T);
+    });
+
+    return ok;
+
+}
+
+void TTTestDevice::saveContext(){
+
+    {
+        std::lock_guard<std::mutex> inputLock(m_inputMutex);
+
+        bool pending = m_input->traces.size() > 0 || m_input->pendingLabeledTraces.size() > 0;
+        for(int i = 0; i < m_numberOfClasses; i++){
+            pending = pending || m_input->nonLabeledTraces[i]->size() > 0 || m_input->pendingTraces[i]->size() > 0;
+        }
+
+        if(pending) {
+            qWarning("Some of the traces submitted since the last computation are not part of the accumulated statistics yet and will not be saved.");
+        }
+    }
+
+    TContextCheckpoint checkpoint;
+
+    if(!checkpoint.create(m_checkpointFile, m_checkpointGroup, getName()))
+        return;
+
+    bool ok = checkpoint.writeAttribute("trace_length", m_traceLength)
+           && checkpoint.writeAttribute("class_count", m_numberOfClasses)
+           && checkpoint.writeAttribute("order", m_order)
+           && checkpoint.writeAttribute("sample_window", m_windowWidth);
+
+    // the histograms are folded into the moments, only the moments are saved
+    for(int i = 0; i < m_histograms.length(); i++){
+        foldHistogram(i);
+    }
+
+    if(ok) {
+        if(m_singlePrecision) {
+            ok = saveContexts(checkpoint, m_contextsSingle);
+        } else {
+            ok = saveContexts(checkpoint, m_contexts);
+        }
+    }
+
+    // the previous checkpoint is only replaced by a complete one
+    ok = ok && checkpoint.commit();
+
+    if(ok) {
+        qInfo("The accumulated statistics of all the classes were saved into the checkpoint.");
+    }
+
+}
+
+template <class T>
+bool TTTestDevice::saveContexts(TContextCheckpoint & checkpoint, const QList<SICAK::Moments2DContext<T> *> & contexts){
+
+    if(m_windowWidth == 0) {
+        for(int i = 0; i < m_numberOfClasses; i++){
+            if(!checkpoint.writeContext(QString("class_%1").arg(i), *(contexts[i])))
+                return false;
+        }
+        return true;
+    }
+
+    // in the tiled mode every window context is restored from the context file and saved separately
+    SICAK::Moments2DContext<T> window;
+    size_t storeOffset = 0;
+
+    for(size_t offset = 0, windowNo = 0; offset < m_traceLength; offset += m_windowWidth, windowNo++){
+        for(int i = 0; i < m_numberOfClasses; i++){
+            if(!loadWindowContext(window, std::min(m_windowWidth, m_traceLength - offset), m_windowCards[i], storeOffset) || !checkpoint.writeContext(QString("class_%1_window_%2").arg(i).arg(windowNo), window))
+                return false;
+        }
+    }
+
+    return true;
+
+}
+
+void TTTestDevice::loadContext(){
+
+    TContextCheckpoint checkpoint;
+
+    if(!checkpoint.open(m_checkpointFile, m_checkpointGroup, getName()))
+        return;
+
+    quint64 traceLength, numberOfClasses, order, windowWidth;
+
+    if(!checkpoint.readAttribute("trace_length", traceLength)
+       || !checkpoint.readAttribute("class_count", numberOfClasses)
+       || !checkpoint.readAttribute("order", order)
+       || !checkpoint.readAttribute("sample_window", windowWidth)) {
+        return;
+    }
+
+    if(traceLength != m_traceLength || numberOfClasses != m_numberOfClasses || order != m_order || windowWidth != m_windowWidth) {
+        qCritical("The checkpoint does not match the configuration of the device (trace length, number of classes, order or sample window).");
+        return;
+    }
+
+    bool ok;
+
+    if(m_singlePrecision) {
+        ok = loadContexts(checkpoint, m_contextsSingle);
+    } else {
+        ok = loadContexts(checkpoint, m_contexts);
+    }
+
+    if(ok) {
+        // the counts of the histograms are part of the replaced statistics
+        for(int i = 0; i < m_histograms.length(); i++){
+            m_histograms[i]->reset();
+        }
+        discardTVals();
+        discardTvlaSummary();
+        resetTvlaStability();
+        qInfo("The accumulated statistics of all the classes were loaded from the checkpoint, the submitted traces will be added to them.");
+    }
+
+}
 
-                k++;
+template <class T>
+bool TTTestDevice::loadContexts(TContextCheckpoint & checkpoint, QList<SICAK::Moments2DContext<T> *> & contexts){
 
+    // the current statistics are only replaced once the whole checkpoint has been read
+    if(m_windowWidth == 0) {
+
+        QList<SICAK::Moments2DContext<T> *> loaded;
+        bool ok = true;
+
+        for(int i = 0; i < m_numberOfClasses && ok; i++){
+            loaded.append(new SICAK::Moments2DContext<T>(m_traceLength, 0, 1, 0, 2*m_order, 0, 0));
+            ok = checkpoint.readContext(QString("class_%1").arg(i), *(loaded[i]));
+        }
+
+        for(int i = 0; i < loaded.length(); i++){
+            if(ok) {
+                *(contexts[i]) = std::move(*(loaded[i]));
+            }
+            delete loaded[i];
+        }
+
+        return ok;
+
+    }
+
+    SICAK::Moments2DContext<T> window;
+    TFileBuffer store;
+    size_t storeOffset = 0;
+    QList<size_t> cards;
+
+    for(size_t offset = 0, windowNo = 0; offset < m_traceLength; offset += m_windowWidth, windowNo++){
+        for(int i = 0; i < m_numberOfClasses; i++){
+
+            window.init(std::min(m_windowWidth, m_traceLength - offset), 0, 1, 0, 2*m_order, 0, 0);
+
+            if(!checkpoint.readContext(QString("class_%1_window_%2").arg(i).arg(windowNo), window))
+                return false;
+
+            if(!storeWindowContext(window, store, storeOffset))
+                return false;
+
+            if(windowNo == 0) {
+                cards.append(window.p1Card());
             }
+
         }
     }
 
-    return 0;
+    m_contextStore.swap(store);
+    m_windowCards = cards;
+
+    return true;
+
+}
+
+void TTTestDevice::getLabels(const TDataBuffer & data, size_t first, size_t count, size_t * labels) const {
+
+    auto decode = [&](const auto * values){
+        for(size_t i = 0; i < count; i++){
+            labels[i] = values[first + i];
+        }
+    };
+
+    if(m_labelType == "Unsigned 8 bit") {
+        decode(data.view<uint8_t>());
+    } else if(m_labelType == "Signed 8 bit"){
+        decode(data.view<int8_t>());
+    } else if(m_labelType == "Unsigned 16 bit"){
+        decode(data.view<uint16_t>());
+    } else if(m_labelType == "Signed 16 bit"){
+        decode(data.view<int16_t>());
+    } else if(m_labelType == "Unsigned 32 bit"){
+        decode(data.view<uint32_t>());
+    } else if(m_labelType == "Signed 32 bit"){
+        decode(data.view<int32_t>());
+    } else if(m_labelType == "Real 32 bit (float)"){
+        decode(data.view<float>());
+    } else if(m_labelType == "Real 64 bit (double)"){
+        decode(data.view<double>());
+    } else {
+        qFatal("Unexpected label type while adding traces.");
+    }
+
+}
+
+void TTTestDevice::addLabeledTracesToContexts(const uint8_t * traces, const TDataBuffer & data, size_t firstTrace, size_t noOfTraces, size_t samplesPerTrace){
+
+    const size_t traceSize = samplesPerTrace * getTypeSize(m_traceType);
+
+    // one pass over the labels counts the traces of every class, the traces are then scattered into contiguous per-class buckets
+    std::vector<size_t> labels(noOfTraces);
+    std::vector<size_t> bucketStart(m_numberOfClasses + 1, 0);
+
+    getLabels(data, firstTrace, noOfTraces, labels.data());
+
+    for(size_t trace = 0; trace < noOfTraces; trace++){
+        bucketStart[labels[trace] + 1]++;
+    }
+
+    for(size_t classNo = 0; classNo < m_numberOfClasses; classNo++){
+        bucketStart[classNo + 1] += bucketStart[classNo];
+    }
+
+    std::vector<uint8_t> buckets(noOfTraces * traceSize);
+    std::vector<size_t> bucketEnd(bucketStart.begin(), bucketStart.end() - 1);
+
+    for(size_t trace = 0; trace < noOfTraces; trace++){
+        std::memcpy(buckets.data() + (bucketEnd[labels[trace]]++) * traceSize, traces + trace * traceSize, traceSize);
+    }
+
+    // every class is updated by a single batched call, parallelized over the samples or the traces inside
+    for(size_t classNo = 0; classNo < m_numberOfClasses; classNo++){
+        const size_t count = bucketStart[classNo + 1] - bucketStart[classNo];
+        if(count > 0) {
+            addRawTracesToContext(classNo, buckets.data() + bucketStart[classNo] * traceSize, count);
+        }
+    }
+
+}
+
+void TTTestDevice::addRawTracesToContext(size_t classNo, const uint8_t * traces, size_t noOfTraces){
+
+    if(m_traceType == "Unsigned 8 bit") {
+        addTracesToContext(classNo, reinterpret_cast<const uint8_t *>(traces), noOfTraces);
+    } else if(m_traceType == "Signed 8 bit"){
+        addTracesToContext(classNo, reinterpret_cast<const int8_t *>(traces), noOfTraces);
+    } else if(m_traceType == "Unsigned 16 bit"){
+        addTracesToContext(classNo, reinterpret_cast<const uint16_t *>(traces), noOfTraces);
+    } else if(m_traceType == "Signed 16 bit"){
+        addTracesToContext(classNo, reinterpret_cast<const int16_t *>(traces), noOfTraces);
+    } else if(m_traceType == "Unsigned 32 bit"){
+        addTracesToContext(classNo, reinterpret_cast<const uint32_t *>(traces), noOfTraces);
+    } else if(m_traceType == "Signed 32 bit"){
+        addTracesToContext(classNo, reinterpret_cast<const int32_t *>(traces), noOfTraces);
+    } else if(m_traceType == "Real 32 bit (float)"){
+        addTracesToContext(classNo, reinterpret_cast<const float *>(traces), noOfTraces);
+    } else if(m_traceType == "Real 64 bit (double)"){
+        addTracesToContext(classNo, reinterpret_cast<const double *>(traces), noOfTraces);
+    } else {
+        qFatal("Unexpected trace type while adding traces.");
+    }
+
+}
+
+size_t TTTestDevice::getTValues(uint8_t * buffer, size_t length, size_t stream){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    const size_t sent = std::min(length, availableBytes(stream));
+
+    if(sent > 0) {
+        std::memcpy(buffer, tValsData(stream) + m_position[stream], sent);
+        m_position[stream] += sent;
+    }
+
+    return sent;
+
+}
+
+size_t TTTestDevice::availableBytes(size_t stream){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    computeStreamTVals(stream);
+
+    return tValsSize(stream) - m_position[stream];
+
+}
+
+size_t TTTestDevice::getTvlaSummary(uint8_t * buffer, size_t length){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    const uint8_t * data = m_singleOutput ? reinterpret_cast<const uint8_t *>(m_tvlaSummarySingle.data()) : reinterpret_cast<const uint8_t *>(m_tvlaSummary.data());
+    const size_t sent = std::min(length, availableTvlaSummaryBytes());
+
+    if(sent > 0) {
+        std::memcpy(buffer, data + m_tvlaSummaryPosition, sent);
+        m_tvlaSummaryPosition += sent;
+    }
+
+    return sent;
+
+}
+
+size_t TTTestDevice::availableTvlaSummaryBytes(){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    const size_t size = m_singleOutput ? m_tvlaSummarySingle.size() : m_tvlaSummary.size();
+
+    return size - m_tvlaSummaryPosition;
+
+}
+
+size_t TTTestDevice::getTvlaLeakage(uint8_t * buffer, size_t length){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    if(length == 0 || availableTvlaLeakageBytes() == 0)
+        return 0;
+
+    buffer[0] = m_tvlaLeakage;
+    m_tvlaLeakagePosition = 1;
+
+    return 1;
+
+}
+
+size_t TTTestDevice::availableTvlaLeakageBytes(){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    return 1 - m_tvlaLeakagePosition;
+
+}
+
+size_t TTTestDevice::getTvlaStable(uint8_t * buffer, size_t length){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    if(length == 0 || availableTvlaStableBytes() == 0)
+        return 0;
+
+    buffer[0] = m_tvlaStable;
+    m_tvlaStablePosition = 1;
+
+    return 1;
+
+}
+
+size_t TTTestDevice::availableTvlaStableBytes(){
+
+    // the results are not available while an action is running
+    std::unique_lock<std::recursive_mutex> resultsLock(m_resultsMutex, std::try_to_lock);
+    if(!resultsLock.owns_lock()) return 0;
+
+    return 1 - m_tvlaStablePosition;
 
 }
@@ -23,9 +23,17 @@
 #include <QString>
 #include <QList>
 #include <QQueue>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include "tconfigparam.h"
 #include "tanaldevice.h"
 #include "typesmoment.hpp"
+#include "tfilebuffer.hpp"
+#include "tdatabuffer.hpp"
+#include "tcontextcheckpoint.hpp"
 
 class TTTestDevice : public TAnalDevice {
 
@@ -63,13 +71,34 @@ public:
 
     virtual bool isBusy() const override;
 
+    /// Stops the running computation at the next batch of traces, the traces not processed yet are kept for the next run
+    void abortAction();
+    /// Number of the processed and of all the traces of the running computation
+    std::pair<size_t, size_t> getProgress() const;
+
     size_t addTraces(const uint8_t * buffer, size_t length, size_t classNo);
-    size_t getTValues(uint8_t * buffer, size_t length, size_t class1, size_t class2, size_t order);
-    size_t availableBytes(size_t class1, size_t class2, size_t order);
+    /// The t-values of the stream are computed on the first read after the computation
+    size_t getTValues(uint8_t * buffer, size_t length, size_t stream);
+    size_t availableBytes(size_t stream);
 
     void resetContexts();
     void computeTVals();
 
+    /// Saves the accumulated statistics into the checkpoint file
+    void saveContext();
+    /// Replaces the accumulated statistics with the ones from the checkpoint file
+    void loadContext();
+
+    /// Per-order summary of the t-values of the classes 0 and 1 (max |t|, index of its sample, number of samples above the threshold)
+    size_t getTvlaSummary(uint8_t * buffer, size_t length);
+    size_t availableTvlaSummaryBytes();
+    /// A single byte, 1 when the max |t| of any order exceeds the threshold
+    size_t getTvlaLeakage(uint8_t * buffer, size_t length);
+    size_t availableTvlaLeakageBytes();
+    /// A single byte, 1 when the max |t| of every order has stayed below the threshold without rising for the configured number of computations
+    size_t getTvlaStable(uint8_t * buffer, size_t length);
+    size_t availableTvlaStableBytes();
+
     size_t addLabeledTraces(const uint8_t * buffer, size_t length);
     size_t addLabels(const uint8_t * buffer, size_t length);
 
@@ -77,27 +106,179 @@ public:
 
 private:
 
+    /// Size of the buffer holding the samples of a window gathered from the pending traces, in bytes
+    static const size_t TILE_BUFFER_SIZE = 32 * 1024 * 1024;
+    /// Size of the buffer the labeled traces are grouped by their labels in, in bytes
+    static constexpr size_t BUCKET_BUFFER_SIZE = 32 * 1024 * 1024;
+    /// Number of labels decoded at once while checking them
+    static constexpr size_t LABEL_CHUNK = 64 * 1024;
+    /// Amount of the submitted traces that is added to the contexts as soon as it is complete, in bytes
+    static constexpr size_t INGEST_BATCH_SIZE = 32 * 1024 * 1024;
+
+    /// Traces and labels submitted since the last computation. A computation takes the input over,
+    /// so the new data are accepted into the other one meanwhile.
+    struct TInput {
+        QList<TDataBuffer *> nonLabeledTraces;
+        TDataBuffer traces;
+        TDataBuffer labels;
+        QList<TFileBuffer *> pendingTraces; // the tiled mode
+        TFileBuffer pendingLabeledTraces;
+        QList<size_t> ingestedTraces; // added to the contexts already
+        size_t ingestedLabeledTraces = 0;
+        bool invalidLabels = false; // the labels of a complete batch were rejected, they are reported by the computation
+    };
+
+    /// Runs the action with the accumulated statistics locked, the device is busy meanwhile
+    void runAction(const std::function<void(void)> & action);
+
+    /// Adds the complete traces of the class in the input to its context and drops them from the input,
+    /// stops at a batch boundary when aborted, returns false then
+    bool ingestTraces(TInput & input, size_t classNo);
+    /// Adds the complete labeled traces of the input along with their labels, fails on an invalid label or when aborted
+    bool ingestLabeledTraces(TInput & input);
+    /// Runs in the ingestion thread: takes the complete batches over from the input and adds them to the contexts,
+    /// so the submission of the data overlaps with the update of the contexts
+    void ingestionLoop();
+    void startIngestion();
+    void stopIngestion();
+    /// Checks the first 'count' labels are valid class numbers
+    bool checkLabels(const TDataBuffer & labels, size_t count) const;
+    /// Returns the traces not processed by an aborted computation to the input, ahead of the ones submitted meanwhile
+    void restoreInput();
+
+    /// Adds the traces to the context of the given class, in their configured data type
+    void addRawTracesToContext(size_t classNo, const uint8_t * traces, size_t noOfTraces);
+    /// Adds the traces to the context of the given class, in the selected precision
+    template <class U>
+    void addTracesToContext(size_t classNo, const U * traces, size_t noOfTraces);
+    /// Adds the traces to the context, splits them among partial contexts when worth it
+    template <class T, class U>
+    void addTracesToContext(SICAK::Moments2DContext<T> & context, const U * traces, size_t noOfTraces);
+    /// Folds the histograms of the given class into the context of the selected precision and clears them
+    void foldHistogram(size_t classNo);
+    template <class T>
+    void foldHistogram(size_t classNo, SICAK::Moments2DContext<T> & context);
+    /// Derives the contexts the t-values are computed from until the next computation, from the histograms or as a copy of the accumulated ones
+    template <class T>
+    void deriveContexts(const QList<SICAK::Moments2DContext<T> *> & accumulated, QList<SICAK::Moments2DContext<T> *> & derived);
+    /// Computes the t-values and the degrees of freedom of the stream in the selected output type, unless they are up to date
+    void computeStreamTVals(size_t stream);
+    template <class T>
+    bool computeStreamTVals(size_t stream, const QList<SICAK::Moments2DContext<T> *> & contexts);
+    /// Deletes the t-values of all the streams
+    void discardTVals();
+    /// Computes the t-values of a class pair, in the tiled mode into the columns of the current window
+    template <class T, class R>
+    void computeTValsDegs(const SICAK::Moments2DContext<T> & c1, const SICAK::Moments2DContext<T> & c2, SICAK::Matrix<R> & tValsDegs, size_t order);
+
+    /// Updates the TVLA summary of all the orders from the contexts of the classes 0 and 1, in the tiled mode merges in the current window
+    template <class T>
+    void updateTvlaSummary(const SICAK::Moments2DContext<T> & c1, const SICAK::Moments2DContext<T> & c2);
+    template <class T, class R>
+    void updateTvlaSummary(const SICAK::Moments2DContext<T> & c1, const SICAK::Moments2DContext<T> & c2, SICAK::Matrix<R> & summary);
+    /// Publishes the TVLA summary and the leakage flag after the computation
+    void finishTvlaSummary();
+    void discardTvlaSummary();
+    /// Forgets the previous maxima of the summary, the stability is counted anew
+    void resetTvlaStability();
+
+    /// Saves/loads the contexts of all the classes, or all their window contexts in the tiled mode
+    template <class T>
+    bool saveContexts(TContextCheckpoint & checkpoint, const QList<SICAK::Moments2DContext<T> *> & contexts);
+    template <class T>
+    bool loadContexts(TContextCheckpoint & checkpoint, QList<SICAK::Moments2DContext<T> *> & contexts);
+
+    /// Decodes the labels of the given range of the labeled traces
+    void getLabels(const TDataBuffer & data, size_t first, size_t count, size_t * labels) const;
+    /// Groups the labeled traces by their labels and adds every group to the context of its class at once
+    void addLabeledTracesToContexts(const uint8_t * traces, const TDataBuffer & labels, size_t firstTrace, size_t noOfTraces, size_t samplesPerTrace);
+
+    /// Replays the pending traces of the input window by window, the window contexts of all classes are loaded from the context file and stored
+    /// into a new one, which replaces it once all the windows are done. Stops at a window or batch boundary when aborted, or when a file
+    /// cannot be read or written, returns false then.
+    bool computeTiled(const TInput & input, const QList<size_t> & noOfTraces, size_t noOfLabeledTraces);
+    /// Loads the window context from the context file at the offset, which is moved past it; returns false when the file cannot be read
+    template <class T>
+    bool loadWindowContext(SICAK::Moments2DContext<T> & context, size_t width, size_t card, size_t & storeOffset);
+    /// Stores the window context into the file at the offset, which is moved past it; returns false when the file cannot be written
+    template <class T>
+    bool storeWindowContext(const SICAK::Moments2DContext<T> & context, TFileBuffer & store, size_t & storeOffset);
+
+    /// Raw data of the k-th t-values matrix, in the selected output type
+    const uint8_t * tValsData(int k) const;
+    size_t tValsSize(int k) const;
+
     TConfigParam m_preInitParams;
+    TConfigParam m_postInitParams;
     size_t m_traceLength;
     size_t m_numberOfClasses;
     QString m_traceType;
     size_t m_order;
+    size_t m_threads;
+    bool m_singlePrecision;
+    bool m_singleOutput;
+    bool m_histogramEngine;
+    size_t m_windowWidth; // 0 - whole traces at once
+    size_t m_windowOffset;
+    QList<size_t> m_windowCards;
+    QString m_checkpointFile;
+    QString m_checkpointGroup;
+
+    bool m_tvlaMonitor;
+    qreal m_tvlaThreshold;
+    size_t m_tvlaStableAfter;
 
     int m_inputFormat; // 0 - stream per class, 1 - labels
     QString m_labelType;
 
     QList<SICAK::Moments2DContext<qreal> *> m_contexts;
+    QList<SICAK::Moments2DContext<float> *> m_contextsSingle;
+    QList<SICAK::HistogramContext *> m_histograms;
 
     QList<TAnalAction *> m_analActions;
     QList<TAnalInputStream *> m_analInputStreams;
     QList<TAnalOutputStream *> m_analOutputStreams;
 
-    QList<uint8_t> * m_nonLabeledTraces;
-    QList<uint8_t> m_traces;
-    QList<uint8_t> m_labels;
+    TInput m_inputs[2];
+    TInput * m_input; // accepts the submitted data
+    TInput * m_computeInput; // taken over by the running computation
+    std::mutex m_inputMutex; // guards the input
+    std::recursive_mutex m_computeMutex; // guards the contexts
+    std::recursive_mutex m_resultsMutex; // guards the results, held by the actions but never by the ingestion thread
+
+    std::thread m_ingestThread;
+    std::condition_variable m_ingestCondition; // notified under the input mutex when data are submitted
+    bool m_ingestStop;
+    TDataBuffer m_ingestTraces; // the traces handed over to the ingestion thread
+    TDataBuffer m_ingestLabels;
+
+    std::atomic<bool> m_busy;
+    std::atomic<bool> m_abort;
+    std::atomic<size_t> m_processedTraces;
+    std::atomic<size_t> m_totalTraces;
 
     QList<SICAK::Matrix<qreal> *> m_tvals;
+    QList<SICAK::Matrix<float> *> m_tvalsSingle;
     QList<size_t> m_position;
+    QList<bool> m_stale; // the t-values of the stream are to be computed
+    QList<size_t> m_streamClass1;
+    QList<size_t> m_streamClass2;
+    QList<size_t> m_streamOrder;
+
+    SICAK::Matrix<qreal> m_tvlaSummary; // row per order
+    SICAK::Matrix<float> m_tvlaSummarySingle;
+    size_t m_tvlaSummaryPosition;
+    uint8_t m_tvlaLeakage;
+    size_t m_tvlaLeakagePosition;
+    QList<qreal> m_tvlaPeaks; // the highest max |t| of every order seen so far
+    size_t m_tvlaStableCount; // computations in a row in which no max |t| rose
+    uint8_t m_tvlaStable;
+    size_t m_tvlaStablePosition;
+
+    QList<SICAK::Moments2DContext<qreal> *> m_derivedContexts; // the contexts the t-values are computed from
+    QList<SICAK::Moments2DContext<float> *> m_derivedContextsSingle;
+
+    TFileBuffer m_contextStore;
 
 };
 
@@ -64,3 +64,8 @@ bool TAnalActionModel::isEnabled() const
 {
     return m_action->isEnabled();
 }
+
+std::pair<size_t, size_t> TAnalActionModel::progress() const
+{
+    return m_action->getProgress();
+}
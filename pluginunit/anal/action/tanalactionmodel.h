@@ -38,6 +38,8 @@ public:
     QString info();
 
     bool isEnabled() const;
+    /// Number of the processed and of all the work items of the current run, both are zero when not reported
+    std::pair<size_t, size_t> progress() const;
 
 private:
     TAnalAction * m_action;
@@ -42,6 +42,11 @@ size_t TAnalStreamReceiver::readData(uint8_t * buffer, size_t len)
     return m_stream->readData(buffer, len);
 }
 
+QByteArray TAnalStreamReceiver::readBlock(size_t len)
+{
+    return m_stream->readBlock(len);
+}
+
 std::optional<size_t> TAnalStreamReceiver::availableBytes() {
     return m_stream->availableBytes();
 }
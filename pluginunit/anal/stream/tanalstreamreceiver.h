@@ -38,6 +38,7 @@ public:
 
 protected:
     size_t readData(uint8_t * buffer, size_t len) override;
+    QByteArray readBlock(size_t len) override;
     std::optional<size_t> availableBytes() override;
 
 private:
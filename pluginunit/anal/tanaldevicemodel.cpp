@@ -18,6 +18,9 @@
 // Vojtěch Miškovský (initial author)
 // Adam Švehla
 
+#include <QEventLoop>
+#include <QTimer>
+
 #include "tanaldevicemodel.h"
 
 #include "../component/tcomponentmodel.h"
@@ -78,6 +81,27 @@ bool TAnalDeviceModel::deInit()
         m_receiverModels[i]->disableAutoRead();
     }
 
+    // the running actions stop at their next checkpoint
+    for (int i = 0; i < m_actionModels.length(); i++) {
+        emit m_actionModels[i]->abort();
+    }
+
+    // the events keep being processed meanwhile, the wait ends when an action finishes, the timer covers a device busy otherwise
+    if (m_analDevice && m_analDevice->isBusy()) {
+        QEventLoop loop;
+        QTimer timer;
+
+        for (int i = 0; i < m_actionModels.length(); i++) {
+            connect(m_actionModels[i], &TAnalActionModel::finished, &loop, &QEventLoop::quit);
+        }
+        connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+        timer.start(DEINIT_POLL_MS);
+
+        while (m_analDevice && m_analDevice->isBusy()) {
+            loop.exec();
+        }
+    }
+
     if (!isInit() || !TPluginUnitModel::deInit()) {
         return false;
     }
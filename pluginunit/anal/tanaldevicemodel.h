@@ -27,6 +27,8 @@
 #include "../common/sender/tsendermodel.h"
 #include "action/tanalactionmodel.h"
 
+#define DEINIT_POLL_MS 10
+
 class TAnalDeviceContainer;
 
 class TAnalDeviceModel : public TDeviceModel
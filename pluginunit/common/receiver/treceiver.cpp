@@ -21,11 +21,12 @@
 
 #include <QCoreApplication>
 #include <QThread>
+#include <algorithm>
 
 #include "treceiver.h"
 
 TReceiver::TReceiver(QObject * parent)
-    : QObject(parent)
+    : QObject(parent), m_stopReceiving(false)
 {
 
 }
@@ -40,28 +41,69 @@ QString TReceiver::info() {
 
 void TReceiver::receiveData(int length)
 {
-    size_t remainingBytes = (size_t)length;
-    quint8 buffer[DATA_BLOCK_SIZE];
-    QByteArray data;
+    QByteArray data = readBlock(length > 0 ? (size_t)length : 0);
 
-    while (remainingBytes > 0) {
-        size_t bytesToReceive = (remainingBytes > DATA_BLOCK_SIZE ? DATA_BLOCK_SIZE : remainingBytes);
+    if (data.size() < length) {
+        emit receiveFailed();
+    }
 
-        size_t bytesReceived = readData(buffer, bytesToReceive);
+    if (!data.isEmpty()) {
+        emit dataReceived(data);
+    }
+}
+
+QByteArray TReceiver::readBlock(size_t len)
+{
+    // the whole block is allocated at once, the reads start at the available amount of data, when known
+    QByteArray & data = pooledBuffer(len);
+    std::optional<size_t> available = availableBytes();
+    size_t blockSize = std::clamp<size_t>(available ? *available : 0, DATA_BLOCK_SIZE, MAX_DATA_BLOCK_SIZE);
+    size_t receivedBytes = 0;
 
-        data.append((char*)buffer, bytesReceived);
+    while (receivedBytes < len) {
+        size_t bytesToReceive = std::min(blockSize, len - receivedBytes);
+
+        size_t bytesReceived = readData(reinterpret_cast<uint8_t *>(data.data()) + receivedBytes, bytesToReceive);
+
+        receivedBytes += bytesReceived;
 
         if (bytesReceived < bytesToReceive) {
-            emit receiveFailed();
             break;
         }
 
-        remainingBytes -= bytesReceived;
+        blockSize = std::min<size_t>(2 * blockSize, MAX_DATA_BLOCK_SIZE);
     }
 
-    if (!data.isEmpty()) {
-        emit dataReceived(data);
+    data.resize((qsizetype)receivedBytes);
+
+    return data;
+}
+
+QByteArray & TReceiver::pooledBuffer(size_t len)
+{
+    for (int i = 0; i < m_bufferPool.size(); i++) {
+        if (m_bufferPool[i].isDetached()) {
+            // the storage of an exceptionally large read is not kept
+            if ((size_t)m_bufferPool[i].capacity() > std::max<size_t>(len, MAX_DATA_BLOCK_SIZE)) {
+                m_bufferPool[i] = QByteArray((qsizetype)len, Qt::Uninitialized);
+            } else {
+                m_bufferPool[i].resize((qsizetype)len);
+            }
+            return m_bufferPool[i];
+        }
     }
+
+    if (m_bufferPool.size() < BUFFER_POOL_SIZE) {
+        m_bufferPool.append(QByteArray((qsizetype)len, Qt::Uninitialized));
+        return m_bufferPool.last();
+    }
+
+    // all the buffers are still held by the receivers of the data, the next one is left to them
+    QByteArray & buffer = m_bufferPool[m_nextBuffer];
+    m_nextBuffer = (m_nextBuffer + 1) % BUFFER_POOL_SIZE;
+
+    buffer = QByteArray((qsizetype)len, Qt::Uninitialized);
+    return buffer;
 }
 
 void TReceiver::startReceiving()
@@ -69,19 +111,48 @@ void TReceiver::startReceiving()
     m_isBusy = true;
     m_stopReceiving = false;
 
-    quint8 buffer[DATA_BLOCK_SIZE];
+    size_t blockSize = DATA_BLOCK_SIZE;
+    unsigned long delay = 1;
 
     while (!m_stopReceiving) {
-        size_t newBytes = readData(buffer, DATA_BLOCK_SIZE);
+        // the read is sized by the available data, when known, otherwise the block adapts to the amount of incoming data
+        std::optional<size_t> available = availableBytes();
+        size_t bytesToReceive = available ? std::min<size_t>(*available, MAX_DATA_BLOCK_SIZE) : blockSize;
+        size_t bytesReceived = 0;
+
+        if (bytesToReceive > 0) {
+            QByteArray & data = pooledBuffer(bytesToReceive);
+            bytesReceived = readData(reinterpret_cast<uint8_t *>(data.data()), bytesToReceive);
+            data.resize((qsizetype)bytesReceived);
+
+            if (bytesReceived > 0) {
+                emit dataReceived(data);
+            }
+        }
 
-        QByteArray data((char*)buffer, newBytes);
+        if (!available) {
+            if (bytesReceived == bytesToReceive) {
+                blockSize = std::min<size_t>(2 * blockSize, MAX_DATA_BLOCK_SIZE);
+            } else if (bytesReceived < blockSize / 2) {
+                blockSize = std::max<size_t>(blockSize / 2, DATA_BLOCK_SIZE);
+            }
+        }
 
-        if (!data.isEmpty()) {
-            emit dataReceived(data);
+        // the next read follows right away while the data keep coming, otherwise the wait grows up to AUTORECEIVE_DELAY_MS
+        if (bytesReceived > 0) {
+            delay = 1;
+            continue;
         }
 
         QCoreApplication::processEvents(QEventLoop::ProcessEventsFlag::AllEvents);
-        thread()->msleep(AUTORECEIVE_DELAY_MS);
+
+        m_stopMutex.lock();
+        if (!m_stopReceiving) {
+            m_stopCondition.wait(&m_stopMutex, delay);
+        }
+        m_stopMutex.unlock();
+
+        delay = std::min<unsigned long>(2 * delay, AUTORECEIVE_DELAY_MS);
     }
 
     m_isBusy = false;
@@ -89,7 +160,11 @@ void TReceiver::startReceiving()
 
 void TReceiver::stopReceiving()
 {
+    // wakes the auto-receive loop up
+    m_stopMutex.lock();
     m_stopReceiving = true;
+    m_stopCondition.wakeAll();
+    m_stopMutex.unlock();
 }
 
 bool TReceiver::isBusy() {
@@ -97,5 +172,5 @@ bool TReceiver::isBusy() {
 }
 
 std::optional<size_t> TReceiver::availableBytes() {
-    return 0;
+    return std::nullopt;
 }
@@ -23,9 +23,16 @@
 #define TRECEIVER_H
 
 #include <QObject>
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
 
 #define DATA_BLOCK_SIZE 64
+#define MAX_DATA_BLOCK_SIZE (4 * 1024 * 1024)
 #define AUTORECEIVE_DELAY_MS 20
+#define BUFFER_POOL_SIZE 4
 
 class TReceiver : public QObject
 {
@@ -39,6 +46,7 @@ public:
 
     bool isBusy();
 
+    /// Returns number of bytes available for reading, when supported
     virtual std::optional<size_t> availableBytes();
 
 public slots:
@@ -48,10 +56,22 @@ public slots:
 
 protected:
     virtual size_t readData(uint8_t * buffer, size_t len) = 0;
+    /// Reads up to len bytes in blocks growing up to MAX_DATA_BLOCK_SIZE, stops at the first incomplete read;
+    /// receivers able to hand out larger blocks at once (the analytic streams) override it
+    virtual QByteArray readBlock(size_t len);
+
+    /// Returns a buffer of the given size from the pool; a buffer is reused once all the data emitted in it have been released
+    QByteArray & pooledBuffer(size_t len);
 
 private:
-    bool m_stopReceiving;
-    bool m_isBusy = false;
+    std::atomic<bool> m_stopReceiving;
+    std::atomic<bool> m_isBusy{false};
+
+    QMutex m_stopMutex;
+    QWaitCondition m_stopCondition;
+
+    QList<QByteArray> m_bufferPool;
+    int m_nextBuffer = 0;
 
 signals:
     void dataReceived(QByteArray data);
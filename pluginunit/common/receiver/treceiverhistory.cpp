@@ -0,0 +1,168 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#include "treceiverhistory.h"
+
+#include <algorithm>
+#include <cstring>
+
+TReceiverHistory::TReceiverHistory(TMode mode, size_t limit)
+    : m_mode(mode), m_limit(limit), m_ringStart(0), m_droppedBytes(0)
+{
+
+}
+
+TReceiverHistory::TMode TReceiverHistory::mode() const
+{
+    return m_mode;
+}
+
+size_t TReceiverHistory::limit() const
+{
+    return m_limit;
+}
+
+size_t TReceiverHistory::droppedBytes() const
+{
+    return m_droppedBytes;
+}
+
+void TReceiverHistory::setMode(TMode mode, size_t limit)
+{
+    clear();
+    m_mode = mode;
+    m_limit = limit;
+}
+
+void TReceiverHistory::append(const QByteArray & data)
+{
+    if (m_mode == TMode::TDisabled || data.isEmpty()) {
+        return;
+    }
+
+    if (m_mode == TMode::TFile) {
+        if (!m_file) {
+            m_file.reset(new QTemporaryFile());
+            if (!m_file->open()) {
+                qWarning("Failed to create a temporary file for the received data, the history is turned off.");
+                m_file.reset();
+                m_mode = TMode::TDisabled;
+                return;
+            }
+        }
+
+        qint64 written = m_file->write(data);
+        if (written != data.size()) {
+            qWarning("Failed to write the received data into the temporary file.");
+            m_droppedBytes += (size_t)(data.size() - std::max(written, (qint64)0));
+        }
+
+        return;
+    }
+
+    const size_t length = (size_t)data.size();
+
+    if (m_limit == 0) {
+        m_droppedBytes += length;
+        return;
+    }
+
+    if (length >= m_limit) {
+        m_droppedBytes += (size_t)m_ring.size() + length - m_limit;
+        m_ring = data.right((qsizetype)m_limit);
+        m_ringStart = 0;
+        return;
+    }
+
+    // the ring grows up to the limit first, then the oldest data are overwritten
+    size_t offset = 0;
+
+    if ((size_t)m_ring.size() < m_limit) {
+        offset = std::min(length, m_limit - (size_t)m_ring.size());
+        m_ring.append(data.constData(), (qsizetype)offset);
+    }
+
+    m_droppedBytes += length - offset;
+
+    while (offset < length) {
+        size_t chunk = std::min(length - offset, m_limit - m_ringStart);
+        std::memcpy(m_ring.data() + m_ringStart, data.constData() + offset, chunk);
+        m_ringStart = (m_ringStart + chunk) % m_limit;
+        offset += chunk;
+    }
+}
+
+void TReceiverHistory::clear()
+{
+    m_ring.clear();
+    m_ringStart = 0;
+    m_droppedBytes = 0;
+    m_file.reset();
+}
+
+size_t TReceiverHistory::size() const
+{
+    if (m_file) {
+        return (size_t)m_file->size();
+    }
+
+    return (size_t)m_ring.size();
+}
+
+QByteArray TReceiverHistory::data() const
+{
+    if (m_file) {
+        m_file->flush();
+        QByteArray data(m_file->size(), Qt::Uninitialized);
+        m_file->seek(0);
+        data.resize(m_file->read(data.data(), data.size()));
+        m_file->seek(m_file->size());
+        return data;
+    }
+
+    if (m_ringStart == 0) {
+        return m_ring;
+    }
+
+    return m_ring.mid((qsizetype)m_ringStart) + m_ring.left((qsizetype)m_ringStart);
+}
+
+bool TReceiverHistory::writeTo(QIODevice * device) const
+{
+    if (!m_file) {
+        QByteArray history = data();
+        return device->write(history) == history.size();
+    }
+
+    // the file is copied in blocks
+    QByteArray block(HISTORY_BLOCK_SIZE, Qt::Uninitialized);
+    bool ok = true;
+
+    m_file->flush();
+    m_file->seek(0);
+
+    while (ok && !m_file->atEnd()) {
+        qint64 length = m_file->read(block.data(), block.size());
+        ok = length > 0 && device->write(block.constData(), length) == length;
+    }
+
+    m_file->seek(m_file->size());
+
+    return ok;
+}
@@ -0,0 +1,73 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TRECEIVERHISTORY_H
+#define TRECEIVERHISTORY_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QTemporaryFile>
+#include <memory>
+
+#define HISTORY_LIMIT (64 * 1024 * 1024)
+#define HISTORY_BLOCK_SIZE (4 * 1024 * 1024)
+
+/// History of the data received by a receiver. The history is either off, bounded to the last bytes received
+/// (a ring in the memory), or appended to a temporary file and read back sequentially, so long runs do not
+/// exhaust the memory. The bytes the ring overwrites are counted, so a truncated history can be told apart.
+class TReceiverHistory
+{
+public:
+    enum class TMode {
+        TDisabled,
+        TLastBytes,
+        TFile
+    };
+
+    explicit TReceiverHistory(TMode mode = TMode::TLastBytes, size_t limit = HISTORY_LIMIT);
+
+    TMode mode() const;
+    /// Number of the last bytes kept in the TLastBytes mode
+    size_t limit() const;
+    /// Number of the bytes received but no longer kept, since the history was last cleared
+    size_t droppedBytes() const;
+    /// Changes the retention policy, the current history is dropped
+    void setMode(TMode mode, size_t limit = HISTORY_LIMIT);
+
+    void append(const QByteArray & data);
+    void clear();
+
+    size_t size() const;
+    /// Returns the whole history, in the TFile mode it is read back from the file
+    QByteArray data() const;
+    /// Writes the history into the device without holding all of it in the memory
+    bool writeTo(QIODevice * device) const;
+
+private:
+    TMode m_mode;
+    size_t m_limit;
+
+    QByteArray m_ring;
+    size_t m_ringStart; // the oldest byte once the ring is full
+    size_t m_droppedBytes;
+
+    std::unique_ptr<QTemporaryFile> m_file;
+};
+
+#endif // TRECEIVERHISTORY_H
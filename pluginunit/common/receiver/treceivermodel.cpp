@@ -84,7 +84,7 @@ void TReceiverModel::disableAutoRead()
 
 void TReceiverModel::dataReceived(QByteArray data)
 {
-    m_receivedData.append(data);
+    m_history.append(data);
     emit dataRead(data);
     m_receiving = m_autoReceive;
 }
@@ -107,10 +107,35 @@ std::optional<size_t> TReceiverModel::availableBytes()
 
 QByteArray TReceiverModel::receivedData() const
 {
-    return m_receivedData;
+    return m_history.data();
+}
+
+bool TReceiverModel::writeReceivedData(QIODevice * device) const
+{
+    return m_history.writeTo(device);
+}
+
+TReceiverHistory::TMode TReceiverModel::historyMode() const
+{
+    return m_history.mode();
+}
+
+void TReceiverModel::setHistoryMode(TReceiverHistory::TMode mode, size_t limit)
+{
+    m_history.setMode(mode, limit);
+}
+
+size_t TReceiverModel::historyLimit() const
+{
+    return m_history.limit();
+}
+
+size_t TReceiverModel::droppedReceivedBytes() const
+{
+    return m_history.droppedBytes();
 }
 
 void TReceiverModel::clearReceivedData()
 {
-    m_receivedData.clear();
+    m_history.clear();
 }
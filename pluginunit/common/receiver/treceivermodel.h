@@ -25,6 +25,7 @@
 #include <QThread>
 
 #include "treceiver.h"
+#include "treceiverhistory.h"
 
 class TReceiverModel : public QObject
 {
@@ -42,6 +43,15 @@ public:
     std::optional<size_t> availableBytes();
 
     QByteArray receivedData() const;
+    /// Writes the received data into the device, the history kept in a file is copied in blocks
+    bool writeReceivedData(QIODevice * device) const;
+
+    /// Retention policy of the received data, the callers that only need the dataRead signal may turn the history off
+    TReceiverHistory::TMode historyMode() const;
+    void setHistoryMode(TReceiverHistory::TMode mode, size_t limit = HISTORY_LIMIT);
+    size_t historyLimit() const;
+    /// Number of the received bytes the history no longer keeps, e.g. over its limit
+    size_t droppedReceivedBytes() const;
 
 public slots:
     void readData(int length);
@@ -66,7 +76,7 @@ private:
     bool m_receiving;
     bool m_autoReceive;
 
-    QByteArray m_receivedData;
+    TReceiverHistory m_history;
 
 signals:
     void receiveData(int length);
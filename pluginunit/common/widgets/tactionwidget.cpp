@@ -34,9 +34,18 @@ TActionWidget::TActionWidget(TAnalActionModel * actionModel, QWidget * parent)
     m_abortButton->setEnabled(false);
     connect(m_abortButton, &QPushButton::clicked, this, &TActionWidget::abortAction);
 
+    // the progress is shown only for the actions that report it
+    m_progressBar = new QProgressBar;
+    m_progressBar->setVisible(false);
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(PROGRESS_INTERVAL);
+    connect(m_progressTimer, &QTimer::timeout, this, &TActionWidget::updateProgress);
+
     QHBoxLayout * layout = new QHBoxLayout;
     layout->addWidget(m_runButton);
     layout->addWidget(m_abortButton);
+    layout->addWidget(m_progressBar);
 
     setLayout(layout);
 }
@@ -44,14 +53,18 @@ TActionWidget::TActionWidget(TAnalActionModel * actionModel, QWidget * parent)
 void TActionWidget::actionStarted(TAnalActionModel * actionModel)
 {
     m_runButton->setEnabled(false);
-    if (actionModel == m_actionModel)
+    if (actionModel == m_actionModel) {
         m_abortButton->setEnabled(true);
+        m_progressTimer->start();
+    }
 }
 
 void TActionWidget::actionFinished()
 {
     m_runButton->setEnabled(m_actionModel->isEnabled());
     m_abortButton->setEnabled(false);
+    m_progressTimer->stop();
+    m_progressBar->setVisible(false);
 }
 
 void TActionWidget::runAction()
@@ -63,3 +76,19 @@ void TActionWidget::abortAction()
 {
     emit m_actionModel->abort();
 }
+
+void TActionWidget::updateProgress()
+{
+    std::pair<size_t, size_t> progress = m_actionModel->progress();
+
+    if (progress.second == 0) {
+        m_progressBar->setVisible(false);
+        return;
+    }
+
+    // the bar works with percents, the number of work items may exceed its int range
+    m_progressBar->setRange(0, 100);
+    m_progressBar->setValue(static_cast<int>(std::min<size_t>(progress.first, progress.second) * 100 / progress.second));
+    m_progressBar->setFormat(QString("%1 / %2").arg(progress.first).arg(progress.second));
+    m_progressBar->setVisible(true);
+}
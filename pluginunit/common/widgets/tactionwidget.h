@@ -21,6 +21,8 @@
 #define TACTIONWIDGET_H
 
 #include <QPushButton>
+#include <QProgressBar>
+#include <QTimer>
 
 #include "../../anal/action/tanalactionmodel.h"
 
@@ -38,12 +40,18 @@ public slots:
 private slots:
     void runAction();
     void abortAction();
+    void updateProgress();
 
 private:
+    /// Refresh interval of the progress, in milliseconds
+    static const int PROGRESS_INTERVAL = 250;
+
     TAnalActionModel * m_actionModel;
 
     QPushButton * m_runButton;
     QPushButton * m_abortButton;
+    QProgressBar * m_progressBar;
+    QTimer * m_progressTimer;
 };
 
 #endif // TACTIONWIDGET_H
@@ -27,6 +27,9 @@
 #include <QFormLayout>
 #include <QGroupBox>
 #include <QLabel>
+#include <QSpinBox>
+#include <climits>
+#include <algorithm>
 
 #include "../protocol/tprotocolmodel.h"
 #include "widgets/tfilenameedit.h"
@@ -68,7 +71,32 @@ TReceiverWidget::TReceiverWidget(TReceiverModel * receiverModel, TProtocolContai
 
     QGroupBox * receiveFileGroupBox = new QGroupBox("Save current stream to file (raw)");
 
-    QLayout * receiveFileLayout = new QVBoxLayout();
+    QVBoxLayout * receiveFileLayout = new QVBoxLayout();
+
+    QComboBox * historyComboBox = new QComboBox;
+    historyComboBox->addItem(tr("Last bytes (memory)"), QVariant::fromValue((int)TReceiverHistory::TMode::TLastBytes));
+    historyComboBox->addItem(tr("All (temporary file)"), QVariant::fromValue((int)TReceiverHistory::TMode::TFile));
+    historyComboBox->addItem(tr("None"), QVariant::fromValue((int)TReceiverHistory::TMode::TDisabled));
+    historyComboBox->setCurrentIndex(historyComboBox->findData((int)m_receiverModel->historyMode()));
+
+    QSpinBox * historyLimitSpinBox = new QSpinBox;
+    historyLimitSpinBox->setRange(1, INT_MAX);
+    historyLimitSpinBox->setSuffix(" MB");
+    historyLimitSpinBox->setValue((int)std::max(m_receiverModel->historyLimit() / (1024 * 1024), (size_t)1));
+    historyLimitSpinBox->setEnabled(m_receiverModel->historyMode() == TReceiverHistory::TMode::TLastBytes);
+
+    // changing the policy or the limit drops the current history
+    auto applyHistoryMode = [=](){
+        TReceiverHistory::TMode mode = (TReceiverHistory::TMode)historyComboBox->currentData().toInt();
+        historyLimitSpinBox->setEnabled(mode == TReceiverHistory::TMode::TLastBytes);
+        m_receiverModel->setHistoryMode(mode, (size_t)historyLimitSpinBox->value() * 1024 * 1024);
+    };
+    connect(historyComboBox, &QComboBox::currentIndexChanged, this, applyHistoryMode);
+    connect(historyLimitSpinBox, &QSpinBox::editingFinished, this, applyHistoryMode);
+
+    QFormLayout * historyLayout = new QFormLayout;
+    historyLayout->addRow(tr("Keep received data"), historyComboBox);
+    historyLayout->addRow(tr("Memory limit"), historyLimitSpinBox);
 
     TFileNameEdit * receiveFileEdit = new TFileNameEdit(QFileDialog::AnyFile);
     QPushButton * receiveFileButton = new QPushButton("Save received data to file");
@@ -76,6 +104,7 @@ TReceiverWidget::TReceiverWidget(TReceiverModel * receiverModel, TProtocolContai
     connect(receiveFileButton, &QPushButton::clicked, this, [=](){ receiveFile(receiveFileEdit->text()); });
     connect(exportFileButton, &QPushButton::clicked, this, [=](){ exportFile(); });
     
+    receiveFileLayout->addLayout(historyLayout);
     receiveFileLayout->addWidget(receiveFileEdit);
     receiveFileLayout->addWidget(receiveFileButton);
     receiveFileLayout->addWidget(exportFileButton);
@@ -136,15 +165,30 @@ void TReceiverWidget::receiveFile(QString fileName)
         return;
     }
 
-    file.write(m_receiverModel->receivedData());
+    warnDroppedData();
+
+    if (!m_receiverModel->writeReceivedData(&file)) {
+        qWarning("Failed to save the received data to file.");
+    }
 
     file.close();
 }
 
+void TReceiverWidget::warnDroppedData()
+{
+    size_t droppedBytes = m_receiverModel->droppedReceivedBytes();
+
+    if (droppedBytes) {
+        qWarning("The history does not keep all the received data, the oldest %zu bytes are not included.", droppedBytes);
+    }
+}
+
 void TReceiverWidget::exportFile()
 {
     qDebug() << "Exporting to HDF";
 
+    warnDroppedData();
+
     auto *wiz = new TExportHDFDataWizard(this);
     wiz->setWindowTitle(tr("Export data to HDF5"));
     wiz->setData(m_receiverModel->receivedData());
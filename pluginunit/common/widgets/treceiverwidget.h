@@ -52,6 +52,9 @@ private slots:
     void protocolChanged(int index);
 
 private:
+    /// Warns that the saved or exported data miss the bytes the history dropped
+    void warnDroppedData();
+
     TReceiverModel * m_receiverModel;
 
     TProtocolContainer * m_protocolContainer;
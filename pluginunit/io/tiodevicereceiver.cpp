@@ -29,3 +29,8 @@ size_t TIODeviceReceiver::readData(uint8_t * buffer, size_t len)
 {
     return m_IODevice->readData(buffer, len);
 }
+
+std::optional<size_t> TIODeviceReceiver::availableBytes()
+{
+    return m_IODevice->availableBytes();
+}
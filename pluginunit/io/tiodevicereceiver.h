@@ -33,6 +33,7 @@ public:
 
 protected:
     size_t readData(uint8_t * buffer, size_t len) override;
+    std::optional<size_t> availableBytes() override;
 
 private:
     TIODevice * m_IODevice;
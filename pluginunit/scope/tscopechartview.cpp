@@ -0,0 +1,74 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#include "tscopechartview.h"
+
+#include <QWheelEvent>
+#include <QMouseEvent>
+
+TScopeChartView::TScopeChartView(QChart * chart, QWidget * parent) : QChartView(chart, parent)
+{
+    setRubberBand(QChartView::HorizontalRubberBand);
+}
+
+void TScopeChartView::wheelEvent(QWheelEvent * event)
+{
+    int angle = event->angleDelta().y() ? event->angleDelta().y() : event->angleDelta().x();
+
+    if (!angle) {
+        event->ignore();
+        return;
+    }
+
+    if (event->modifiers() & Qt::ShiftModifier || !event->angleDelta().y()) {
+        emit panRequested(angle > 0 ? -PAN_STEP : PAN_STEP);
+    }
+    else {
+        QRectF plotArea = chart()->plotArea();
+        QPointF position = chart()->mapFromScene(mapToScene(event->position().toPoint()));
+        qreal anchor = plotArea.width() > 0 ? (position.x() - plotArea.left()) / plotArea.width() : 0.5;
+
+        emit zoomRequested(angle > 0 ? ZOOM_IN : ZOOM_OUT, qBound(0.0, anchor, 1.0));
+    }
+
+    event->accept();
+}
+
+void TScopeChartView::mouseDoubleClickEvent(QMouseEvent * event)
+{
+    if (event->button() == Qt::LeftButton) {
+        emit zoomResetRequested();
+        event->accept();
+        return;
+    }
+
+    QChartView::mouseDoubleClickEvent(event);
+}
+
+void TScopeChartView::mouseReleaseEvent(QMouseEvent * event)
+{
+    // the default zoom out would scale the vertical axis too
+    if (event->button() == Qt::RightButton) {
+        emit zoomRequested(ZOOM_OUT * ZOOM_OUT, 0.5);
+        event->accept();
+        return;
+    }
+
+    QChartView::mouseReleaseEvent(event);
+}
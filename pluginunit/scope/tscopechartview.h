@@ -0,0 +1,52 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TSCOPECHARTVIEW_H
+#define TSCOPECHARTVIEW_H
+
+#include <QtCharts/QChartView>
+
+/// Chart view of the scope widget. The mouse wheel zooms the horizontal axis around the cursor, the wheel with Shift
+/// pans it, dragging selects the range to zoom into, the right click zooms out and a double click resets the zoom.
+class TScopeChartView : public QChartView {
+
+    Q_OBJECT
+
+public:
+    explicit TScopeChartView(QChart * chart, QWidget * parent = nullptr);
+
+signals:
+    /// The visible range is to be scaled by the factor, the anchor is the fraction of the plot width that stays put
+    void zoomRequested(qreal factor, qreal anchor);
+    /// The visible range is to be moved by the fraction of its width
+    void panRequested(qreal fraction);
+    void zoomResetRequested();
+
+protected:
+    void wheelEvent(QWheelEvent * event) override;
+    void mouseDoubleClickEvent(QMouseEvent * event) override;
+    void mouseReleaseEvent(QMouseEvent * event) override;
+
+private:
+    const qreal ZOOM_IN = 0.8f;
+    const qreal ZOOM_OUT = 1.25f;
+    const qreal PAN_STEP = 0.1f;
+};
+
+#endif // TSCOPECHARTVIEW_H
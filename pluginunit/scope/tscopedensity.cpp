@@ -0,0 +1,181 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#include "tscopedensity.h"
+
+#include <QMutexLocker>
+#include <algorithm>
+#include <cmath>
+
+TScopeDensityWorker::TScopeDensityWorker(QObject * parent)
+    : QObject(parent), m_generation(0), m_samples(0), m_columns(0), m_minVoltage(0), m_maxVoltage(0), m_traces(0)
+{
+
+}
+
+quint64 TScopeDensityWorker::reset(size_t samples, qreal minVoltage, qreal maxVoltage, const QList<TChannel> & channels)
+{
+    // the batch being accumulated checks the generation only when it starts
+    quint64 generation = ++m_generation;
+
+    QMutexLocker locker(&m_mutex);
+
+    m_samples = samples;
+    m_columns = std::min(samples, (size_t)DENSITY_COLUMNS);
+    m_minVoltage = minVoltage;
+    m_maxVoltage = maxVoltage;
+    m_channels = channels;
+    m_traces = 0;
+
+    m_histograms.clear();
+    for (int i = 0; i < m_channels.count(); i++) {
+        m_histograms.append(QVector<quint32>(m_columns * DENSITY_ROWS, 0));
+    }
+
+    return generation;
+}
+
+void TScopeDensityWorker::accumulate(quint64 generation, size_t firstTrace, size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers)
+{
+    QImage image;
+    size_t accumulatedTraces;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (generation != m_generation) {
+            return;
+        }
+
+        if (samples == m_samples && m_columns && m_maxVoltage > m_minVoltage) {
+            bool accumulated = false;
+
+            for (int i = 0; i < m_channels.count(); i++) {
+                const TChannel & channel = m_channels[i];
+
+                if (channel.bufferIndex >= buffers.count()) {
+                    continue;
+                }
+
+                const QByteArray & buffer = buffers[channel.bufferIndex];
+
+                switch (type) {
+                case TScope::TSampleType::TUInt8:
+                    accumulated |= accumulateChannel<uint8_t>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TInt8:
+                    accumulated |= accumulateChannel<int8_t>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TUInt16:
+                    accumulated |= accumulateChannel<uint16_t>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TInt16:
+                    accumulated |= accumulateChannel<int16_t>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TUInt32:
+                    accumulated |= accumulateChannel<uint32_t>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TInt32:
+                    accumulated |= accumulateChannel<int32_t>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TReal32:
+                    accumulated |= accumulateChannel<float>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                case TScope::TSampleType::TReal64:
+                    accumulated |= accumulateChannel<double>(m_histograms[i], buffer, firstTrace, traces, channel); break;
+                }
+            }
+
+            if (accumulated) {
+                m_traces += traces;
+            }
+        }
+
+        accumulatedTraces = m_traces;
+        image = render();
+    }
+
+    emit imageUpdated(generation, image, accumulatedTraces);
+}
+
+template <class T>
+bool TScopeDensityWorker::accumulateChannel(QVector<quint32> & histogram, const QByteArray & buffer, size_t firstTrace, size_t traces, const TChannel & channel)
+{
+    if ((size_t)buffer.size() < (firstTrace + traces) * m_samples * sizeof(T)) {
+        return false;
+    }
+
+    const T * data = (const T *)buffer.constData() + firstTrace * m_samples;
+
+    // the row of every sample value is its voltage scaled to the rows, the top row is the highest voltage
+    qreal rowScale = DENSITY_ROWS / (m_maxVoltage - m_minVoltage);
+    qreal rowSlope = channel.slope * rowScale;
+    qreal rowOffset = (channel.offset - m_minVoltage) * rowScale;
+
+    for (size_t trace = 0; trace < traces; trace++) {
+        const T * samples = data + trace * m_samples;
+
+        for (size_t i = 0; i < m_samples; i++) {
+            qreal row = rowSlope * samples[i] + rowOffset;
+
+            if (!(row >= 0 && row < DENSITY_ROWS)) {
+                continue;
+            }
+
+            size_t column = i * m_columns / m_samples;
+            histogram[(DENSITY_ROWS - 1 - (size_t)row) * m_columns + column]++;
+        }
+    }
+
+    return true;
+}
+
+QImage TScopeDensityWorker::render() const
+{
+    QImage image((int)m_columns, DENSITY_ROWS, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    for (int i = 0; i < m_channels.count(); i++) {
+        const QVector<quint32> & histogram = m_histograms[i];
+
+        quint32 maxCount = *std::max_element(histogram.cbegin(), histogram.cend());
+        if (!maxCount) {
+            continue;
+        }
+
+        // logarithmic scale, so the rare outliers stay visible next to the dense areas
+        qreal scale = 1.0 / std::log1p((qreal)maxCount);
+        QColor color = m_channels[i].color;
+
+        for (int row = 0; row < DENSITY_ROWS; row++) {
+            QRgb * line = (QRgb *)image.scanLine(row);
+            const quint32 * counts = histogram.constData() + row * m_columns;
+
+            for (size_t column = 0; column < m_columns; column++) {
+                if (!counts[column]) {
+                    continue;
+                }
+
+                qreal intensity = 0.2 + 0.8 * std::log1p((qreal)counts[column]) * scale;
+
+                // the channels are blended additively
+                QRgb pixel = line[column];
+                line[column] = qRgba(std::min(255, qRed(pixel) + (int)(color.red() * intensity)),
+                                     std::min(255, qGreen(pixel) + (int)(color.green() * intensity)),
+                                     std::min(255, qBlue(pixel) + (int)(color.blue() * intensity)),
+                                     std::min(255, qAlpha(pixel) + (int)(255 * intensity)));
+            }
+        }
+    }
+
+    return image;
+}
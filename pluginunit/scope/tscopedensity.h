@@ -0,0 +1,83 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TSCOPEDENSITY_H
+#define TSCOPEDENSITY_H
+
+#include <QObject>
+#include <QImage>
+#include <QColor>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+
+#include "tscope.h"
+
+#define DENSITY_COLUMNS 1024
+#define DENSITY_ROWS 256
+
+/// Accumulates the traces into a 2D histogram (time x voltage) per channel and renders it as a single image,
+/// so the cost of drawing does not depend on the number of the overlaid traces. Lives in a worker thread.
+class TScopeDensityWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct TChannel {
+        int bufferIndex; // of the channel in the buffers of a batch
+        qreal slope; // maps the sample value to the voltage
+        qreal offset;
+        QColor color;
+    };
+
+    explicit TScopeDensityWorker(QObject * parent = nullptr);
+
+    /// Drops the histogram and sets up a new one, the batches queued before are skipped. Waits for the batch
+    /// being accumulated, so the data of the batches queued before may be released afterwards (thread-safe).
+    quint64 reset(size_t samples, qreal minVoltage, qreal maxVoltage, const QList<TChannel> & channels);
+
+public slots:
+    /// Accumulates the traces from firstTrace on within the batch. Every batch of the current generation is answered
+    /// by imageUpdated, even the one that does not match the histogram, so the batches can be fed one at a time
+    void accumulate(quint64 generation, size_t firstTrace, size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers);
+
+signals:
+    void imageUpdated(quint64 generation, QImage image, size_t traces);
+
+private:
+    /// Returns false when the buffer is too short for the traces
+    template <class T>
+    bool accumulateChannel(QVector<quint32> & histogram, const QByteArray & buffer, size_t firstTrace, size_t traces, const TChannel & channel);
+
+    QImage render() const;
+
+    QMutex m_mutex;
+    std::atomic<quint64> m_generation;
+
+    size_t m_samples;
+    size_t m_columns;
+    qreal m_minVoltage;
+    qreal m_maxVoltage;
+    QList<TChannel> m_channels;
+
+    QList<QVector<quint32>> m_histograms;
+    size_t m_traces;
+};
+
+#endif // TSCOPEDENSITY_H
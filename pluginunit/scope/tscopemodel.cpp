@@ -25,7 +25,7 @@
 #include "../component/tcomponentmodel.h"
 
 TScopeModel::TScopeModel(TScope * scope, TScopeContainer * parent, bool manual)
-    : TProjectItem(parent->model(), parent), TDeviceModel(scope, parent, manual), m_scope(scope)
+    : TProjectItem(parent->model(), parent), TDeviceModel(scope, parent, manual), m_scope(scope), m_pipelined(false), m_pipelining(false), m_batchHeld(false), m_heldBatches(0), m_collector(nullptr)
 {
     m_typeName = "scope";
 }
@@ -52,6 +52,8 @@ bool TScopeModel::init()
 
     m_repeat = false;
     m_stopping = false;
+    m_pipelining = false;
+    m_heldBatches = 0;
 
     if (collectorThread.isRunning())
         collectorThread.terminate();
@@ -60,10 +62,11 @@ bool TScopeModel::init()
     m_collector->moveToThread(&collectorThread);
 
     connect(this, &TScopeModel::startDataCollection, m_collector, &TScopeCollector::collectData, Qt::ConnectionType::QueuedConnection);
+    connect(this, &TScopeModel::startPipelinedDataCollection, m_collector, &TScopeCollector::collectDataPipelined, Qt::ConnectionType::QueuedConnection);
     connect(m_collector, &TScopeCollector::dataCollected, this, &TScopeModel::dataCollected, Qt::ConnectionType::QueuedConnection);
     connect(m_collector, &TScopeCollector::collectionStopped, this, &TScopeModel::dataCollectionStopped, Qt::ConnectionType::QueuedConnection);
     connect(m_collector, &TScopeCollector::nothingCollected, this, &TScopeModel::noDataCollected, Qt::ConnectionType::QueuedConnection);
-    connect(&collectorThread, &QThread::finished, m_collector, &QObject::deleteLater);
+    connect(m_collector, &TScopeCollector::rearmFailed, this, &TScopeModel::dataCollectionRearmFailed, Qt::ConnectionType::QueuedConnection);
 
     collectorThread.start();
 
@@ -75,13 +78,27 @@ bool TScopeModel::init()
 
 bool TScopeModel::deInit()
 {
-    if (!isInit() || !TPluginUnitModel::deInit()) {
+    if (!isInit()) {
         return false;
     }
 
+    // the collector may still wait for the scope, stopping it ends the download
+    bool ok;
+    m_stopping = true;
+    m_heldBatches = 0;
+    m_collector->halt();
+    m_scope->stop(&ok);
+
     collectorThread.quit();
+    collectorThread.wait();
+
+    if (!TPluginUnitModel::deInit()) {
+        collectorThread.start();
+        return false;
+    }
 
     delete m_collector;
+    m_collector = nullptr;
 
     m_isInit = false;
 
@@ -134,6 +151,31 @@ TScope::TTimingStatus TScopeModel::timingStatus() {
     return m_scope->getTimingStatus();
 }
 
+bool TScopeModel::isPipelined() const
+{
+    return m_pipelined;
+}
+
+void TScopeModel::setPipelined(bool pipelined)
+{
+    m_pipelined = pipelined;
+}
+
+void TScopeModel::holdBatch()
+{
+    m_batchHeld = true;
+}
+
+void TScopeModel::releaseBatch()
+{
+    // the batches held before a stop are not waited for
+    if (!m_heldBatches)
+        return;
+
+    m_heldBatches--;
+    batchDone();
+}
+
 void TScopeModel::run()
 {
     run(true);
@@ -148,6 +190,11 @@ void TScopeModel::stop()
 {
     bool ok;
     m_stopping = true;
+    m_heldBatches = 0;
+
+    // the collector must not re-arm the scope after it is stopped
+    if (m_collector)
+        m_collector->halt();
 
     m_scope->stop(&ok);
 
@@ -162,8 +209,33 @@ void TScopeModel::stop()
 
 void TScopeModel::dataCollected(size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers, bool overvoltage)
 {
+    // a batch queued before the deinitialization arrives after the collector is gone
+    if (!m_collector)
+        return;
+
+    m_batchHeld = false;
+
     emit tracesDownloaded(traces, samples, type, buffers, overvoltage);
 
+    if (m_batchHeld) {
+        m_heldBatches++;
+        return;
+    }
+
+    batchDone();
+}
+
+void TScopeModel::batchDone()
+{
+    if (!m_collector)
+        return;
+
+    m_collector->batchHandled();
+
+    // the pipelined collection re-arms the scope on its own
+    if (m_pipelining)
+        return;
+
     if (m_repeat && !m_stopping) { // discuss addition of !m_stopping
         run(m_repeat);
     }
@@ -184,6 +256,13 @@ void TScopeModel::noDataCollected()
     emit tracesEmpty();
 }
 
+void TScopeModel::dataCollectionRearmFailed()
+{
+    if (!m_stopping) {
+        emit runFailed();
+    }
+}
+
 void TScopeModel::run(bool repeat)
 {
     size_t bufferSize;
@@ -191,6 +270,7 @@ void TScopeModel::run(bool repeat)
 
     m_repeat = repeat;
     m_stopping = false;
+    m_pipelining = repeat && m_pipelined;
 
     m_scope->run(&bufferSize, &ok);
 
@@ -199,25 +279,46 @@ void TScopeModel::run(bool repeat)
         return;
     }
 
-    emit startDataCollection(bufferSize);
+    if (m_pipelining) {
+        emit startPipelinedDataCollection(bufferSize);
+    }
+    else {
+        emit startDataCollection(bufferSize);
+    }
 }
 
 TScopeCollector::TScopeCollector(TScope * scope, QObject * parent)
-    : QObject(parent), m_scope(scope)
+    : QObject(parent), m_scope(scope), m_generation(0), m_pending(0)
 {
 
 }
 
-void TScopeCollector::collectData(size_t bufferSize)
+void TScopeCollector::halt()
+{
+    QMutexLocker locker(&m_mutex);
+    m_generation++;
+    m_queueNotFull.wakeAll();
+}
+
+void TScopeCollector::batchHandled()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_pending > 0)
+        m_pending--;
+
+    m_queueNotFull.wakeAll();
+}
+
+bool TScopeCollector::downloadBatch(size_t bufferSize, TBatch & batch)
 {
     QList<TScope::TChannelStatus> status = m_scope->getChannelsStatus();
 
-    QList<QByteArray> buffers;
-    TScope::TSampleType type;
-    size_t samplesPerTrace;
-    size_t traces;
-    bool overload = false;
-    int channels = 0;
+    batch.traces = 0;
+    batch.samples = 0;
+    batch.overvoltage = false;
+    batch.channels = 0;
+    batch.buffers.clear();
 
     for (int i = 0; i < status.count(); i++) {
         QByteArray buffer;
@@ -226,28 +327,97 @@ void TScopeCollector::collectData(size_t bufferSize)
             bool overloadSingle;
 
             buffer.resize(bufferSize);
-            qsizetype actualSize = m_scope->downloadSamples(status[i].getIndex(), (uint8_t *)buffer.data(), bufferSize, &type, &samplesPerTrace, &traces, &overloadSingle);
+            qsizetype actualSize = m_scope->downloadSamples(status[i].getIndex(), (uint8_t *)buffer.data(), bufferSize, &batch.type, &batch.samples, &batch.traces, &overloadSingle);
 
             // resize and shrink the internal array
             buffer.resize(actualSize);
             buffer.squeeze();
 
-            if (!traces) {
-                emit collectionStopped();
-                return;
+            if (!batch.traces) {
+                return false;
             }
 
-            overload = overload || overloadSingle;
-            channels++;
+            batch.overvoltage = batch.overvoltage || overloadSingle;
+            batch.channels++;
         }
 
-        buffers.append(buffer);
+        batch.buffers.append(buffer);
     }
 
-    if (channels) {
-        emit dataCollected(traces, samplesPerTrace, type, buffers, overload);
+    return true;
+}
+
+void TScopeCollector::collectData(size_t bufferSize)
+{
+    TBatch batch;
+
+    if (!downloadBatch(bufferSize, batch)) {
+        emit collectionStopped();
+        return;
+    }
+
+    if (batch.channels) {
+        emit dataCollected(batch.traces, batch.samples, batch.type, batch.buffers, batch.overvoltage);
     }
     else {
         emit nothingCollected();
     }
 }
+
+void TScopeCollector::collectDataPipelined(size_t bufferSize)
+{
+    size_t generation;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        generation = m_generation;
+        m_pending = 0;
+    }
+
+    forever {
+        TBatch batch;
+
+        if (!downloadBatch(bufferSize, batch)) {
+            emit collectionStopped();
+            return;
+        }
+
+        if (!batch.channels) {
+            emit nothingCollected();
+            return;
+        }
+
+        QMutexLocker locker(&m_mutex);
+
+        if (generation != m_generation) {
+            locker.unlock();
+            emit dataCollected(batch.traces, batch.samples, batch.type, batch.buffers, batch.overvoltage);
+            return;
+        }
+
+        // the scope captures the next batch while this one is handed off
+        bool ok;
+        m_scope->run(&bufferSize, &ok);
+
+        if (!ok) {
+            locker.unlock();
+            emit dataCollected(batch.traces, batch.samples, batch.type, batch.buffers, batch.overvoltage);
+            emit rearmFailed();
+            return;
+        }
+
+        while (m_pending >= SCOPE_PIPELINE_DEPTH && generation == m_generation) {
+            m_queueNotFull.wait(&m_mutex);
+        }
+
+        m_pending++;
+        bool halted = generation != m_generation;
+        locker.unlock();
+
+        emit dataCollected(batch.traces, batch.samples, batch.type, batch.buffers, batch.overvoltage);
+
+        if (halted) {
+            return;
+        }
+    }
+}
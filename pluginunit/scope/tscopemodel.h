@@ -24,10 +24,14 @@
 
 #include <QObject>
 #include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
 
 #include "../common/tdevicemodel.h"
 #include "tscope.h"
 
+#define SCOPE_PIPELINE_DEPTH 2
+
 class TScopeCollector : public QObject
 {
     Q_OBJECT
@@ -35,16 +39,41 @@ class TScopeCollector : public QObject
 public:
     explicit TScopeCollector(TScope * scope, QObject * parent = nullptr);
 
+    /// Ends the pipelined collection, the scope is not re-armed once this returns (thread-safe)
+    void halt();
+    /// Frees a slot in the queue of the batches handed off by dataCollected (thread-safe)
+    void batchHandled();
+
 public slots:
     void collectData(size_t bufferSize);
+    /// Re-arms the scope right after each download and hands the batches off through a bounded queue, until halted
+    void collectDataPipelined(size_t bufferSize);
 
 signals:
     void dataCollected(size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers, bool overvoltage);
     void collectionStopped();
     void nothingCollected();
+    void rearmFailed();
 
 private:
+    struct TBatch {
+        size_t traces;
+        size_t samples;
+        TScope::TSampleType type;
+        QList<QByteArray> buffers;
+        bool overvoltage;
+        int channels;
+    };
+
+    /// Downloads all the enabled channels, returns false when the scope provided no traces
+    bool downloadBatch(size_t bufferSize, TBatch & batch);
+
     TScope * m_scope;
+
+    QMutex m_mutex;
+    QWaitCondition m_queueNotFull;
+    size_t m_generation;
+    size_t m_pending;
 };
 
 class TScopeContainer;
@@ -73,6 +102,13 @@ public:
     TScope::TTriggerStatus triggerStatus();
     TScope::TTimingStatus timingStatus();
 
+    /// In the pipelined mode, the repeated sampling re-arms the scope as soon as the download finishes
+    bool isPipelined() const;
+    void setPipelined(bool pipelined);
+
+    /// Called by a receiver of tracesDownloaded, the collection goes on past the batch only once it is released
+    void holdBatch();
+
 signals:
     void initialized(TScopeModel * scope);
     void deinitialized(TScopeModel * scope);
@@ -92,25 +128,36 @@ signals:
 
     // Internal signals
     void startDataCollection(size_t bufferSize);
+    void startPipelinedDataCollection(size_t bufferSize);
 
 public slots:
     void run();
     void runSingle();
     void stop();
+    /// Releases a held batch, the scope is re-armed or the pipelined collection goes on
+    void releaseBatch();
 
 private slots:
     void dataCollected(size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers, bool overvoltage);
 
     void dataCollectionStopped();
     void noDataCollected();
+    void dataCollectionRearmFailed();
 
 private:
     void run(bool repeat);
+    /// Lets the collection go on past the handled batch
+    void batchDone();
 
     TScope * m_scope;
 
     bool m_repeat;
     bool m_stopping;
+    bool m_pipelined;
+    bool m_pipelining;
+
+    bool m_batchHeld;
+    size_t m_heldBatches;
 
     friend class TScopeCollector;
 
@@ -0,0 +1,162 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#include "tscoperecorder.h"
+
+#include <QDateTime>
+#include <QMutexLocker>
+
+TScopeRecorder::TScopeRecorder(QSharedPointer<THdfSession> session, const QList<TTarget> & targets, QObject * parent)
+    : QObject(parent), m_session(session), m_targets(targets), m_pending(0), m_recordedTraces(0), m_failed(false)
+{
+    m_handles.resize(m_targets.count());
+    m_flushTimer.start();
+}
+
+TScopeRecorder::~TScopeRecorder()
+{
+    if (m_session) {
+        for (THdfSession::TraceAppendHandle & handle : m_handles) {
+            m_session->endAppendTraces(handle);
+        }
+    }
+
+    if (m_session && m_session->isOpen()) {
+        m_session->close();
+    }
+}
+
+void TScopeRecorder::reserveSlot()
+{
+    QMutexLocker locker(&m_mutex);
+    m_pending++;
+}
+
+void TScopeRecorder::waitForIdle()
+{
+    QMutexLocker locker(&m_mutex);
+
+    while (m_pending > 0) {
+        m_queueChanged.wait(&m_mutex);
+    }
+}
+
+size_t TScopeRecorder::recordedTraces() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_recordedTraces;
+}
+
+void TScopeRecorder::record(size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers)
+{
+    QString message;
+    bool ok = m_failed || write(traces, samples, type, buffers, message);
+
+    size_t recordedTraces;
+    bool failedNow = false;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (!ok && !m_failed) {
+            m_failed = true;
+            failedNow = true;
+        }
+
+        if (!m_failed) {
+            m_recordedTraces += traces;
+        }
+        recordedTraces = m_recordedTraces;
+
+        m_pending--;
+        m_queueChanged.wakeAll();
+    }
+
+    emit batchRecorded();
+
+    if (failedNow) {
+        emit recordingFailed(message);
+    }
+    else if (!m_failed) {
+        emit tracesRecorded(recordedTraces);
+    }
+}
+
+bool TScopeRecorder::write(size_t traces, size_t samples, TScope::TSampleType type, const QList<QByteArray> & buffers, QString & message)
+{
+    if (!m_session || !m_session->isOpen()) {
+        message = tr("The HDF5 file is not open.");
+        return false;
+    }
+
+    if (!traces || !samples) {
+        return true;
+    }
+
+    const QString timestamp = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    for (int i = 0; i < m_targets.count(); i++) {
+        const TTarget & target = m_targets[i];
+        THdfSession::TraceAppendHandle & handle = m_handles[i];
+
+        if (target.bufferIndex >= buffers.count() || buffers[target.bufferIndex].isEmpty()) {
+            message = tr("The recorded channel provided no data for: %1").arg(target.tracesDataset);
+            return false;
+        }
+
+        const QByteArray & buffer = buffers[target.bufferIndex];
+
+        // the dataset is opened by the first batch, the next ones only extend it
+        if (!handle.active) {
+            if (!m_session->beginAppendTraces(target.tracesDataset, samples, type, traces, handle)) {
+                message = tr("Failed to open the HDF dataset: %1").arg(target.tracesDataset);
+                return false;
+            }
+        }
+        else if (handle.cols != samples || handle.sampleType != type) {
+            message = tr("The format of the traces changed while recording into: %1").arg(target.tracesDataset);
+            return false;
+        }
+        else if (!m_session->extendAppendTraces(handle, traces)) {
+            message = tr("Failed to extend the HDF dataset: %1").arg(target.tracesDataset);
+            return false;
+        }
+
+        quint64 firstTrace = handle.nextRow;
+
+        // the whole buffer is written, a size that does not match the traces is refused by the session
+        if (!m_session->appendTraceRows(handle, buffer.constData(), traces, type, (size_t)buffer.size())) {
+            message = tr("Failed to append the traces into HDF file: %1").arg(target.tracesDataset);
+            return false;
+        }
+
+        if (!m_session->appendTracesMetadataRecord(target.metadataGroup, firstTrace, traces, timestamp, target.settings)) {
+            message = tr("Failed to append metadata to the HDF group: %1").arg(target.metadataGroup);
+            return false;
+        }
+    }
+
+    // the file stays consistent on the disk, should the recording be interrupted
+    if (m_flushTimer.elapsed() >= RECORDER_FLUSH_INTERVAL) {
+        H5Fflush(m_session->fileId(), H5F_SCOPE_LOCAL);
+        m_flushTimer.restart();
+    }
+
+    return true;
+}
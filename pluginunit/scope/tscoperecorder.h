@@ -0,0 +1,86 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TSCOPERECORDER_H
+#define TSCOPERECORDER_H
+
+#include <QObject>
+#include <QList>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+#include "tscope.h"
+#include "../../eximport/thdfsession.h"
+
+#define RECORDER_FLUSH_INTERVAL 1000
+
+/// Appends the captured batches to the HDF5 datasets while the acquisition goes on. Lives in a writer thread,
+/// the HDF5 session is used only by this thread while recording. The datasets stay open for the whole recording,
+/// every batch only extends them.
+class TScopeRecorder : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct TTarget {
+        int bufferIndex; // of the channel in the buffers of a batch
+        QString tracesDataset;
+        QString metadataGroup;
+        QString settings;
+    };
+
+    TScopeRecorder(QSharedPointer<THdfSession> session, const QList<TTarget> & targets, QObject * parent = nullptr);
+    ~TScopeRecorder();
+
+    /// Counts a batch queued to be written, before it is handed to record (thread-safe)
+    void reserveSlot();
+    /// Waits until all the queued batches are written (thread-safe)
+    void waitForIdle();
+
+    size_t recordedTraces() const;
+
+public slots:
+    void record(size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers);
+
+signals:
+    void tracesRecorded(size_t traces);
+    /// Emitted for every batch handed to record, once the writer is done with it
+    void batchRecorded();
+    void recordingFailed(QString message);
+
+private:
+    bool write(size_t traces, size_t samples, TScope::TSampleType type, const QList<QByteArray> & buffers, QString & message);
+
+    QSharedPointer<THdfSession> m_session;
+    QList<TTarget> m_targets;
+    QList<THdfSession::TraceAppendHandle> m_handles; // of the targets, opened by the first batch
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_queueChanged;
+    size_t m_pending;
+    size_t m_recordedTraces;
+    bool m_failed;
+
+    QElapsedTimer m_flushTimer;
+};
+
+#endif // TSCOPERECORDER_H
@@ -0,0 +1,282 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#include "tscopetracehistory.h"
+
+#include <algorithm>
+#include <utility>
+
+TScopeTraceHistory::TScopeTraceHistory(size_t traceLimit, size_t byteLimit, size_t fileLimit)
+    : m_traceLimit(traceLimit), m_byteLimit(byteLimit), m_fileLimit(fileLimit), m_traceCount(0), m_firstInMemory(0), m_memoryTraces(0), m_memoryBytes(0), m_spillFailed(false), m_droppedTraces(0), m_dropOldest(false)
+{
+
+}
+
+size_t TScopeTraceHistory::traceLimit() const
+{
+    return m_traceLimit;
+}
+
+size_t TScopeTraceHistory::byteLimit() const
+{
+    return m_byteLimit;
+}
+
+size_t TScopeTraceHistory::fileLimit() const
+{
+    return m_fileLimit;
+}
+
+void TScopeTraceHistory::setLimits(size_t traceLimit, size_t byteLimit, size_t fileLimit)
+{
+    m_traceLimit = traceLimit;
+    m_byteLimit = byteLimit;
+    m_fileLimit = fileLimit;
+    spill();
+}
+
+bool TScopeTraceHistory::dropsOldest() const
+{
+    return m_dropOldest;
+}
+
+void TScopeTraceHistory::setDropOldest(bool drop)
+{
+    m_dropOldest = drop;
+    spill();
+}
+
+void TScopeTraceHistory::append(const TScopeTraceData & traceData)
+{
+    TBatch batch;
+    batch.data = traceData;
+    batch.data.firstTraceIndex = m_traceCount;
+    batch.bytes = 0;
+    batch.spilled = false;
+    batch.dropped = false;
+
+    for (const QByteArray & buffer : traceData.buffers) {
+        batch.bytes += (size_t)buffer.size();
+    }
+
+    m_batches.append(batch);
+    m_firstTraces.append(m_traceCount);
+    m_traceCount += traceData.traces;
+
+    m_memoryTraces += traceData.traces;
+    m_memoryBytes += batch.bytes;
+
+    spill();
+}
+
+void TScopeTraceHistory::clear()
+{
+    m_batches.clear();
+    m_firstTraces.clear();
+    m_loadedBatches.clear();
+    m_traceCount = 0;
+
+    m_firstInMemory = 0;
+    m_memoryTraces = 0;
+    m_memoryBytes = 0;
+
+    m_file.reset();
+    m_spillFailed = false;
+    m_droppedTraces = 0;
+}
+
+size_t TScopeTraceHistory::traceCount() const
+{
+    return m_traceCount;
+}
+
+bool TScopeTraceHistory::hasDroppedTraces() const
+{
+    return m_droppedTraces > 0;
+}
+
+bool TScopeTraceHistory::isEmpty() const
+{
+    return m_traceCount == 0;
+}
+
+bool TScopeTraceHistory::find(size_t traceIndex, TScopeTraceData & traceData, size_t & traceBufferIndex) const
+{
+    if (traceIndex >= m_traceCount) {
+        return false;
+    }
+
+    // the last batch that starts at or before the trace
+    auto it = std::upper_bound(m_firstTraces.cbegin(), m_firstTraces.cend(), traceIndex);
+    if (it == m_firstTraces.cbegin()) {
+        return false;
+    }
+
+    const size_t batchIndex = (it - m_firstTraces.cbegin()) - 1;
+    TBatch & batch = m_batches[batchIndex];
+
+    if (batch.dropped) {
+        return false;
+    }
+
+    if (batch.spilled) {
+        if (batch.data.buffers.isEmpty() && !loadBatch(batch)) {
+            return false;
+        }
+        touchBatch(batchIndex);
+    }
+
+    traceData = batch.data;
+    traceBufferIndex = traceIndex - batch.data.firstTraceIndex;
+
+    return true;
+}
+
+size_t TScopeTraceHistory::firstRetainedTrace(size_t traceIndex) const
+{
+    if (traceIndex >= m_traceCount) {
+        return m_traceCount;
+    }
+
+    // the batch with the trace, the dropped batches removed from the front come before the first one
+    auto it = std::upper_bound(m_firstTraces.cbegin(), m_firstTraces.cend(), traceIndex);
+    size_t batchIndex = (it == m_firstTraces.cbegin()) ? 0 : (it - m_firstTraces.cbegin()) - 1;
+
+    while (batchIndex < (size_t)m_batches.size() && m_batches[batchIndex].dropped) {
+        batchIndex++;
+    }
+
+    if (batchIndex == (size_t)m_batches.size()) {
+        return m_traceCount;
+    }
+
+    return std::max(traceIndex, m_firstTraces[batchIndex]);
+}
+
+void TScopeTraceHistory::spill()
+{
+    // the latest batch always stays in the memory
+    while ((m_dropOldest || !m_spillFailed) && m_firstInMemory + 1 < (size_t)m_batches.size()
+           && ((m_traceLimit && m_memoryTraces > m_traceLimit) || (m_byteLimit && m_memoryBytes > m_byteLimit))) {
+
+        TBatch & batch = m_batches[m_firstInMemory];
+
+        const qint64 fileSize = m_file ? m_file->size() : 0;
+        const bool fileFull = m_fileLimit && (size_t)fileSize + batch.bytes > m_fileLimit;
+
+        if (m_dropOldest || fileFull) {
+            batch.data.buffers.clear();
+            batch.dropped = true;
+            m_droppedTraces += batch.data.traces;
+        }
+        else if (!spillBatch(batch)) {
+            m_spillFailed = true;
+            qWarning("Failed to spill the traces into a temporary file, all the traces are kept in the memory.");
+            return;
+        }
+
+        m_memoryTraces -= batch.data.traces;
+        m_memoryBytes -= batch.bytes;
+        m_firstInMemory++;
+    }
+
+    // the dropped batches at the front are not kept at all, so the index does not grow while dropping
+    while (m_firstInMemory > 0 && m_batches.first().dropped) {
+        m_batches.removeFirst();
+        m_firstTraces.removeFirst();
+        m_firstInMemory--;
+    }
+}
+
+bool TScopeTraceHistory::spillBatch(TBatch & batch)
+{
+    if (!m_file) {
+        m_file.reset(new QTemporaryFile());
+        if (!m_file->open()) {
+            m_file.reset();
+            return false;
+        }
+    }
+
+    if (!m_file->seek(m_file->size())) {
+        return false;
+    }
+
+    QList<qint64> offsets;
+    QList<qint64> sizes;
+
+    for (const QByteArray & buffer : std::as_const(batch.data.buffers)) {
+        offsets.append(m_file->pos());
+        sizes.append(buffer.size());
+
+        if (m_file->write(buffer) != buffer.size()) {
+            return false;
+        }
+    }
+
+    if (!m_file->flush()) {
+        return false;
+    }
+
+    batch.offsets = offsets;
+    batch.sizes = sizes;
+    batch.spilled = true;
+    batch.data.buffers.clear();
+
+    return true;
+}
+
+bool TScopeTraceHistory::loadBatch(TBatch & batch) const
+{
+    QList<QByteArray> buffers;
+
+    for (int i = 0; i < batch.offsets.count(); i++) {
+        QByteArray buffer(batch.sizes[i], Qt::Uninitialized);
+
+        if (batch.sizes[i] == 0) {
+            buffers.append(buffer);
+            continue;
+        }
+
+        if (!m_file->seek(batch.offsets[i]) || m_file->read(buffer.data(), buffer.size()) != buffer.size()) {
+            qWarning("Failed to read the spilled traces from the temporary file.");
+            return false;
+        }
+
+        buffers.append(buffer);
+    }
+
+    batch.data.buffers = buffers;
+
+    return true;
+}
+
+void TScopeTraceHistory::touchBatch(size_t batchIndex) const
+{
+    const size_t firstTrace = m_firstTraces[batchIndex];
+
+    m_loadedBatches.removeOne(firstTrace);
+    m_loadedBatches.append(firstTrace);
+
+    // the copies handed out keep their data, only the history releases its own
+    while ((size_t)m_loadedBatches.size() > SCOPE_HISTORY_LOADED_BATCHES) {
+        auto it = std::lower_bound(m_firstTraces.cbegin(), m_firstTraces.cend(), m_loadedBatches.takeFirst());
+        m_batches[it - m_firstTraces.cbegin()].data.buffers.clear();
+    }
+}
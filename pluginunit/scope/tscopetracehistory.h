@@ -0,0 +1,113 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TSCOPETRACEHISTORY_H
+#define TSCOPETRACEHISTORY_H
+
+#include <QList>
+#include <QByteArray>
+#include <QTemporaryFile>
+#include <memory>
+
+#include "tscope.h"
+
+#define SCOPE_HISTORY_TRACES 10000
+#define SCOPE_HISTORY_BYTES (256 * 1024 * 1024)
+#define SCOPE_HISTORY_FILE_BYTES (4096ULL * 1024 * 1024)
+#define SCOPE_HISTORY_LOADED_BATCHES 4
+
+struct TScopeTraceData {
+    size_t firstTraceIndex;
+    size_t traces;
+    size_t samples;
+    TScope::TSampleType type;
+    QList<QByteArray> buffers;
+    bool overvoltage;
+};
+
+/// History of the traces captured by the scope widget. The last batches are kept in the memory, within the limit
+/// on the number of traces and bytes, and the older ones are appended to a temporary file, so the whole history
+/// stays available. Only the few spilled batches looked up last are kept loaded. Once the file reaches its limit,
+/// the batches leaving the memory are dropped instead. The file is only truncated when the history is cleared.
+class TScopeTraceHistory
+{
+public:
+    /// Zero limit means no limit
+    explicit TScopeTraceHistory(size_t traceLimit = SCOPE_HISTORY_TRACES, size_t byteLimit = SCOPE_HISTORY_BYTES, size_t fileLimit = SCOPE_HISTORY_FILE_BYTES);
+
+    size_t traceLimit() const;
+    size_t byteLimit() const;
+    size_t fileLimit() const;
+    void setLimits(size_t traceLimit, size_t byteLimit, size_t fileLimit);
+
+    /// Drops the batches over the limits instead of spilling them, e.g. while they are recorded elsewhere
+    bool dropsOldest() const;
+    void setDropOldest(bool drop);
+
+    void append(const TScopeTraceData & traceData);
+    void clear();
+
+    size_t traceCount() const;
+    /// True once any traces were dropped, until the history is cleared
+    bool hasDroppedTraces() const;
+    bool isEmpty() const;
+
+    /// Finds the batch with the trace and the index of the trace within the batch. The buffers of a spilled batch
+    /// are loaded from the file, they own their data, so they stay valid after the batch is unloaded or the history
+    /// is cleared. Fails for the dropped traces.
+    bool find(size_t traceIndex, TScopeTraceData & traceData, size_t & traceBufferIndex) const;
+    /// The first trace at or after the index that was not dropped, the trace count when there is none
+    size_t firstRetainedTrace(size_t traceIndex) const;
+
+private:
+    struct TBatch {
+        TScopeTraceData data;
+        size_t bytes;
+        bool spilled;
+        bool dropped;
+        QList<qint64> offsets; // of the channel buffers in the file
+        QList<qint64> sizes;
+    };
+
+    void spill();
+    bool spillBatch(TBatch & batch);
+    bool loadBatch(TBatch & batch) const;
+    /// Keeps the batch loaded as the most recently used one, unloads the least recently used ones over the limit
+    void touchBatch(size_t batchIndex) const;
+
+    size_t m_traceLimit;
+    size_t m_byteLimit;
+    size_t m_fileLimit;
+
+    mutable QList<TBatch> m_batches;
+    QList<size_t> m_firstTraces; // index over the batch start offsets
+    mutable QList<size_t> m_loadedBatches; // first traces of the loaded spilled batches, the most recently used last
+    size_t m_traceCount;
+
+    size_t m_firstInMemory;
+    size_t m_memoryTraces;
+    size_t m_memoryBytes;
+
+    std::unique_ptr<QTemporaryFile> m_file;
+    bool m_spillFailed;
+    size_t m_droppedTraces;
+    bool m_dropOldest;
+};
+
+#endif // TSCOPETRACEHISTORY_H
@@ -0,0 +1,222 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#include "tscopetracepyramid.h"
+
+#include <algorithm>
+
+template <class T>
+static QVector<float> buildBaseLevel(const T * samples, size_t count)
+{
+    size_t blocks = (count + PYRAMID_BASE_BLOCK - 1) / PYRAMID_BASE_BLOCK;
+    QVector<float> level(blocks * 2);
+
+    for (size_t block = 0; block < blocks; block++) {
+        size_t first = block * PYRAMID_BASE_BLOCK;
+        size_t last = std::min(first + PYRAMID_BASE_BLOCK, count);
+
+        T min = samples[first];
+        T max = samples[first];
+        for (size_t i = first + 1; i < last; i++) {
+            min = samples[i] < min ? samples[i] : min;
+            max = samples[i] > max ? samples[i] : max;
+        }
+
+        level[block * 2] = (float)min;
+        level[block * 2 + 1] = (float)max;
+    }
+
+    return level;
+}
+
+static QVector<float> buildNextLevel(const QVector<float> & previous)
+{
+    size_t previousBlocks = previous.size() / 2;
+    size_t blocks = (previousBlocks + PYRAMID_FACTOR - 1) / PYRAMID_FACTOR;
+    QVector<float> level(blocks * 2);
+
+    for (size_t block = 0; block < blocks; block++) {
+        size_t first = block * PYRAMID_FACTOR;
+        size_t last = std::min(first + PYRAMID_FACTOR, previousBlocks);
+
+        float min = previous[first * 2];
+        float max = previous[first * 2 + 1];
+        for (size_t i = first + 1; i < last; i++) {
+            min = std::min(min, previous[i * 2]);
+            max = std::max(max, previous[i * 2 + 1]);
+        }
+
+        level[block * 2] = min;
+        level[block * 2 + 1] = max;
+    }
+
+    return level;
+}
+
+TScopeTracePyramid::TScopeTracePyramid(const QByteArray & buffer, TScope::TSampleType type, size_t traceBufferIndex, size_t samples)
+    : m_buffer(buffer), m_type(type), m_firstSample(traceBufferIndex * samples), m_samples(samples)
+{
+    if (!m_samples) {
+        return;
+    }
+
+    const char * data = m_buffer.constData();
+
+    switch (m_type) {
+    case TScope::TSampleType::TUInt8:
+        m_levels.append(buildBaseLevel((const uint8_t *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TInt8:
+        m_levels.append(buildBaseLevel((const int8_t *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TUInt16:
+        m_levels.append(buildBaseLevel((const uint16_t *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TInt16:
+        m_levels.append(buildBaseLevel((const int16_t *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TUInt32:
+        m_levels.append(buildBaseLevel((const uint32_t *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TInt32:
+        m_levels.append(buildBaseLevel((const int32_t *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TReal32:
+        m_levels.append(buildBaseLevel((const float *)data + m_firstSample, m_samples)); break;
+    case TScope::TSampleType::TReal64:
+        m_levels.append(buildBaseLevel((const double *)data + m_firstSample, m_samples)); break;
+    }
+
+    while (m_levels.last().size() > 2) {
+        m_levels.append(buildNextLevel(m_levels.last()));
+    }
+}
+
+size_t TScopeTracePyramid::samples() const
+{
+    return m_samples;
+}
+
+qreal TScopeTracePyramid::sample(size_t index) const
+{
+    const char * data = m_buffer.constData();
+    index += m_firstSample;
+
+    switch (m_type) {
+    case TScope::TSampleType::TUInt8:
+        return ((const uint8_t *)data)[index];
+    case TScope::TSampleType::TInt8:
+        return ((const int8_t *)data)[index];
+    case TScope::TSampleType::TUInt16:
+        return ((const uint16_t *)data)[index];
+    case TScope::TSampleType::TInt16:
+        return ((const int16_t *)data)[index];
+    case TScope::TSampleType::TUInt32:
+        return ((const uint32_t *)data)[index];
+    case TScope::TSampleType::TInt32:
+        return ((const int32_t *)data)[index];
+    case TScope::TSampleType::TReal32:
+        return ((const float *)data)[index];
+    case TScope::TSampleType::TReal64:
+        return ((const double *)data)[index];
+    }
+
+    return 0;
+}
+
+size_t TScopeTracePyramid::blockSize(int level) const
+{
+    size_t size = PYRAMID_BASE_BLOCK;
+
+    for (int i = 0; i < level; i++) {
+        size *= PYRAMID_FACTOR;
+    }
+
+    return size;
+}
+
+QVector<QPointF> TScopeTracePyramid::points(size_t first, size_t last, size_t columns, qreal slope, qreal offset) const
+{
+    QVector<QPointF> points;
+
+    last = std::min(last, m_samples);
+    if (first >= last || columns == 0) {
+        return points;
+    }
+
+    size_t count = last - first;
+
+    if (count <= columns) {
+        // not too many samples, draw every sample as single point
+        points.reserve(count);
+        for (size_t i = first; i < last; i++) {
+            points.append(QPointF(i, slope * sample(i) + offset));
+        }
+
+        return points;
+    }
+
+    // the coarsest level with blocks not larger than a column, the raw samples below the base level
+    int level = -1;
+    while (level + 1 < m_levels.size() && blockSize(level + 1) * columns <= count) {
+        level++;
+    }
+
+    points.reserve(columns * 2);
+
+    for (size_t column = 0; column < columns; column++) {
+        size_t columnFirst = first + column * count / columns;
+        size_t columnLast = first + (column + 1) * count / columns;
+
+        if (columnFirst >= columnLast) {
+            continue;
+        }
+
+        qreal min, max;
+
+        if (level < 0) {
+            min = max = sample(columnFirst);
+            for (size_t i = columnFirst + 1; i < columnLast; i++) {
+                qreal value = sample(i);
+                min = value < min ? value : min;
+                max = value > max ? value : max;
+            }
+        }
+        else {
+            // the blocks overlapping the column, the column spans fewer than PYRAMID_FACTOR + 2 of them
+            const QVector<float> & blocks = m_levels[level];
+            size_t size = blockSize(level);
+            size_t blockFirst = columnFirst / size;
+            size_t blockLast = std::min((columnLast + size - 1) / size, (size_t)blocks.size() / 2);
+
+            min = blocks[blockFirst * 2];
+            max = blocks[blockFirst * 2 + 1];
+            for (size_t block = blockFirst + 1; block < blockLast; block++) {
+                min = std::min(min, (qreal)blocks[block * 2]);
+                max = std::max(max, (qreal)blocks[block * 2 + 1]);
+            }
+        }
+
+        min = slope * min + offset;
+        max = slope * max + offset;
+
+        if (slope < 0) {
+            std::swap(min, max);
+        }
+
+        points.append(QPointF(columnFirst, min));
+        points.append(QPointF(columnFirst, max));
+    }
+
+    return points;
+}
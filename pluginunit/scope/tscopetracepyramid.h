@@ -0,0 +1,60 @@
+// TraceXpert
+// Copyright (C) 2025 Embedded Security Lab, CTU in Prague, and contributors.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+// Contributors to this file:
+// Petr Socha (initial author)
+
+#ifndef TSCOPETRACEPYRAMID_H
+#define TSCOPETRACEPYRAMID_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+#include <QPointF>
+
+#include "tscope.h"
+
+#define PYRAMID_BASE_BLOCK 8
+#define PYRAMID_FACTOR 4
+
+/// Min/max pyramid of a single trace of a single channel. Level 0 keeps the minimum and maximum of every block
+/// of PYRAMID_BASE_BLOCK samples, every next level merges PYRAMID_FACTOR blocks of the previous one. A view of any
+/// range of the trace is then drawn from the level that matches the number of columns, in O(columns).
+class TScopeTracePyramid
+{
+public:
+    /// The buffer holds the batch of traces, the pyramid is built for the trace at the given index within the batch
+    TScopeTracePyramid(const QByteArray & buffer, TScope::TSampleType type, size_t traceBufferIndex, size_t samples);
+
+    size_t samples() const;
+
+    /// Points of the samples in [first, last) for at most the given number of columns, every column is represented
+    /// by its minimum and maximum. The sample values are mapped to slope * value + offset.
+    QVector<QPointF> points(size_t first, size_t last, size_t columns, qreal slope, qreal offset) const;
+
+private:
+    qreal sample(size_t index) const;
+    size_t blockSize(int level) const;
+
+    QByteArray m_buffer;
+    TScope::TSampleType m_type;
+    size_t m_firstSample;
+    size_t m_samples;
+
+    QList<QVector<float>> m_levels; // minimum and maximum of every block, interleaved
+};
+
+#endif // TSCOPETRACEPYRAMID_H
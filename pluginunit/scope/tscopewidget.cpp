@@ -31,9 +31,14 @@
 #include <QSplitter>
 #include <QFileDialog>
 #include <QDialogButtonBox>
+#include <QFormLayout>
 #include <QSharedPointer>
 #include <QJsonObject>
 #include <QJsonDocument>
+#include <QSignalBlocker>
+#include <cmath>
+#include <climits>
+#include <algorithm>
 
 #include "tscopewidget.h"
 #include "widgets/tconfigparamwidget.h"
@@ -101,12 +106,45 @@ TScopeWidget::TScopeWidget(TScopeModel * scope, QWidget * parent) : QWidget(pare
     connect(scope, &TScopeModel::stopped, this, &TScopeWidget::stopped);
 
     m_chart = new QChart();
-    QChartView * chartView = new QChartView(m_chart);
+    TScopeChartView * chartView = new TScopeChartView(m_chart);
+    connect(chartView, &TScopeChartView::zoomRequested, this, &TScopeWidget::zoom);
+    connect(chartView, &TScopeChartView::panRequested, this, &TScopeWidget::pan);
+    connect(chartView, &TScopeChartView::zoomResetRequested, this, &TScopeWidget::resetZoom);
 
     m_axisX = new QValueAxis();
     m_axisX->setLabelFormat("%g");
     m_axisX->setTitleText("Samples");
     m_chart->addAxis(m_axisX, Qt::AlignBottom);
+    connect(m_axisX, &QValueAxis::rangeChanged, this, &TScopeWidget::updateLineSeries);
+    connect(m_chart, &QChart::plotAreaChanged, this, &TScopeWidget::updateDensityBackground);
+    m_displayedSamples = 0;
+
+    m_densityWorker = new TScopeDensityWorker;
+    m_densityWorker->moveToThread(&m_densityThread);
+    connect(this, &TScopeWidget::densityBatchReady, m_densityWorker, &TScopeDensityWorker::accumulate, Qt::ConnectionType::QueuedConnection);
+    connect(m_densityWorker, &TScopeDensityWorker::imageUpdated, this, &TScopeWidget::densityImageUpdated, Qt::ConnectionType::QueuedConnection);
+    m_densityThread.start();
+
+    m_densityGeneration = 0;
+    m_densityConfigured = false;
+    m_densityNextTrace = 0;
+    m_densityBusy = false;
+
+    m_redrawTimer = new QTimer(this);
+    m_redrawTimer->setSingleShot(true);
+    m_redrawTimer->setInterval(1000 / LIVE_FRAME_RATE);
+    connect(m_redrawTimer, &QTimer::timeout, this, [=](){
+        if(!m_redrawPending)
+            return;
+
+        m_redrawPending = false;
+        showLatestTrace();
+        m_redrawTimer->start();
+    });
+    m_redrawPending = false;
+
+    m_recorder = nullptr;
+    m_recordWizard = nullptr;
 
     m_axisY = new QValueAxis();
     // TODO: decide on a more suitable title text
@@ -159,6 +197,42 @@ TScopeWidget::TScopeWidget(TScopeModel * scope, QWidget * parent) : QWidget(pare
     m_stopButton->setEnabled(false);
     connect(m_stopButton, &QPushButton::clicked, this, &TScopeWidget::stopButtonClicked);
 
+    m_pipelinedCheckBox = new QCheckBox(tr("Pipelined"));
+    m_pipelinedCheckBox->setChecked(m_scopeModel->isPipelined());
+    m_pipelinedCheckBox->setToolTip("Re-arm the scope right after each download when sampling repeatedly");
+    connect(m_pipelinedCheckBox, &QCheckBox::toggled, m_scopeModel, &TScopeModel::setPipelined);
+
+    m_recordCheckBox = new QCheckBox(tr("Record to HDF"));
+    m_recordCheckBox->setChecked(false);
+    m_recordCheckBox->setToolTip("Append every captured batch to HDF5 datasets while sampling");
+    connect(m_recordCheckBox, &QCheckBox::toggled, this, &TScopeWidget::setRecording);
+
+    m_densityCheckBox = new QCheckBox(tr("Density"));
+    m_densityCheckBox->setChecked(false);
+    m_densityCheckBox->setToolTip("Overlay all the captured traces as a density map");
+    connect(m_densityCheckBox, &QCheckBox::toggled, this, &TScopeWidget::setDensityMode);
+
+    // the range of the overlaid traces, the last one zero means up to the latest trace
+    m_densityFirstSpinBox = new QSpinBox(this);
+    m_densityFirstSpinBox->setRange(1, INT_MAX);
+    m_densityFirstSpinBox->setValue(1);
+    m_densityFirstSpinBox->setPrefix("from ");
+    m_densityFirstSpinBox->setToolTip("First trace overlaid in the density map");
+
+    m_densityLastSpinBox = new QSpinBox(this);
+    m_densityLastSpinBox->setRange(0, INT_MAX);
+    m_densityLastSpinBox->setValue(0);
+    m_densityLastSpinBox->setPrefix("to ");
+    m_densityLastSpinBox->setSpecialValueText("to latest");
+    m_densityLastSpinBox->setToolTip("Last trace overlaid in the density map");
+
+    auto restartDensityRange = [=](){
+        if(m_densityCheckBox->isChecked())
+            restartDensity();
+    };
+    connect(m_densityFirstSpinBox, qOverload<int>(&QSpinBox::valueChanged), this, restartDensityRange);
+    connect(m_densityLastSpinBox, qOverload<int>(&QSpinBox::valueChanged), this, restartDensityRange);
+
     m_clearDataButton = new QPushButton();
     m_clearDataButton->setIcon(QIcon(":/icons/delete.png"));
     m_clearDataButton->setIconSize(QSize(22, 22));
@@ -180,6 +254,12 @@ TScopeWidget::TScopeWidget(TScopeModel * scope, QWidget * parent) : QWidget(pare
     m_exportDataButton->setEnabled(false);
     connect(m_exportDataButton, &QPushButton::clicked, this, &TScopeWidget::exportHdf);
 
+    m_historyButton = new QPushButton();
+    m_historyButton->setIcon(QIcon(":/icons/settings.png"));
+    m_historyButton->setIconSize(QSize(22, 22));
+    m_historyButton->setToolTip("Trace history limits");
+    connect(m_historyButton, &QPushButton::clicked, this, &TScopeWidget::editHistoryLimits);
+
     m_prevTraceButton = new QPushButton();
     m_prevTraceButton->setIcon(QIcon(":/icons/prev.png"));
     m_prevTraceButton->setIconSize(QSize(22, 22));
@@ -195,7 +275,8 @@ TScopeWidget::TScopeWidget(TScopeModel * scope, QWidget * parent) : QWidget(pare
     m_traceIndexSpinBox->setFixedWidth(80);
     m_traceIndexSpinBox->setAlignment(Qt::AlignCenter);
     connect(m_traceIndexSpinBox, qOverload<int>(&QSpinBox::valueChanged), this, [=](int newTrace) {
-        if(newTrace < 1 || newTrace > m_totalTraceCount)
+        // the trace is already displayed when the spin box only follows the current trace
+        if(newTrace < 1 || newTrace > m_totalTraceCount || (size_t)newTrace == m_currentTraceNumber)
             return;
         m_currentTraceNumber = newTrace;
         updateTraceIndexView();
@@ -216,9 +297,15 @@ TScopeWidget::TScopeWidget(TScopeModel * scope, QWidget * parent) : QWidget(pare
     toolbarLayout->addWidget(m_runOnceButton);
     toolbarLayout->addWidget(m_runButton);
     toolbarLayout->addWidget(m_stopButton);
+    toolbarLayout->addWidget(m_pipelinedCheckBox);
+    toolbarLayout->addWidget(m_densityCheckBox);
+    toolbarLayout->addWidget(m_densityFirstSpinBox);
+    toolbarLayout->addWidget(m_densityLastSpinBox);
+    toolbarLayout->addWidget(m_recordCheckBox);
     toolbarLayout->addWidget(m_clearDataButton);
     toolbarLayout->addWidget(m_saveDataButton);
     toolbarLayout->addWidget(m_exportDataButton);
+    toolbarLayout->addWidget(m_historyButton);
     toolbarLayout->addStretch();
     toolbarLayout->addWidget(m_prevTraceButton);
     toolbarLayout->addWidget(m_traceIndexSpinBox);
@@ -234,6 +321,15 @@ TScopeWidget::TScopeWidget(TScopeModel * scope, QWidget * parent) : QWidget(pare
     setLayout(layout);
 }
 
+TScopeWidget::~TScopeWidget() {
+    stopRecording();
+
+    m_densityThread.quit();
+    m_densityThread.wait();
+
+    delete m_densityWorker;
+}
+
 bool TScopeWidget::applyPostInitParam() {
 
     if(m_totalTraceCount > 0){
@@ -279,13 +375,22 @@ void TScopeWidget::clearTraceData(bool force) {
             return;
     }
 
-    m_traceDataList.clear();
+    m_redrawTimer->stop();
+    m_redrawPending = false;
 
     m_totalTraceCount = 0;
     m_currentTraceNumber = 0;
     updateTraceIndexView();
 
+    // the pyramids and the density worker refer to the history data
+    m_displayedChannels.clear();
     m_chart->removeAllSeries();
+    m_densityGeneration = m_densityWorker->reset(0, 0, 0, {});
+    m_densityConfigured = false;
+    m_densityBusy = false;
+    m_densityImage = QImage();
+    updateDensityBackground();
+    m_traceHistory.clear();
 
     m_clearDataButton->setEnabled(false);
     m_saveDataButton->setEnabled(false);
@@ -314,6 +419,35 @@ static QString triggerTypeToString(TScope::TTriggerStatus::TTriggerType t)
     return QStringLiteral("unknown");
 }
 
+QString TScopeWidget::channelSettings(TScope::TChannelStatus channelStatus)
+{
+    TScope::TTriggerStatus triggerStatus = m_scopeModel->triggerStatus();
+    TScope::TTimingStatus timingStatus = m_scopeModel->timingStatus();
+
+    QJsonObject JChannel;
+    JChannel["alias"] = channelStatus.getAlias();
+    JChannel["index"] = channelStatus.getIndex();
+    JChannel["maxValue"] = channelStatus.getMaxValue();
+    JChannel["minValue"] = channelStatus.getMinValue();
+    JChannel["offset"] = channelStatus.getOffset();
+    JChannel["range"] = channelStatus.getRange();
+    QJsonObject JTrigger;
+    JTrigger["sourceIndex"] = triggerStatus.getTriggerSourceIndex();
+    JTrigger["type"] = triggerTypeToString(triggerStatus.getTriggerType());
+    JTrigger["voltage"] = triggerStatus.getTriggerVoltage();
+    QJsonObject JTiming;
+    JTiming["preTriggerSamples"] = static_cast<qint64>(timingStatus.getPreTriggerSamples());
+    JTiming["postTriggerSamples"] = static_cast<qint64>(timingStatus.getPostTriggerSamples());
+    JTiming["capturesPerRun"] = static_cast<qint64>(timingStatus.getCapturesPerRun());
+    JTiming["samplePeriod"] = timingStatus.getSamplePeriod();
+    QJsonObject JRoot;
+    JRoot["channel"] = JChannel;
+    JRoot["trigger"] = JTrigger;
+    JRoot["timing"] = JTiming;
+    QJsonDocument JDoc(JRoot);
+    return QString::fromUtf8(JDoc.toJson(QJsonDocument::Compact));
+}
+
 class TWizLog
 {
 public:
@@ -448,27 +582,21 @@ void TScopeWidget::exportHdf() {
 
             bool ok = true;
 
-            for(size_t traceIndex = startTraceIdx; traceIndex < startTraceIdx + totalTraceCount; traceIndex++){
-                bool found = false;
-                size_t traceDataListIndex = 0;
-                while(traceDataListIndex < (size_t)m_traceDataList.size()) {
-                    if(m_traceDataList[traceDataListIndex].firstTraceIndex + m_traceDataList[traceDataListIndex].traces > traceIndex) {
-                        found = true;
-                        break;
-                    }
-
-                    traceDataListIndex++;
-                }
+            // The traces are appended a batch at a time, each batch with a single write
+            size_t traceIndex = startTraceIdx;
+            while(traceIndex < startTraceIdx + totalTraceCount){
+                TScopeTraceData traceData;
+                size_t traceBufferIndex;
 
-                if(!found) {
+                if(!m_traceHistory.find(traceIndex, traceData, traceBufferIndex)) {
                     log.critical("Trying to save a trace with valid index, but data is missing!");
                     ok = false;
+                    traceIndex++;
                     continue;
                 }
 
-                const TScopeTraceData traceData = m_traceDataList[traceDataListIndex];
-                size_t traceBufferIndex = traceIndex - m_traceDataList[traceDataListIndex].firstTraceIndex;
-
+                size_t rowCount = std::min(traceData.traces - traceBufferIndex, startTraceIdx + totalTraceCount - traceIndex);
+                traceIndex += rowCount;
 
                 size_t channelIndex = 0;
                 bool foundChIdx = false;
@@ -493,55 +621,21 @@ void TScopeWidget::exportHdf() {
                     continue;
                 }
 
-                switch(traceData.type) {
-                case TScope::TSampleType::TUInt8:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(uint8_t))), traceData.type, traceData.samples * sizeof(uint8_t))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TInt8:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(int8_t))), traceData.type, traceData.samples * sizeof(int8_t))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TUInt16:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(uint16_t))), traceData.type, traceData.samples * sizeof(uint16_t))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TInt16:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(int16_t))), traceData.type, traceData.samples * sizeof(int16_t))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TUInt32:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(uint32_t))), traceData.type, traceData.samples * sizeof(uint32_t))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TInt32:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(int32_t))), traceData.type, traceData.samples * sizeof(int32_t))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TReal32:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(float))), traceData.type, traceData.samples * sizeof(float))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
-                case TScope::TSampleType::TReal64:
-                    if (!session->appendTraceRow(h, reinterpret_cast<const void *>((traceData.buffers[channelIndex].constData()) + (traceBufferIndex * traceData.samples * sizeof(double))), traceData.type, traceData.samples * sizeof(double))){
-                        log.critical("Failed to append a trace into HDF file.");
-                        ok = false;
-                    }
-                    break;
+                const QByteArray & buffer = traceData.buffers[channelIndex];
+
+                // a part of a batch is sliced by its rows, so the batch must hold whole rows
+                if ((size_t)buffer.size() % traceData.traces) {
+                    log.critical("The size of the channel data does not match the number of traces.");
+                    ok = false;
+                    continue;
+                }
+
+                size_t rowBytes = (size_t)buffer.size() / traceData.traces;
+                size_t sliceBytes = (rowCount == traceData.traces) ? (size_t)buffer.size() : rowCount * rowBytes;
+
+                if (!session->appendTraceRows(h, buffer.constData() + traceBufferIndex * rowBytes, rowCount, traceData.type, sliceBytes)){
+                    log.critical("Failed to append traces into HDF file.");
+                    ok = false;
                 }
 
             }
@@ -558,31 +652,7 @@ void TScopeWidget::exportHdf() {
             QString timestamp = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
 
             // TScope::TChannelStatus channelStatus
-            TScope::TTriggerStatus triggerStatus = m_scopeModel->triggerStatus();
-            TScope::TTimingStatus timingStatus = m_scopeModel->timingStatus();
-
-            QJsonObject JChannel;
-            JChannel["alias"] = channelStatus.getAlias();
-            JChannel["index"] = channelStatus.getIndex();
-            JChannel["maxValue"] = channelStatus.getMaxValue();
-            JChannel["minValue"] = channelStatus.getMinValue();
-            JChannel["offset"] = channelStatus.getOffset();
-            JChannel["range"] = channelStatus.getRange();
-            QJsonObject JTrigger;
-            JTrigger["sourceIndex"] = triggerStatus.getTriggerSourceIndex();
-            JTrigger["type"] = triggerTypeToString(triggerStatus.getTriggerType());
-            JTrigger["voltage"] = triggerStatus.getTriggerVoltage();
-            QJsonObject JTiming;
-            JTiming["preTriggerSamples"] = static_cast<qint64>(timingStatus.getPreTriggerSamples());
-            JTiming["postTriggerSamples"] = static_cast<qint64>(timingStatus.getPostTriggerSamples());
-            JTiming["capturesPerRun"] = static_cast<qint64>(timingStatus.getCapturesPerRun());
-            JTiming["samplePeriod"] = timingStatus.getSamplePeriod();
-            QJsonObject JRoot;
-            JRoot["channel"] = JChannel;
-            JRoot["trigger"] = JTrigger;
-            JRoot["timing"] = JTiming;
-            QJsonDocument JDoc(JRoot);
-            const QString settings = QString::fromUtf8(JDoc.toJson(QJsonDocument::Compact));
+            const QString settings = channelSettings(channelStatus);
 
 
             if (!session->appendTracesMetadataRecord(metadataPath, first_trace, trace_count, timestamp, settings)){
@@ -608,6 +678,125 @@ void TScopeWidget::exportHdf() {
 
 }
 
+void TScopeWidget::setRecording(bool enabled) {
+    if(enabled == (m_recorder != nullptr))
+        return;
+
+    if(!enabled) {
+        size_t recordedTraces = m_recorder->recordedTraces();
+        stopRecording();
+        QMessageBox::information(this, tr("Recording"), tr("Recorded %1 traces.").arg(recordedTraces));
+        return;
+    }
+
+    if(!startRecording()) {
+        QSignalBlocker blocker(m_recordCheckBox);
+        m_recordCheckBox->setChecked(false);
+    }
+}
+
+bool TScopeWidget::startRecording() {
+    // the datasets are created for the format of the traces captured so far
+    if(!m_totalTraceCount) {
+        QMessageBox::information(this, tr("Recording"), tr("Sample once first, so the format of the recorded traces is known."));
+        return false;
+    }
+
+    QStringList channels;
+    for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
+        if(channel.isEnabled())
+            channels << channel.getAlias();
+    }
+
+    TExportHDFScopeWizard * wizard = new TExportHDFScopeWizard(this);
+    wizard->setWindowTitle(tr("Record traces to HDF5"));
+    wizard->setInitialFileName("");
+    wizard->setTraceInfo(m_totalTraceCount);
+    wizard->setChannels(channels);
+    wizard->setTraceFormat(m_samples, m_type);
+
+    if(wizard->exec() != TExportHDFScopeWizard::Result_Paused) {
+        wizard->deleteLater();
+        return false;
+    }
+
+    QSharedPointer<THdfSession> session = wizard->hdfSession();
+    const auto targets = wizard->channelTargets();
+
+    if(!session || !session->isOpen()) {
+        QMessageBox::critical(this, tr("Error"), tr("No open HDF5 session; cannot record."));
+        wizard->deleteLater();
+        return false;
+    }
+
+    // the wizard closes the session when deleted, it is kept until the recording stops
+    session->setParent(nullptr);
+    m_recordWizard = wizard;
+
+    QList<TScopeRecorder::TTarget> recorderTargets;
+    for(const TExportHDFScopeWizard::TChannelTarget & target : targets) {
+        int bufferIndex = 0;
+        for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
+            if(channel.isEnabled() && channel.getAlias() == target.alias) {
+                recorderTargets.append(TScopeRecorder::TTarget{bufferIndex, THdfSession::normalizePath(target.tracesDataset), THdfSession::normalizePath(target.metadataGroup), channelSettings(channel)});
+                break;
+            }
+
+            bufferIndex++;
+        }
+    }
+
+    if(recorderTargets.isEmpty()) {
+        QMessageBox::critical(this, tr("Error"), tr("No channel selected for recording."));
+        m_recordWizard->deleteLater();
+        m_recordWizard = nullptr;
+        return false;
+    }
+
+    m_recorder = new TScopeRecorder(session, recorderTargets);
+    m_recorder->moveToThread(&m_recorderThread);
+    connect(this, &TScopeWidget::recordBatch, m_recorder, &TScopeRecorder::record, Qt::ConnectionType::QueuedConnection);
+    connect(m_recorder, &TScopeRecorder::batchRecorded, m_scopeModel, &TScopeModel::releaseBatch, Qt::ConnectionType::QueuedConnection);
+    connect(m_recorder, &TScopeRecorder::tracesRecorded, this, [=](size_t traces){
+        m_recordCheckBox->setToolTip(QString("Recording, %1 traces recorded").arg(traces));
+    }, Qt::ConnectionType::QueuedConnection);
+    connect(m_recorder, &TScopeRecorder::recordingFailed, this, &TScopeWidget::recordingFailed, Qt::ConnectionType::QueuedConnection);
+    m_recorderThread.start();
+
+    // the recorded traces need not be kept until the data are cleared
+    m_traceHistory.setDropOldest(true);
+
+    return true;
+}
+
+void TScopeWidget::stopRecording() {
+    if(!m_recorder)
+        return;
+
+    // the queued batches are written before the file is closed
+    m_recorder->waitForIdle();
+
+    m_recorderThread.quit();
+    m_recorderThread.wait();
+
+    delete m_recorder;
+    m_recorder = nullptr;
+
+    m_recordWizard->deleteLater();
+    m_recordWizard = nullptr;
+
+    m_traceHistory.setDropOldest(false);
+    m_recordCheckBox->setToolTip("Append every captured batch to HDF5 datasets while sampling");
+}
+
+void TScopeWidget::recordingFailed(QString message) {
+    QSignalBlocker blocker(m_recordCheckBox);
+    m_recordCheckBox->setChecked(false);
+    stopRecording();
+
+    QMessageBox::critical(this, tr("Error"), tr("Recording stopped: %1").arg(message));
+}
+
 void TScopeWidget::saveTraceData() {
 
     QStringList channels;
@@ -650,25 +839,14 @@ void TScopeWidget::saveTraceData() {
     }
 
     for(size_t traceIndex = 0; traceIndex < m_totalTraceCount; traceIndex++){
-        bool found = false;
-        size_t traceDataListIndex = 0;
-        while(traceDataListIndex < (size_t)m_traceDataList.size()) {
-            if(m_traceDataList[traceDataListIndex].firstTraceIndex + m_traceDataList[traceDataListIndex].traces > traceIndex) {
-                found = true;
-                break;
-            }
+        TScopeTraceData traceData;
+        size_t traceBufferIndex;
 
-            traceDataListIndex++;
-        }
-
-        if(!found) {
+        if(!m_traceHistory.find(traceIndex, traceData, traceBufferIndex)) {
             qWarning("Trying to save a trace with valid index, but data is missing!");
             return;
         }
 
-        const TScopeTraceData traceData = m_traceDataList[traceDataListIndex];
-        size_t traceBufferIndex = traceIndex - m_traceDataList[traceDataListIndex].firstTraceIndex;
-
         size_t channelIndex = 0;
         for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
 
@@ -716,6 +894,7 @@ void TScopeWidget::setGUItoRunning() {
     m_clearDataButton->setEnabled(false);
     m_saveDataButton->setEnabled(false);
     m_exportDataButton->setEnabled(false);
+    m_pipelinedCheckBox->setEnabled(false);
 
     //clearTraceData();
 
@@ -726,9 +905,11 @@ void TScopeWidget::setGUItoReady() {
     m_runOnceButton->setEnabled(true);
     m_runButton->setEnabled(true);
     m_stopButton->setEnabled(false);
+    m_pipelinedCheckBox->setEnabled(true);
     m_clearDataButton->setEnabled(m_totalTraceCount ? true : false);
-    m_saveDataButton->setEnabled(m_totalTraceCount ? true : false);
-    m_exportDataButton->setEnabled(m_totalTraceCount ? true : false);
+    // the traces dropped from the history can no longer be saved or exported
+    m_saveDataButton->setEnabled(m_totalTraceCount && !m_traceHistory.hasDroppedTraces());
+    m_exportDataButton->setEnabled(m_totalTraceCount && !m_traceHistory.hasDroppedTraces());
 
     if(m_totalTraceCount){
         m_traceIndexSpinBox->setMinimum(1);
@@ -762,6 +943,45 @@ void TScopeWidget::stopButtonClicked() {
     m_scopeModel->stop();
 }
 
+void TScopeWidget::editHistoryLimits()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Trace history limits"));
+
+    auto * layout = new QFormLayout(&dialog);
+
+    // zero means no limit
+    auto * tracesSpinBox = new QSpinBox(&dialog);
+    tracesSpinBox->setRange(0, INT_MAX);
+    tracesSpinBox->setSpecialValueText(tr("No limit"));
+    tracesSpinBox->setValue((int)std::min(m_traceHistory.traceLimit(), (size_t)INT_MAX));
+    layout->addRow(tr("Traces in memory"), tracesSpinBox);
+
+    auto * memorySpinBox = new QSpinBox(&dialog);
+    memorySpinBox->setRange(0, INT_MAX);
+    memorySpinBox->setSpecialValueText(tr("No limit"));
+    memorySpinBox->setSuffix(" MB");
+    memorySpinBox->setValue((int)std::min(m_traceHistory.byteLimit() / (1024 * 1024), (size_t)INT_MAX));
+    layout->addRow(tr("Samples in memory"), memorySpinBox);
+
+    auto * fileSpinBox = new QSpinBox(&dialog);
+    fileSpinBox->setRange(0, INT_MAX);
+    fileSpinBox->setSpecialValueText(tr("No limit"));
+    fileSpinBox->setSuffix(" MB");
+    fileSpinBox->setValue((int)std::min(m_traceHistory.fileLimit() / (1024 * 1024), (size_t)INT_MAX));
+    layout->addRow(tr("Temporary file"), fileSpinBox);
+
+    auto * btnBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(btnBox, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(btnBox, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addRow(btnBox);
+
+    if (dialog.exec() != QDialog::Accepted)
+        return;
+
+    m_traceHistory.setLimits((size_t)tracesSpinBox->value(), (size_t)memorySpinBox->value() * 1024 * 1024, (size_t)fileSpinBox->value() * 1024 * 1024);
+}
+
 void TScopeWidget::showPrevTrace() {
     if(m_currentTraceNumber <= 1)
         return;
@@ -783,7 +1003,14 @@ void TScopeWidget::showNextTrace() {
 }
 
 void TScopeWidget::updateChannelStatus() {
+    // the series are created anew for the new channel settings
+    m_displayedChannels.clear();
+    m_chart->removeAllSeries();
+
     displayTrace(m_currentTraceNumber-1);
+
+    if(m_densityCheckBox->isChecked())
+        restartDensity();
 }
 
 void TScopeWidget::runFailed() {
@@ -832,19 +1059,44 @@ void TScopeWidget::receiveTraces(size_t traces, size_t samples, TScope::TSampleT
         return;
     }
 
+    // the writer thread appends the batch to the file, the scope is not re-armed past the batches it has yet to write
+    if(m_recorder) {
+        m_scopeModel->holdBatch();
+        m_recorder->reserveSlot();
+        emit recordBatch(traces, samples, type, buffers);
+    }
+
     // save data to internal buffers
-    m_traceDataList.append(TScopeTraceData{m_totalTraceCount, traces, samples, type, buffers, overvoltage});
+    m_traceHistory.append(TScopeTraceData{m_totalTraceCount, traces, samples, type, buffers, overvoltage});
     m_samples = samples;
     m_type = type;
     
     // update GUI
     m_totalTraceCount += traces;
     m_currentTraceNumber = m_totalTraceCount;
-    updateTraceIndexView();
-    m_saveDataButton->setEnabled(true);
-    m_exportDataButton->setEnabled(true);
+    m_saveDataButton->setEnabled(!m_traceHistory.hasDroppedTraces());
+    m_exportDataButton->setEnabled(!m_traceHistory.hasDroppedTraces());
+
+    // show latest trace on chart, at most LIVE_FRAME_RATE times per second, the frames in between are never drawn
+    if(m_redrawTimer->isActive()) {
+        m_redrawPending = true;
+    }
+    else {
+        showLatestTrace();
+        m_redrawTimer->start();
+    }
 
-    // show latest trace on chart
+    if(m_densityCheckBox->isChecked()) {
+        if(m_densityConfigured)
+            feedDensity();
+        else
+            restartDensity();
+    }
+}
+
+void TScopeWidget::showLatestTrace() {
+    m_currentTraceNumber = m_totalTraceCount;
+    updateTraceIndexView();
     displayTrace(m_currentTraceNumber-1);
 }
 
@@ -854,35 +1106,64 @@ void TScopeWidget::displayTrace(size_t traceIndex) {
         return;
     }
 
-    bool found = false;
-    size_t traceDataListIndex = 0;
-    while(traceDataListIndex < (size_t)m_traceDataList.size()) {
-        if(m_traceDataList[traceDataListIndex].firstTraceIndex + m_traceDataList[traceDataListIndex].traces > traceIndex) {
-            found = true;
-            break;
+    TScopeTraceData traceData;
+    size_t traceBufferIndex;
+
+    if(!m_traceHistory.find(traceIndex, traceData, traceBufferIndex)) {
+        qWarning("Trying to display trace with valid index, but data is missing!");
+        return;
+    }
+
+    // the pyramid is built once per displayed trace, the zoom and pan only query it
+    QList<TDisplayedChannel> displayedChannels;
+    size_t channelIndex = 0;
+    for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
+
+        if(!channel.isEnabled() || traceData.buffers[channelIndex] == nullptr) {
+            channelIndex++;
+            continue;
         }
 
-        traceDataListIndex++;
+        std::shared_ptr<TScopeTracePyramid> pyramid = std::make_shared<TScopeTracePyramid>(traceData.buffers[channelIndex], traceData.type, traceBufferIndex, traceData.samples);
+        displayedChannels.append(TDisplayedChannel{nullptr, channel, pyramid});
+
+        channelIndex++;
     }
 
-    if(!found) {
-        qWarning("Trying to display trace with valid index, but data is missing!");
-        return;
+    // the series of the same channels are reused, only their points are replaced
+    bool reuseSeries = displayedChannels.count() == m_displayedChannels.count();
+    for(int i = 0; reuseSeries && i < displayedChannels.count(); i++) {
+        TScope::TChannelStatus channel = displayedChannels[i].channel;
+        TScope::TChannelStatus displayedChannel = m_displayedChannels[i].channel;
+        reuseSeries = channel.getIndex() == displayedChannel.getIndex() && channel.getAlias() == displayedChannel.getAlias();
     }
 
-    const TScopeTraceData traceData = m_traceDataList[traceDataListIndex];
-    size_t traceBufferIndex = traceIndex - m_traceDataList[traceDataListIndex].firstTraceIndex;
+    if(reuseSeries) {
+        for(int i = 0; i < displayedChannels.count(); i++) {
+            displayedChannels[i].lineSeries = m_displayedChannels[i].lineSeries;
+        }
+        m_displayedChannels = displayedChannels;
+    }
+    else {
+        m_displayedChannels.clear();
+        m_chart->removeAllSeries();
+    }
 
-    m_chart->removeAllSeries();
+    // the zoom is kept while browsing the traces of the same length
+    if(traceData.samples != m_displayedSamples || m_axisX->max() > traceData.samples) {
+        m_displayedSamples = traceData.samples;
+        m_axisX->setRange(0, traceData.samples);
+    }
+
+    if(reuseSeries) {
+        updateLineSeries();
+        return;
+    }
 
-    m_axisX->setRange(0, traceData.samples);
     updateAxes();
 
     QList<QLineSeries *> preparedLineSeries;
-    for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
-        if(!channel.isEnabled())
-            continue;
-
+    for(int i = 0; i < displayedChannels.count(); i++) {
         preparedLineSeries.append(new QLineSeries());
     }
 
@@ -890,41 +1171,198 @@ void TScopeWidget::displayTrace(size_t traceIndex) {
     // as they are internally sorted by pointer inside QChart...
     std::sort(preparedLineSeries.begin(), preparedLineSeries.end());
 
-    size_t channelIndex = 0;
-    for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
+    for(TDisplayedChannel & displayed : displayedChannels) {
+        displayed.lineSeries = preparedLineSeries.takeFirst();
 
-        if(!channel.isEnabled() || traceData.buffers[channelIndex] == nullptr) {
-            channelIndex++;
-            continue;
-        }
+        createLineSeries(displayed.lineSeries, displayed.channel);
+        displayed.lineSeries->setVisible(!m_densityCheckBox->isChecked());
+    }
 
-        QLineSeries * lineSeries = preparedLineSeries.first();
-        preparedLineSeries.pop_front();
+    m_displayedChannels = displayedChannels;
 
-        switch(traceData.type) {
-            case TScope::TSampleType::TUInt8:
-                createLineSeries(lineSeries, channel, (uint8_t*) traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TInt8:
-                createLineSeries(lineSeries, channel, (int8_t*)  traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TUInt16:
-                createLineSeries(lineSeries, channel, (uint16_t*)traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TInt16:
-                createLineSeries(lineSeries, channel, (int16_t*) traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TUInt32:
-                createLineSeries(lineSeries, channel, (uint32_t*)traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TInt32:
-                createLineSeries(lineSeries, channel, (int32_t*) traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TReal32:
-                createLineSeries(lineSeries, channel, (float*)   traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
-            case TScope::TSampleType::TReal64:
-                createLineSeries(lineSeries, channel, (double*)  traceData.buffers[channelIndex].constData(), traceBufferIndex, traceData.samples); break;
+    updateLineSeries();
+}
+
+void TScopeWidget::updateLineSeries() {
+    // keep the visible range within the trace
+    qreal min = std::max(m_axisX->min(), 0.0);
+    qreal max = std::min(m_axisX->max(), (qreal)m_displayedSamples);
+    if(m_displayedSamples && (min != m_axisX->min() || max != m_axisX->max()) && min < max) {
+        m_axisX->setRange(min, max); // updates the series again
+        return;
+    }
+
+    size_t first = (size_t)std::floor(min);
+    size_t last = (size_t)std::ceil(max) + 1;
+    qint32 idealPointCount = m_chart->plotArea().width();
+    size_t columns = idealPointCount > 0 ? idealPointCount : 1;
+
+    for(const TDisplayedChannel & displayed : std::as_const(m_displayedChannels)) {
+        TScope::TChannelStatus channel = displayed.channel;
+        qreal slope = (channel.getRange() * 2) / (channel.getMaxValue() - channel.getMinValue());
+        qreal offset = - slope * channel.getMinValue() - channel.getRange();
+
+        displayed.lineSeries->replace(displayed.pyramid->points(first, last, columns, slope, offset));
+    }
+
+    updateDensityBackground();
+}
+
+void TScopeWidget::setDensityMode(bool enabled) {
+    for(const TDisplayedChannel & displayed : std::as_const(m_displayedChannels)) {
+        displayed.lineSeries->setVisible(!enabled);
+    }
+
+    if(enabled) {
+        restartDensity();
+    }
+    else {
+        m_densityGeneration = m_densityWorker->reset(0, 0, 0, {});
+        m_densityConfigured = false;
+        m_densityBusy = false;
+        m_densityImage = QImage();
+    }
+
+    updateDensityBackground();
+}
+
+void TScopeWidget::restartDensity() {
+    m_densityImage = QImage();
+    m_densityConfigured = false;
+    m_densityNextTrace = 0;
+    m_densityBusy = false;
+
+    QList<TScopeDensityWorker::TChannel> channels;
+    int bufferIndex = 0;
+    for(TScope::TChannelStatus channel : m_scopeModel->channelsStatus()) {
+        if(channel.isEnabled()) {
+            qreal slope = (channel.getRange() * 2) / (channel.getMaxValue() - channel.getMinValue());
+            qreal offset = - slope * channel.getMinValue() - channel.getRange();
+            channels.append(TScopeDensityWorker::TChannel{bufferIndex, slope, offset, QColor(channelColorCodes[channel.getIndex() % 8])});
         }
 
-        channelIndex++;
+        bufferIndex++;
+    }
+
+    if(m_traceHistory.isEmpty()) {
+        m_densityGeneration = m_densityWorker->reset(0, 0, 0, {});
+        updateDensityBackground();
+        return;
     }
 
-    // delete possible leftover prepared LineSeries
-    qDeleteAll(preparedLineSeries);
+    m_densityGeneration = m_densityWorker->reset(m_samples, m_axisY->min(), m_axisY->max(), channels);
+    m_densityConfigured = true;
+
+    feedDensity();
+
+    updateDensityBackground();
+}
+
+void TScopeWidget::feedDensity() {
+    // a single batch is queued at a time, the next one is fed once the image of this one arrives
+    if(!m_densityConfigured || m_densityBusy)
+        return;
+
+    size_t firstTrace = std::max(m_densityNextTrace, (size_t)m_densityFirstSpinBox->value() - 1);
+    size_t endTrace = m_traceHistory.traceCount();
+    if(m_densityLastSpinBox->value() > 0)
+        endTrace = std::min(endTrace, (size_t)m_densityLastSpinBox->value());
+
+    // the traces dropped from the history are skipped
+    size_t traceIndex = m_traceHistory.firstRetainedTrace(firstTrace);
+    if(traceIndex >= endTrace)
+        return;
+
+    TScopeTraceData traceData;
+    size_t traceBufferIndex;
+
+    if(!m_traceHistory.find(traceIndex, traceData, traceBufferIndex)) {
+        // the history cannot be read back, only the traces captured from now on are overlaid
+        m_densityNextTrace = m_traceHistory.traceCount();
+        return;
+    }
+
+    size_t traces = std::min(traceData.traces - traceBufferIndex, endTrace - traceIndex);
+    m_densityNextTrace = traceIndex + traces;
+    m_densityBusy = true;
+
+    emit densityBatchReady(m_densityGeneration, traceBufferIndex, traces, traceData.samples, traceData.type, traceData.buffers);
+}
+
+void TScopeWidget::densityImageUpdated(quint64 generation, QImage image, size_t traces) {
+    // an image of the data already cleared
+    if(generation != m_densityGeneration)
+        return;
+
+    m_densityImage = image;
+    m_densityCheckBox->setToolTip(QString("Overlay the selected traces as a density map (%1 traces overlaid)").arg(traces));
+
+    updateDensityBackground();
+
+    m_densityBusy = false;
+    feedDensity();
+}
+
+void TScopeWidget::updateDensityBackground() {
+    QRectF plotArea = m_chart->plotArea();
+
+    if(!m_densityCheckBox->isChecked() || m_densityImage.isNull() || !m_displayedSamples || plotArea.width() < 1 || plotArea.height() < 1) {
+        m_chart->setPlotAreaBackgroundVisible(false);
+        return;
+    }
+
+    // the part of the image within the visible range of the horizontal axis
+    qreal columnsPerSample = m_densityImage.width() / (qreal)m_displayedSamples;
+    int left = qBound(0, (int)std::floor(m_axisX->min() * columnsPerSample), m_densityImage.width() - 1);
+    int right = qBound(left + 1, (int)std::ceil(m_axisX->max() * columnsPerSample), m_densityImage.width());
+
+    QImage visible = m_densityImage.copy(left, 0, right - left, m_densityImage.height()).scaled(plotArea.size().toSize(), Qt::IgnoreAspectRatio, Qt::FastTransformation);
+
+    QBrush brush(visible);
+    brush.setTransform(QTransform::fromTranslate(plotArea.left(), plotArea.top()));
+
+    m_chart->setPlotAreaBackgroundBrush(brush);
+    m_chart->setPlotAreaBackgroundVisible(true);
+}
+
+void TScopeWidget::zoom(qreal factor, qreal anchor) {
+    if(!m_displayedSamples)
+        return;
+
+    qreal min = m_axisX->min();
+    qreal max = m_axisX->max();
+    qreal center = min + (max - min) * anchor;
+    qreal width = std::min(std::max((max - min) * factor, (qreal)PYRAMID_BASE_BLOCK), (qreal)m_displayedSamples);
+
+    min = std::max(center - width * anchor, 0.0);
+    max = min + width;
+    if(max > m_displayedSamples) {
+        max = m_displayedSamples;
+        min = max - width;
+    }
+
+    m_axisX->setRange(min, max);
+}
+
+void TScopeWidget::pan(qreal fraction) {
+    if(!m_displayedSamples)
+        return;
+
+    qreal min = m_axisX->min();
+    qreal max = m_axisX->max();
+    qreal shift = (max - min) * fraction;
+
+    shift = std::max(shift, -min);
+    shift = std::min(shift, m_displayedSamples - max);
+
+    m_axisX->setRange(min + shift, max + shift);
+}
+
+void TScopeWidget::resetZoom() {
+    if(!m_displayedSamples)
+        return;
+
+    m_axisX->setRange(0, m_displayedSamples);
 }
 
 void TScopeWidget::updateAxes() {
@@ -989,52 +1427,11 @@ void TScopeWidget::updateIconAxis() {
     }
 }
 
-template <class T>
-void TScopeWidget::createLineSeries(QLineSeries * lineSeries, TScope::TChannelStatus channel, const T * buffer, size_t traceBufferIndex, size_t sampleCount) {
+void TScopeWidget::createLineSeries(QLineSeries * lineSeries, TScope::TChannelStatus channel) {
     lineSeries->setUseOpenGL(true);
     lineSeries->setName(QString(tr("%1 [channel %2]")).arg(channel.getAlias()).arg(channel.getIndex()));
     lineSeries->setColor(QColor(channelColorCodes[channel.getIndex() % 8]));
 
-    QVector<QPointF> pointList;
-    qreal slope = (channel.getRange() * 2) / (channel.getMaxValue() - channel.getMinValue());
-
-    qint32 idealPointCount = m_chart->plotArea().width();
-
-    qreal value;
-    if(sampleCount < idealPointCount) {
-        // not too many samples, draw every sample as single point
-        for (size_t i = 0; i < sampleCount; i++) {
-            value = slope * (buffer[i + traceBufferIndex * sampleCount] - channel.getMinValue()) - channel.getRange();
-            pointList.append(QPointF(i, value));
-        }
-    }
-    else {
-        // too many samples, use min/max downsampling
-        size_t groupSampleSize = sampleCount / idealPointCount;
-
-        qreal min, max;
-        size_t sampleIndex = 0;
-        while(sampleIndex < sampleCount) {
-            qreal firstValue = slope * (buffer[sampleIndex + traceBufferIndex * sampleCount] - channel.getMinValue()) - channel.getRange();
-            min = firstValue;
-            max = firstValue;
-
-            size_t loopEndIndex = (sampleIndex + groupSampleSize) > sampleCount ? sampleCount : sampleIndex + groupSampleSize;
-            for (size_t i = sampleIndex + 1; i < loopEndIndex; i++) {
-                qreal value = slope * (buffer[i + traceBufferIndex * sampleCount] - channel.getMinValue()) - channel.getRange();
-                min = value < min ? value : min;
-                max = value > max ? value : max;
-            }
-
-            pointList.append(QPointF(sampleIndex, min));
-            pointList.append(QPointF(sampleIndex, max));
-
-            sampleIndex += groupSampleSize;
-        }
-    }
-
-    lineSeries->replace(pointList);
-
     m_chart->addSeries(lineSeries);
 
     lineSeries->attachAxis(m_axisX);
@@ -32,11 +32,22 @@
 #include <QRadioButton>
 #include <QSpinBox>
 #include <QLabel>
+#include <memory>
+#include <QCheckBox>
+#include <QThread>
+#include <QTimer>
 
 #include "tscopemodel.h"
+#include "tscopetracehistory.h"
+#include "tscopetracepyramid.h"
+#include "tscopechartview.h"
+#include "tscopedensity.h"
+#include "tscoperecorder.h"
 #include "widgets/tconfigparamwidget.h"
 #include "../../eximport/texporthdfscopewizard.h"
 
+#define LIVE_FRAME_RATE 25
+
 class TDynamicRadioDialog : public QDialog
 {
     Q_OBJECT
@@ -50,15 +61,6 @@ private:
     QList<QRadioButton*> m_radioButtons;
 };
 
-struct TScopeTraceData {
-    size_t firstTraceIndex;
-    size_t traces;
-    size_t samples;
-    TScope::TSampleType type;
-    QList<QByteArray> buffers;
-    bool overvoltage;
-};
-
 
 class TScopeWidget : public QWidget
 {
@@ -66,6 +68,11 @@ class TScopeWidget : public QWidget
 
 public:
     explicit TScopeWidget(TScopeModel * scope, QWidget * parent = nullptr);
+    ~TScopeWidget();
+
+signals:
+    void densityBatchReady(quint64 generation, size_t firstTrace, size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers);
+    void recordBatch(size_t traces, size_t samples, TScope::TSampleType type, QList<QByteArray> buffers);
 
 public slots:
     void updateChannelStatus();
@@ -89,10 +96,23 @@ private slots:
     void clearTraceData(bool force = false);
     void saveTraceData();
     void exportHdf();
+    void editHistoryLimits();
 
     void showPrevTrace();
     void showNextTrace();
 
+    void zoom(qreal factor, qreal anchor);
+    void pan(qreal fraction);
+    void resetZoom();
+    void updateLineSeries();
+
+    void setDensityMode(bool enabled);
+    void densityImageUpdated(quint64 generation, QImage image, size_t traces);
+    void updateDensityBackground();
+
+    void setRecording(bool enabled);
+    void recordingFailed(QString message);
+
 private:
     const QList<const char *> channelColorCodes = { "#711415", "#f8cc1b", "#ae311e", "#b5be2f", "#f37324", "#72b043", "#f6a020", "#007f4e" };
 
@@ -106,21 +126,30 @@ private:
     void updateAxes();
     void updateIconAxis();    
 
-    template <class T>
-    void createLineSeries(
-        QLineSeries * lineSeries,
-        TScope::TChannelStatus channel,
-        const T * buffer,
-        size_t sampleOffset,
-        size_t sampleCount);
+    void createLineSeries(QLineSeries * lineSeries, TScope::TChannelStatus channel);
+
+    struct TDisplayedChannel {
+        QLineSeries * lineSeries;
+        TScope::TChannelStatus channel;
+        std::shared_ptr<TScopeTracePyramid> pyramid;
+    };
+
+    /// Channels of the displayed trace, redrawn from their pyramids when the horizontal axis is zoomed or panned
+    QList<TDisplayedChannel> m_displayedChannels;
+    size_t m_displayedSamples;
 
     bool m_isDataIntendedForThisWidget;
 
     void setGUItoReady();
     void setGUItoRunning();
 
-    QList<TScopeTraceData> m_traceDataList;
+    TScopeTraceHistory m_traceHistory;
     void displayTrace(size_t traceIndex);
+    void showLatestTrace();
+
+    /// Caps the redraws of the incoming traces at LIVE_FRAME_RATE per second
+    QTimer * m_redrawTimer;
+    bool m_redrawPending;
 
     size_t m_currentTraceNumber;
     size_t m_totalTraceCount;
@@ -131,6 +160,34 @@ private:
     QPushButton * m_clearDataButton;
     QPushButton * m_saveDataButton;
     QPushButton * m_exportDataButton;
+    QPushButton * m_historyButton;
+    QCheckBox * m_pipelinedCheckBox;
+    QCheckBox * m_densityCheckBox;
+    QSpinBox * m_densityFirstSpinBox;
+    QSpinBox * m_densityLastSpinBox;
+    QCheckBox * m_recordCheckBox;
+
+    QString channelSettings(TScope::TChannelStatus channelStatus);
+
+    bool startRecording();
+    void stopRecording();
+
+    TScopeRecorder * m_recorder;
+    TExportHDFScopeWizard * m_recordWizard;
+    QThread m_recorderThread;
+
+    /// Sets the density worker up for the current channels and feeds it the selected range of the history anew
+    void restartDensity();
+    /// Hands the next batch of the selected range to the density worker, once it is done with the previous one
+    void feedDensity();
+
+    TScopeDensityWorker * m_densityWorker;
+    QThread m_densityThread;
+    quint64 m_densityGeneration;
+    bool m_densityConfigured;
+    size_t m_densityNextTrace;
+    bool m_densityBusy;
+    QImage m_densityImage;
 
     QSpinBox * m_traceIndexSpinBox;
     QLabel * m_traceTotalLabel;
@@ -41,6 +41,7 @@
  * - Writes to HDF are always full rows (rank-2) or full elements (rank-1 treated as cols=1).
  * - Cache holds bytes until at least one full row is available.
  * - Flush threshold is chosen automatically from dataset chunking (chunkRows * multiplier).
+ * - Flushes end on a chunk boundary of the dataset where possible, so no chunk is written twice.
  */
 class TScenarioExportItem : public TScenarioItem
 {
@@ -320,6 +321,8 @@ private:
         m_rowBytes = 0;
 
         m_flushRowsThreshold = 0;
+        m_chunkRows = 0;
+        m_datasetRows = 0;
     }
 
     bool validateAndMaybeOpenSession(bool setStateOnItem)
@@ -480,6 +483,8 @@ private:
 
         const quint64 mult = qMax<quint64>(1, flushMultParam());
         m_flushRowsThreshold = qMax<quint64>(1, chunkRows * mult);
+        m_chunkRows = chunkRows;
+        m_datasetRows = (info.valid && !info.dims.isEmpty()) ? quint64(info.dims[0]) : 0;
     }
 
     bool ensurePreparedForExecute()
@@ -537,6 +542,13 @@ private:
             rowsToFlush = (fullRowsAvailable / m_flushRowsThreshold) * m_flushRowsThreshold; // multiple of threshold
             if (rowsToFlush == 0)
                 rowsToFlush = fullRowsAvailable;
+
+            // end on a chunk boundary of the dataset, e.g. when it did not start with whole chunks
+            if (m_chunkRows > 1) {
+                const quint64 alignedEnd = ((m_datasetRows + rowsToFlush) / m_chunkRows) * m_chunkRows;
+                if (alignedEnd > m_datasetRows)
+                    rowsToFlush = alignedEnd - m_datasetRows;
+            }
         }
 
         const quint64 bytesToFlush = rowsToFlush * m_rowBytes;
@@ -570,6 +582,7 @@ private:
             return false;
         }
         m_cache.remove(0, int(bytesToFlush));
+        m_datasetRows += rowsToFlush;
 
         setState(TState::TRuntimeInfo,
                  tr("Flushed %1 bytes (%2 rows). Cache: %3 bytes remaining.")
@@ -588,6 +601,8 @@ private:
     quint64 m_colsEff = 0;
     quint64 m_rowBytes = 0;
     quint64 m_flushRowsThreshold = 0;
+    quint64 m_chunkRows = 0;
+    quint64 m_datasetRows = 0;
     bool m_preparedOnce = false;
 };
 